@@ -0,0 +1,113 @@
+// bench_bvh.c
+
+#include "../include/bvh.h"
+#include "bench_scene.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BVH_BENCH_SIZE      200
+#define BVH_BENCH_THRESHOLD 4
+
+static double timed_build(group_t *mesh, bvh_builder_t builder, int threads)
+{
+    int previous = omp_get_max_threads();
+    omp_set_num_threads(threads);
+
+    double start = omp_get_wtime();
+    bvh_build((shape_t *)mesh, BVH_BENCH_THRESHOLD, builder);
+    double elapsed = omp_get_wtime() - start;
+
+    omp_set_num_threads(previous);
+    return elapsed;
+}
+
+// Builds each bundled mesh with every BVH builder, on one thread and on all
+// of them, and reports the build times, the tree's quality as measured by
+// bvh_analyze() and how long a render through it takes, so faster builds
+// can be weighed against slower traces. Trees that fail validation stop
+// the benchmark.
+static bool bench_mesh(const char *source_dir, const char *name,
+                       bvh_builder_t builder, unsigned size)
+{
+    group_t *serial = bench_load_mesh(source_dir, name);
+    group_t *mesh   = bench_load_mesh(source_dir, name);
+    if (serial == NULL || mesh == NULL)
+    {
+        group_free(serial);
+        group_free(mesh);
+        return false;
+    }
+
+    unsigned triangles = mesh->child_count;
+    double build_1     = timed_build(serial, builder, 1);
+    double build       = timed_build(mesh, builder, omp_get_max_threads());
+    group_free(serial);
+
+    group_warm_bounds(mesh);
+    bvh_quality_t q = bvh_analyze(mesh);
+    if (q.invalid_bounds > 0)
+    {
+        printf("%s %s: %u children outside their node's bounds\n", name,
+               bvh_builder_name(builder), q.invalid_bounds);
+        group_free(mesh);
+        return false;
+    }
+
+    camera_t c;
+    world_t w       = bench_mesh_world(mesh, size, &c);
+    double start    = omp_get_wtime();
+    canvas_t *image = camera_render(&c, &w);
+    double trace    = omp_get_wtime() - start;
+
+    if (!image)
+    {
+        printf("Failed to render %s\n", name);
+        world_free(&w);
+        return false;
+    }
+
+    printf("%-8s %-9s %9u %10.4f %10.4f %10.3f %10.1f %10.3f %6u %6.2f "
+           "%10u\n",
+           name, bvh_builder_name(builder), triangles, build_1, build, trace,
+           q.sah_cost, q.overlap, q.max_depth, q.mean_leaf_size,
+           q.straddlers);
+
+    canvas_free(image);
+    world_free(&w);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <source directory> [size]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    unsigned size = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 10) : 0;
+    if (size == 0)
+    {
+        size = BVH_BENCH_SIZE;
+    }
+
+    printf("Build times in seconds on 1 and %d threads\n",
+           omp_get_max_threads());
+    printf("%-8s %-9s %9s %10s %10s %10s %10s %10s %6s %6s %10s\n", "mesh",
+           "builder", "triangles", "build 1t", "build", "trace (s)",
+           "SAH cost", "overlap", "depth", "leaf", "straddlers");
+
+    for (int i = 0; i < bench_mesh_count; i++)
+    {
+        for (int b = 0; b < BVH_BUILDER_COUNT; b++)
+        {
+            if (!bench_mesh(argv[1], bench_meshes[i], (bvh_builder_t)b, size))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+// bench_grid.c
+
+#include "../include/bvh.h"
+#include "bench_scene.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define GRID_BENCH_SIZE      200
+#define GRID_BENCH_THRESHOLD 4
+
+typedef enum
+{
+    GRID_BENCH_MIDPOINT,
+    GRID_BENCH_SAH,
+    GRID_BENCH_GRID,
+    GRID_BENCH_COUNT
+} grid_bench_accelerator_t;
+
+static const char *accelerator_names[GRID_BENCH_COUNT] = {"midpoint", "sah",
+                                                          "grid"};
+
+// Renders g, built with the given accelerator, and reports the build and
+// render times.
+static bool bench_group(const char *name, group_t *g,
+                        grid_bench_accelerator_t accelerator, unsigned size)
+{
+    if (g == NULL)
+    {
+        return false;
+    }
+
+    unsigned children = g->child_count;
+    double start      = omp_get_wtime();
+    switch (accelerator)
+    {
+    case GRID_BENCH_MIDPOINT:
+        bvh_build((shape_t *)g, GRID_BENCH_THRESHOLD, BVH_BUILD_MIDPOINT);
+        break;
+    case GRID_BENCH_SAH:
+        bvh_build((shape_t *)g, GRID_BENCH_THRESHOLD, BVH_BUILD_SAH);
+        break;
+    default:
+        group_build_grid(g);
+        break;
+    }
+    double build = omp_get_wtime() - start;
+
+    camera_t c;
+    world_t w       = bench_mesh_world(g, size, &c);
+    start           = omp_get_wtime();
+    canvas_t *image = camera_render(&c, &w);
+    double trace    = omp_get_wtime() - start;
+
+    if (!image)
+    {
+        printf("Failed to render %s\n", name);
+        world_free(&w);
+        return false;
+    }
+
+    printf("%-12s %-9s %9u %10.4f %10.3f\n", name,
+           accelerator_names[accelerator], children, build, trace);
+
+    canvas_free(image);
+    world_free(&w);
+    return true;
+}
+
+// Compares the grid with the midpoint and SAH BVHs on sphere grids like
+// scene_sphere_grid, the layout a grid suits best, and on the bundled
+// meshes, whose triangles are spread less evenly.
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <source directory> [size]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    unsigned size = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 10) : 0;
+    if (size == 0)
+    {
+        size = GRID_BENCH_SIZE;
+    }
+
+    printf("%-12s %-9s %9s %10s %10s\n", "scene", "accel", "children",
+           "build (s)", "trace (s)");
+
+    const unsigned sphere_grids[] = {10, 20};
+    for (int i = 0; i < 2; i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "spheres %u", sphere_grids[i]);
+        for (int a = 0; a < GRID_BENCH_COUNT; a++)
+        {
+            if (!bench_group(name, bench_sphere_grid(sphere_grids[i]),
+                             (grid_bench_accelerator_t)a, size))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    for (int i = 0; i < bench_mesh_count; i++)
+    {
+        for (int a = 0; a < GRID_BENCH_COUNT; a++)
+        {
+            if (!bench_group(bench_meshes[i],
+                             bench_load_mesh(argv[1], bench_meshes[i]),
+                             (grid_bench_accelerator_t)a, size))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
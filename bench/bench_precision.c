@@ -0,0 +1,123 @@
+// bench_precision.c
+
+#include "bench_scene.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static canvas_t *load_ppm(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        printf("Failed to open %s\n", path);
+        return NULL;
+    }
+
+    unsigned width, height, max;
+    if (fscanf(file, "P3 %u %u %u", &width, &height, &max) != 3 || max == 0)
+    {
+        printf("%s is not a plain PPM image\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    canvas_t *image = canvas(width, height);
+    for (unsigned y = 0; image && y < height; y++)
+    {
+        for (unsigned x = 0; x < width; x++)
+        {
+            unsigned r, g, b;
+            if (fscanf(file, "%u %u %u", &r, &g, &b) != 3)
+            {
+                printf("%s is truncated\n", path);
+                canvas_free(image);
+                image = NULL;
+                break;
+            }
+            canvas_write_pixel(image, x, y,
+                               color(r / (double)max, g / (double)max,
+                                     b / (double)max));
+        }
+    }
+
+    fclose(file);
+    return image;
+}
+
+// Compares the rendered image to one produced by the other precision and
+// reports the error in 8-bit colour levels, as written by canvas_save.
+static bool compare(const char *path_a, const char *path_b)
+{
+    canvas_t *a = load_ppm(path_a);
+    canvas_t *b = load_ppm(path_b);
+    if (!a || !b || a->width != b->width || a->height != b->height)
+    {
+        printf("Images cannot be compared\n");
+        canvas_free(a);
+        canvas_free(b);
+        return false;
+    }
+
+    double sum_squares = 0.0, max_error = 0.0;
+    unsigned differing = 0;
+    unsigned count     = a->width * a->height;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        tuple_t d = tuple_subtract(a->pixels[i], b->pixels[i]);
+        double e  = fmax(fabs(d.x), fmax(fabs(d.y), fabs(d.z))) * 255.0;
+        sum_squares += (d.x * d.x + d.y * d.y + d.z * d.z) * 255.0 * 255.0;
+        max_error = fmax(max_error, e);
+        if (e > 2.0)
+        {
+            differing++;
+        }
+    }
+
+    printf("RMSE %.4f levels, max error %.0f levels, "
+           "%u of %u pixels off by more than 2 levels\n",
+           sqrt(sum_squares / (3.0 * count)), max_error, differing, count);
+
+    canvas_free(a);
+    canvas_free(b);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <output.ppm> [reference.ppm]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    world_t w  = bench_world();
+    camera_t c = bench_camera(BENCH_SIZE);
+
+    double start    = omp_get_wtime();
+    canvas_t *image = camera_render(&c, &w);
+    double elapsed  = omp_get_wtime() - start;
+
+    if (!image || !canvas_save(image, argv[1]))
+    {
+        printf("Failed to render %s\n", argv[1]);
+        canvas_free(image);
+        world_free(&w);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s precision: %.3f s (%zu-byte tuples)\n",
+           sizeof(real_t) == sizeof(float) ? "single" : "double", elapsed,
+           sizeof(tuple_t));
+
+    canvas_free(image);
+    world_free(&w);
+
+    if (argc > 2 && !compare(argv[1], argv[2]))
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,54 @@
+// bench_render.c
+
+#include "bench_scene.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_RUNS 3
+
+// Renders the benchmark scene a few times and reports the fastest run, so
+// build configurations can be compared without a file write in the timing.
+// Usage: bench_render [size] [wavefront]
+int main(int argc, char **argv)
+{
+    unsigned size = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 0;
+    if (size == 0)
+    {
+        size = BENCH_SIZE;
+    }
+
+    world_t w  = bench_world();
+    camera_t c = bench_camera(size);
+
+    bool wavefront = argc > 2 && strcmp(argv[2], "wavefront") == 0;
+    camera_set_wavefront(&c, wavefront);
+
+    double best = 0.0;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        double start    = omp_get_wtime();
+        canvas_t *image = camera_render(&c, &w);
+        double elapsed  = omp_get_wtime() - start;
+
+        if (!image)
+        {
+            printf("Failed to render the benchmark scene\n");
+            world_free(&w);
+            return EXIT_FAILURE;
+        }
+        canvas_free(image);
+
+        if (run == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+
+    printf("best of %d %s renders at %ux%u: %.3f s\n", BENCH_RUNS,
+           wavefront ? "wavefront" : "recursive", size, size, best);
+
+    world_free(&w);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+// bench_scene.c
+
+#include "bench_scene.h"
+#include "../include/obj_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+const char *bench_meshes[] = {"teapot", "pawn", "bunny", "pumpkin", "dragon"};
+const int bench_mesh_count = sizeof(bench_meshes) / sizeof(bench_meshes[0]);
+
+// A reflective floor, a row of solid and glass spheres and a rippled
+// triangle mesh, so both the quadric and the triangle kernels are timed.
+world_t bench_world(void)
+{
+    world_t w = world();
+    world_add_light(&w, lights_point_light(point(-10, 10, -10), WHITE));
+
+    plane_t floor              = plane();
+    floor.material.color       = color(0.8, 0.8, 0.7);
+    floor.material.reflective  = 0.3;
+    floor.material.specular    = 0.0;
+    floor.material.has_pattern = false;
+    world_add_shape(&w, floor);
+
+    for (int i = 0; i < 5; i++)
+    {
+        sphere_t s = i % 2 == 0 ? sphere() : glass_sphere();
+        s.material.color = color(0.2 + 0.15 * i, 0.4, 0.9 - 0.15 * i);
+        shape_set_transform(
+            &s, matrix_mul(transform_translation(-4 + 2 * i, 0.7, 1),
+                           transform_scaling(0.7, 0.7, 0.7)));
+        world_add_shape(&w, s);
+    }
+
+    group_t *mesh = group();
+    for (int z = 0; z < BENCH_MESH_N; z++)
+    {
+        for (int x = 0; x < BENCH_MESH_N; x++)
+        {
+            tuple_t p[4];
+            for (int k = 0; k < 4; k++)
+            {
+                double u = (x + (k & 1)) / (double)BENCH_MESH_N;
+                double v = (z + (k >> 1)) / (double)BENCH_MESH_N;
+                p[k]     = point(8 * u - 4, 0.3 * sin(12 * u) * cos(9 * v),
+                                 4 * v + 3);
+            }
+
+            triangle_t *a = malloc(sizeof(triangle_t));
+            triangle_t *b = malloc(sizeof(triangle_t));
+            *a            = triangle(p[0], p[1], p[2]);
+            *b            = triangle(p[1], p[3], p[2]);
+            a->material.color = color(0.9, 0.5, 0.3);
+            b->material.color = color(0.9, 0.5, 0.3);
+            group_add_child(mesh, (shape_t *)a);
+            group_add_child(mesh, (shape_t *)b);
+        }
+    }
+    divide((shape_t *)mesh, 4);
+    shape_set_transform((shape_t *)mesh, transform_translation(0, 1.5, 0));
+    world_add_group(&w, mesh);
+
+    return w;
+}
+
+camera_t bench_camera(unsigned size)
+{
+    camera_t c = camera(size, size, M_PI_3);
+    camera_set_transform(&c, transform_view(point(0, 3.5, -6),
+                                            point(0, 0.5, 3),
+                                            vector(0, 1, 0)));
+    return c;
+}
+
+group_t *bench_load_mesh(const char *source_dir, const char *name)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/src/scenes/obj/%s.obj", source_dir, name);
+
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        printf("Failed to open %s\n", path);
+        return NULL;
+    }
+
+    obj_parser_t parser = obj_parse_file(file);
+    fclose(file);
+
+    group_t *mesh = obj_parser_get_default_group(&parser);
+    if (mesh == NULL || mesh->child_count == 0)
+    {
+        printf("No triangles found in %s\n", path);
+        obj_parser_free(&parser);
+        return NULL;
+    }
+
+    parser.default_group = NULL;
+    obj_parser_free(&parser);
+    return mesh;
+}
+
+group_t *bench_sphere_grid(unsigned n)
+{
+    group_t *g = group();
+    for (unsigned i = 0; g != NULL && i < n * n * n; i++)
+    {
+        sphere_t *s = malloc(sizeof(sphere_t));
+        if (s == NULL)
+        {
+            group_free(g);
+            return NULL;
+        }
+
+        *s                = sphere();
+        s->material.color = hex_color("#ed80e9");
+        shape_set_transform(
+            s, matrix_mul(transform_translation(i % n * 2.5, i / n % n * 2.5,
+                                                i / (n * n) * 2.5),
+                          transform_scaling(0.5, 0.5, 0.5)));
+        group_add_child(g, (shape_t *)s);
+    }
+    return g;
+}
+
+world_t bench_mesh_world(group_t *mesh, unsigned size, camera_t *c)
+{
+    bounding_box_t box = bounds_of_group(mesh);
+    tuple_t centre     = tuple_scale(tuple_add(box.min, box.max), 0.5);
+    double extent      = tuple_magnitude(tuple_subtract(box.max, box.min));
+
+    world_t w = world();
+    world_add_light(&w, lights_point_light(
+                            tuple_add(centre, vector(-extent, extent, -extent)),
+                            WHITE));
+
+    plane_t floor             = plane();
+    floor.material.reflective = 0.2;
+    shape_set_transform(&floor, transform_translation(0, box.min.y, 0));
+    world_add_shape(&w, floor);
+    world_add_group(&w, mesh);
+
+    *c = camera(size, size, M_PI_3);
+    camera_set_transform(
+        c, transform_view(tuple_add(centre, vector(0, 0.3 * extent,
+                                                    -1.2 * extent)),
+                          centre, vector(0, 1, 0)));
+    return w;
+}
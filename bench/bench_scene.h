@@ -0,0 +1,34 @@
+// bench_scene.h
+
+#ifndef BENCH_SCENE_H
+#define BENCH_SCENE_H
+
+#include "../include/bounds.h"
+#include "../include/camera.h"
+#include "../include/canvas.h"
+#include "../include/shapes.h"
+#include "../include/transformations.h"
+#include "../include/world.h"
+
+#define BENCH_SIZE   400
+#define BENCH_MESH_N 48
+
+// Meshes bundled in src/scenes/obj, smallest first.
+extern const char *bench_meshes[];
+extern const int bench_mesh_count;
+
+world_t bench_world(void);
+camera_t bench_camera(unsigned size);
+
+// Loads src/scenes/obj/<name>.obj below source_dir, or returns NULL.
+group_t *bench_load_mesh(const char *source_dir, const char *name);
+
+// n x n x n small spheres, 2.5 apart, as in scene_sphere_grid.
+group_t *bench_sphere_grid(unsigned n);
+
+// Puts mesh on a floor under one light, framed by a square camera of the
+// given size from its bounds, whatever scale the file uses. The world owns
+// the mesh afterwards.
+world_t bench_mesh_world(group_t *mesh, unsigned size, camera_t *c);
+
+#endif
@@ -0,0 +1,92 @@
+// bench_train.c
+
+#include "bench_scene.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRAIN_SIZE 160
+
+// Profile-guided builds are trained on this program: it renders the
+// benchmark scene and each bundled OBJ mesh once, small, so the profile
+// covers quadrics, deep BVHs, smooth triangles, reflection and refraction.
+
+static bool render(world_t *w, camera_t *c, const char *name)
+{
+    canvas_t *image = camera_render(c, w);
+    if (!image)
+    {
+        printf("Failed to render %s\n", name);
+        return false;
+    }
+
+    canvas_free(image);
+    return true;
+}
+
+static void set_group_material(group_t *g, material_t m)
+{
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        shape_t *child = g->children[i];
+        if (child->type == SHAPE_GROUP)
+        {
+            set_group_material((group_t *)child, m);
+        }
+        else
+        {
+            child->material = m;
+        }
+    }
+}
+
+static bool train_mesh(const char *source_dir, const char *name, int index)
+{
+    group_t *mesh = bench_load_mesh(source_dir, name);
+    if (mesh == NULL)
+    {
+        return false;
+    }
+
+    // Alternate glass and mirror materials between meshes.
+    material_t m = material();
+    m.color      = color(0.9, 0.6, 0.4);
+    if (index % 2 == 0)
+    {
+        m.reflective = 0.6;
+    }
+    else
+    {
+        m.transparency     = 0.8;
+        m.reflective       = 0.9;
+        m.refractive_index = 1.52;
+    }
+    set_group_material(mesh, m);
+    divide((shape_t *)mesh, 4);
+
+    camera_t c;
+    world_t w = bench_mesh_world(mesh, TRAIN_SIZE, &c);
+    bool ok   = render(&w, &c, name);
+    world_free(&w);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <source directory>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    world_t w  = bench_world();
+    camera_t c = bench_camera(TRAIN_SIZE * 2);
+    bool ok    = render(&w, &c, "benchmark scene");
+    world_free(&w);
+
+    for (int i = 0; ok && i < bench_mesh_count; i++)
+    {
+        ok = train_mesh(argv[1], bench_meshes[i], i);
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,84 @@
+# Builds bench_render in several configurations and reports how fast each
+# renders the benchmark scene. Run in script mode:
+#
+#   cmake -DSOURCE_DIR=<src> -DBINARY_DIR=<dir> [-DBUILD_TYPE=Release]
+#         [-DCONFIGURATIONS="default;unity;pgo;pgo_unity"]
+#         -P configurations.cmake
+#
+# The pgo configurations are built twice in the same directory: once
+# instrumented to run bench_train over the bundled scenes, then again with
+# the recorded profile.
+
+if(NOT SOURCE_DIR OR NOT BINARY_DIR)
+    message(FATAL_ERROR "SOURCE_DIR and BINARY_DIR must be set")
+endif()
+
+if(NOT CONFIGURATIONS)
+    set(CONFIGURATIONS default unity pgo pgo_unity)
+endif()
+
+find_program(LLVM_PROFDATA NAMES llvm-profdata)
+
+function(run_step)
+    execute_process(COMMAND ${ARGV} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Failed: ${ARGV}")
+    endif()
+endfunction()
+
+function(configure dir unity pgo)
+    run_step(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${dir}
+             -DCMAKE_BUILD_TYPE=${BUILD_TYPE} -DRT_UNITY_BUILD=${unity}
+             -DRT_PGO=${pgo} -DRT_PGO_DIR=${dir}/profile)
+endfunction()
+
+function(build dir target)
+    run_step(${CMAKE_COMMAND} --build ${dir} --target ${target} -j)
+endfunction()
+
+set(summary "")
+
+foreach(config ${CONFIGURATIONS})
+    set(dir ${BINARY_DIR}/config-${config})
+    if(config MATCHES "unity")
+        set(unity ON)
+    else()
+        set(unity OFF)
+    endif()
+
+    message(STATUS "Building the ${config} configuration in ${dir}")
+
+    if(config MATCHES "^pgo")
+        file(REMOVE_RECURSE ${dir}/profile)
+        configure(${dir} ${unity} GENERATE)
+        build(${dir} bench_train)
+        run_step(${dir}/bench/bench_train ${SOURCE_DIR})
+
+        # Clang writes raw profiles that have to be merged first; gcc reads
+        # its .gcda files straight from the profile directory.
+        file(GLOB raw_profiles ${dir}/profile/*.profraw)
+        if(raw_profiles)
+            if(NOT LLVM_PROFDATA)
+                message(FATAL_ERROR "llvm-profdata is needed to merge profiles")
+            endif()
+            run_step(${LLVM_PROFDATA} merge -o ${dir}/profile/rt.profdata
+                     ${raw_profiles})
+        endif()
+
+        configure(${dir} ${unity} USE)
+    else()
+        configure(${dir} ${unity} OFF)
+    endif()
+
+    build(${dir} bench_render)
+    execute_process(COMMAND ${dir}/bench/bench_render
+                    OUTPUT_VARIABLE output RESULT_VARIABLE result)
+    string(REGEX MATCH "([0-9.]+) s" seconds "${output}")
+    if(NOT result EQUAL 0 OR NOT seconds)
+        message(FATAL_ERROR "bench_render failed in ${config}: ${output}")
+    endif()
+
+    string(APPEND summary "  ${config}\t${CMAKE_MATCH_1} s\n")
+endforeach()
+
+message("\nBest render time per configuration:\n${summary}")
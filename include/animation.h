@@ -0,0 +1,66 @@
+// animation.h
+
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "camera.h"
+#include "world.h"
+#include <stdbool.h>
+
+typedef struct
+{
+    double time;
+    tuple_t from;
+    tuple_t to;
+    tuple_t up;
+} camera_keyframe_t;
+
+// Object keyframes are stored as components and composed as
+// translation * rotation_x * rotation_y * rotation_z * scaling, so rotations
+// interpolate by angle rather than by matrix element.
+typedef struct
+{
+    double time;
+    tuple_t translation;
+    tuple_t rotation;
+    tuple_t scale;
+} transform_keyframe_t;
+
+typedef struct
+{
+    shape_t *shape;
+    transform_keyframe_t *keys;
+    unsigned key_count;
+    unsigned key_capacity;
+    matrix_t applied;
+    bool has_applied;
+} object_track_t;
+
+typedef struct
+{
+    camera_t camera;
+    camera_keyframe_t *camera_keys;
+    unsigned camera_key_count;
+    unsigned camera_key_capacity;
+    object_track_t *tracks;
+    unsigned track_count;
+    unsigned track_capacity;
+} animation_t;
+
+animation_t animation(camera_t base);
+
+void animation_free(animation_t *a);
+
+bool animation_add_camera_key(animation_t *a, double time, tuple_t from,
+                              tuple_t to, tuple_t up);
+
+bool animation_add_object_key(animation_t *a, shape_t *shape, double time,
+                              tuple_t translation, tuple_t rotation,
+                              tuple_t scale);
+
+unsigned animation_apply(animation_t *a, double time);
+
+bool animation_render(animation_t *a, world_t *w, unsigned frame_count,
+                      double frames_per_second, const char *path_prefix);
+
+#endif
@@ -15,10 +15,13 @@ bounding_box_t bounds_of_triangle(triangle_t triangle);
 void bounds_add_box(bounding_box_t *box1, const bounding_box_t *box2);
 bool bounds_box_contains_point(bounding_box_t box, tuple_t point);
 bool bounds_box_contains_box(bounding_box_t box1, bounding_box_t box2);
+bool bounds_is_empty(bounding_box_t box);
+bounding_box_t bounds_intersection(bounding_box_t box1, bounding_box_t box2);
 bounding_box_t bounds_transform(bounding_box_t bbox, matrix_t matrix);
 bounding_box_t bounds_parent_space_bounds_of(const shape_t *shape);
 bounding_box_t bounds_of_group(const void *group_ptr);
 bool bounds_intersects(bounding_box_t box, ray_t ray);
+double bounds_surface_area(bounding_box_t box);
 void split_bounds(bounding_box_t box, bounding_box_t *left,
                   bounding_box_t *right);
 #endif
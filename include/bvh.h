@@ -0,0 +1,84 @@
+// bvh.h
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "shapes.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// The shape of a group hierarchy. Every group in it is a node and leaves
+// are the nodes without child groups. Straddlers are primitives held by a
+// node that also has child groups: the children divide() leaves behind
+// because they cross its split, or a lone primitive the other builders
+// place beside a subtree. leaf_sizes[n] counts leaves of n primitives, the last bin
+// those of BVH_LEAF_HISTOGRAM_BINS - 1 or more. invalid_bounds counts
+// children whose box is not inside their node's cached bounds.
+typedef struct
+{
+    unsigned nodes;
+    unsigned leaves;
+    unsigned max_depth;
+    double mean_leaf_depth;
+    unsigned primitives;
+    unsigned straddlers;
+    unsigned min_leaf_size;
+    unsigned max_leaf_size;
+    double mean_leaf_size;
+    unsigned leaf_sizes[BVH_LEAF_HISTOGRAM_BINS];
+    double sah_cost;
+    double overlap;
+    unsigned invalid_bounds;
+} bvh_quality_t;
+
+// Builds a hierarchy of nested groups over the children of shape, which must
+// be a group, with the given builder. Groups with fewer than threshold
+// children are left as leaves. The midpoint builder is divide(); the linear
+// builders sort children by the 30- or 63-bit Morton code of their centroid
+// and emit the tree in parallel, which is much faster to build at some cost
+// in tree quality. The SAH builder splits top-down at the cheapest of
+// SAH_BINS candidate planes per axis, building subtrees as OpenMP tasks and
+// binning the largest ranges in parallel. The spatial-split builder also
+// considers cutting triangles at a split plane and referencing each piece
+// from its side, which untangles meshes of long thin triangles at the cost
+// of up to SBVH_MAX_DUPLICATION more references.
+bool bvh_build(shape_t *shape, unsigned threshold, bvh_builder_t builder);
+const char *bvh_builder_name(bvh_builder_t builder);
+bool bvh_builder_parse(const char *name, bvh_builder_t *builder);
+
+void divide_lbvh(shape_t *shape, unsigned threshold, unsigned morton_bits);
+void divide_sah(shape_t *shape, unsigned threshold);
+void divide_sbvh(shape_t *shape, unsigned threshold);
+
+// The surface area shared by every pair of sibling nodes in the tree,
+// summed and divided by the area of the root's bounds. Rays through an
+// overlap must visit both siblings, so lower is better.
+double bvh_overlap(const group_t *g);
+
+bvh_quality_t bvh_analyze(const group_t *g);
+void bvh_quality_print(const bvh_quality_t *q, FILE *file);
+
+// Children that reach REAL_MAX, such as planes, cannot be placed in a
+// hierarchy and are kept in its root.
+bool bvh_is_bounded(bounding_box_t box);
+
+// Moves the children of root, the top node of a tree built over the
+// children of g, into g so g keeps its transform and place in the scene.
+void bvh_adopt_root(group_t *g, shape_t *root);
+
+static inline real_t bvh_axis(tuple_t t, int axis)
+{
+    return axis == 0 ? t.x : axis == 1 ? t.y : t.z;
+}
+
+// Interleaves x, y and z, each in [0, 1], into a Morton code of 30 or 63
+// bits, with x in the highest bit.
+uint64_t bvh_morton_code(double x, double y, double z, unsigned bits);
+
+// Sorts keys, whose highest set bit is below bits, in ascending order and
+// applies the same permutation to values.
+bool bvh_radix_sort(uint64_t *keys, uint32_t *values, size_t count,
+                    unsigned bits);
+
+#endif
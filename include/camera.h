@@ -18,15 +18,58 @@ typedef struct
     double pixel_size;
     double half_width;
     double half_height;
+    unsigned aa_max_samples;
+    double aa_threshold;
+    bool wavefront;
 } camera_t;
 
+typedef struct
+{
+    unsigned x;
+    unsigned y;
+    unsigned width;
+    unsigned height;
+} render_region_t;
+
 camera_t camera(const unsigned hsize, const unsigned vsize,
                 const double field_of_view);
 
 ray_t camera_ray_for_pixel(const camera_t *c, unsigned px, unsigned py);
 
+ray_t camera_ray_for_sample(const camera_t *c, double sx, double sy);
+
+// A pixel can only be split with AA_MIN_SAMPLES samples or more, so
+// max_samples from 2 up to that are raised to it; 0 and 1 turn anti-aliasing
+// off.
+void camera_set_antialiasing(camera_t *c, unsigned max_samples,
+                             double threshold);
+
+// Renders without anti-aliasing trace secondary rays in sorted batches per
+// tile, as wavefront.h describes, instead of recursively from each hit.
+void camera_set_wavefront(camera_t *c, bool wavefront);
+
 void camera_set_transform(camera_t *c, matrix_t transform);
 
-canvas_t *camera_render(const camera_t *c, const world_t *w);
+// The render functions taking a world_t * call world_prepare on it first.
+canvas_t *camera_render(const camera_t *c, world_t *w);
+
+canvas_t *camera_render_region(const camera_t *c, world_t *w,
+                               render_region_t region);
+
+bool camera_render_into(const camera_t *c, world_t *w,
+                        render_region_t region, canvas_t *target);
+
+canvas_t *camera_render_progressive(const camera_t *c, world_t *w,
+                                    const char *preview_path);
+
+// Tile renders leave the world as it is, so a renderer can prepare it once
+// and then render many tiles at the same time. camera_render_tile writes
+// the region to the top left of dst; camera_render_tile_into writes it in
+// place in a full-size target.
+bool camera_render_tile(const camera_t *c, const world_t *w,
+                        render_region_t region, canvas_t *dst);
+
+bool camera_render_tile_into(const camera_t *c, const world_t *w,
+                             render_region_t region, canvas_t *target);
 
 #endif
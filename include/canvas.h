@@ -25,6 +25,9 @@ void canvas_write_pixel(canvas_t *c, unsigned x, unsigned y, tuple_t color);
 
 tuple_t canvas_pixel_at(const canvas_t *c, const unsigned x, const unsigned y);
 
+unsigned canvas_quantize(const tuple_t *pixels, unsigned count,
+                         unsigned char *rgb);
+
 char *canvas_to_ppm(const canvas_t *c);
 
 void canvas_free(canvas_t *c);
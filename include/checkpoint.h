@@ -0,0 +1,39 @@
+// checkpoint.h
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "camera.h"
+#include "canvas.h"
+#include "world.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CHECKPOINT_MAGIC   "RTCKPT01"
+#define CHECKPOINT_VERSION 1
+
+// A checkpoint file is this header followed by tile records, each a uint32_t
+// tile index and the tile's pixels as row-major RGB floats. Records are only
+// ever appended, so a file cut short by a crash loses at most its last,
+// partially written record.
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t hsize;
+    uint32_t vsize;
+    uint32_t tile_size;
+    uint32_t aa_max_samples;
+    uint32_t reserved;
+    double field_of_view;
+    double aa_threshold;
+    double transform[16];
+    uint64_t scene_hash;
+} checkpoint_header_t;
+
+uint64_t checkpoint_scene_hash(const world_t *w);
+
+canvas_t *checkpoint_render(const camera_t *c, world_t *w,
+                            const char *path, bool resume);
+
+#endif
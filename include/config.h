@@ -3,6 +3,7 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <float.h>
 #include <math.h>
 
 // ===== MATHEMATICAL CONSTANTS =====
@@ -11,15 +12,52 @@
 
 #define M_PI_3 (M_PI / 3)
 #define M_PI_5 (M_PI / 5)
+
+// ===== NUMERIC PRECISION =====
+
+// Geometry, rays and intersection distances are stored as real_t. Building
+// with RT_SINGLE_PRECISION halves their size and doubles the SIMD width of
+// the intersection kernels; matrix inversion and shading stay in double.
+#ifdef RT_SINGLE_PRECISION
+typedef float real_t;
+#define REAL_MAX  FLT_MAX
+#define REAL_EPSILON FLT_EPSILON
+#define real_sqrt sqrtf
+#define real_fabs fabsf
+#define real_fmin fminf
+#define real_fmax fmaxf
+#else
+typedef double real_t;
+#define REAL_MAX  DBL_MAX
+#define REAL_EPSILON DBL_EPSILON
+#define real_sqrt sqrt
+#define real_fabs fabs
+#define real_fmin fmin
+#define real_fmax fmax
+#endif
+
+// Single precision hit points carry a rounding error proportional to their
+// distance from the origin, so over_point and under_point are offset by at
+// least this fraction of that distance
+#define SURFACE_OFFSET_RELATIVE 1e-5
+
+// Quadric coefficients built from real_t rays are trusted to this many
+// units of REAL_EPSILON relative to the size of the terms they came from
+#define QUADRIC_ROUNDING_ULPS 8.0
 // ===== MEMORY LIMITS =====
 
 #define MAX_NUM_OBJECTS 100000
 
 #define MAX_GROUP_CHILDREN 50000
 
-#define MAX_INTERSECTIONS 64
+// Hit lists grow on demand; this is the capacity they start with, and that
+// each thread's scratch lists are given before a render
+#define INTERSECTIONS_INITIAL_CAPACITY 64
+
+// Nested transparent objects tracked when finding refractive indices
+#define MAX_REFRACTION_CONTAINERS 64
 
-#define MAX_SEQUENCE_LENGTH 32
+#define MAX_ANIMATION_KEYS 10000
 
 // ===== OBJ FILE PARSER LIMITS =====
 
@@ -38,6 +76,80 @@
 
 #define DEFAULT_SCENE_WIDTH 1000
 
+// Largest per-channel difference between neighbouring samples that adaptive
+// anti-aliasing accepts before subdividing a pixel
+#define AA_DEFAULT_THRESHOLD 0.1
+
+// Fewest samples that let adaptive anti-aliasing split a pixel once: four
+// corners, four edge midpoints and the centre
+#define AA_MIN_SAMPLES 9
+
+// Pixel spacing of the first progressive pass; must be a power of two
+#define PROGRESSIVE_INITIAL_STEP 16
+
+// Edge length in pixels of the tiles whose rays wavefront rendering traces
+// and sorts as one stream per bounce
+#define WAVEFRONT_TILE_SIZE 32
+
+// Edge length in pixels of the tiles written to render checkpoints
+#define CHECKPOINT_TILE_SIZE 32
+
+// Minimum time between appends of finished tiles to a checkpoint file
+#define CHECKPOINT_INTERVAL_SECONDS 30.0
+
+// Relative costs of visiting a BVH child and intersecting a primitive, used
+// to estimate tree quality with the surface area heuristic
+#define BVH_TRAVERSAL_COST    1.0
+#define BVH_INTERSECTION_COST 2.0
+
+// Subtrees with fewer primitives than this are emitted by the linear BVH
+// builder on the current thread instead of in a new task
+#define LBVH_TASK_MIN 4096
+
+// Bits per digit of the radix sort that orders Morton codes
+#define LBVH_RADIX_BITS 8
+
+// Bins per axis used by the binned SAH builder to choose split planes
+#define SAH_BINS 16
+
+// Ranges of at least this many primitives are binned by several tasks, and
+// split into a task per subtree by the binned SAH builder
+#define SAH_PARALLEL_BIN_MIN 8192
+#define SAH_TASK_MIN         512
+
+// The spatial-split builder only tries cutting triangles where the children
+// of the best object split overlap by more than this fraction of the root's
+// surface area, and adds at most this fraction of the original references
+// as duplicates
+#define SBVH_OVERLAP_THRESHOLD 1e-5
+#define SBVH_MAX_DUPLICATION   0.3
+
+// Leaf sizes counted separately by bvh_analyze; larger leaves share the
+// last bin
+#define BVH_LEAF_HISTOGRAM_BINS 16
+
+// Cells along the longest axis of a grid per cube root of its child count,
+// and the most cells along any axis
+#define GRID_DENSITY        2.0
+#define GRID_MAX_RESOLUTION 128
+
+// Children a grid traversal remembers having tested, so a child spanning
+// consecutive cells is not tested again
+#define GRID_MAILBOX 8
+
+// A refitted BVH is rebuilt once its estimated cost grows past this multiple
+// of the cost measured when it was built
+#define BVH_REBUILD_COST_RATIO 1.5
+
+// Tile edge length and retry limit used by distributed rendering
+#define DISTRIBUTED_TILE_SIZE    32
+#define DISTRIBUTED_MAX_ATTEMPTS 3
+
+// Render statistics (RT_STATS builds) keep one counter slot per live
+// thread, padded to a cache line so threads never share one
+#define STATS_MAX_THREADS 256
+#define STATS_CACHE_LINE  64
+
 // ===== COLOR CONSTANTS =====
 
 #define BLACK color(0, 0, 0)
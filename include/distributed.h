@@ -0,0 +1,27 @@
+// distributed.h
+
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include "camera.h"
+#include "canvas.h"
+#include "world.h"
+
+typedef struct
+{
+    unsigned worker_count;
+    unsigned tile_size;
+    unsigned max_attempts;
+} distributed_options_t;
+
+distributed_options_t distributed_options(unsigned worker_count);
+
+// Test hook, not for renders: workers exit without replying to the first
+// attempts at every tile, so each tile fails exactly that many times. Zero,
+// the default, disables it.
+void distributed_set_crash_attempts(unsigned attempts);
+
+canvas_t *distributed_render(const camera_t *c, world_t *w,
+                             const distributed_options_t *options);
+
+#endif
@@ -0,0 +1,32 @@
+// grid.h
+
+#ifndef GRID_H
+#define GRID_H
+
+#include "shapes.h"
+
+// A uniform grid over the children of a group, for many similar primitives
+// spread evenly through space, where a midpoint BVH leaves many straddlers
+// behind. Each cell lists the children whose box overlaps it, all packed
+// into one array that cell_start indexes; rays walk the cells they cross
+// with a 3D-DDA. Unbounded children, such as planes, are tested by every
+// ray. A grid is stale once its group's children change and is rebuilt by
+// group_warm_bounds before the next render; until then the group tests
+// every child.
+struct grid_s
+{
+    bounding_box_t box;
+    unsigned resolution[3];
+    double cell_size[3];
+    unsigned *cell_start;
+    shape_t **cell_children;
+    shape_t **unbounded;
+    unsigned unbounded_count;
+    bool stale;
+};
+
+grid_t *grid_build(const group_t *g);
+void grid_free(grid_t *grid);
+void grid_intersect(const grid_t *grid, ray_t r, intersections_t *xs);
+
+#endif
@@ -0,0 +1,50 @@
+// hot_path.h
+
+#ifndef HOT_PATH_H
+#define HOT_PATH_H
+
+// The per-ray path (intersection, shading, lighting) must not allocate or
+// write to shared scene state, since every OpenMP thread runs it at once.
+// Configuring with -DRT_HOT_PATH_CHECKS=ON turns that rule into checks:
+// camera rendering brackets its parallel loops with hot_path_begin and
+// hot_path_end, which abort if malloc, calloc or realloc was called in
+// between, and hot_path_shared_write aborts if it is reached inside them.
+// Allocations between hot_path_amortized_begin and hot_path_amortized_end
+// on the same thread are not counted; they are for per-thread buffers that
+// only grow the first few times they overflow. In normal builds all of
+// these compile to nothing.
+
+#ifdef RT_HOT_PATH_CHECKS
+void hot_path_begin(void);
+void hot_path_end(void);
+void hot_path_shared_write(const char *what);
+void hot_path_amortized_begin(void);
+void hot_path_amortized_end(void);
+#else
+static inline void hot_path_begin(void)
+{
+}
+
+static inline void hot_path_end(void)
+{
+}
+
+static inline void hot_path_shared_write(const char *what)
+{
+    (void)what;
+}
+
+static inline void hot_path_amortized_begin(void)
+{
+}
+
+static inline void hot_path_amortized_end(void)
+{
+}
+#endif
+
+// Number of allocations made since the last hot_path_begin; always 0
+// unless the checks are compiled in.
+unsigned long hot_path_allocations(void);
+
+#endif
@@ -10,21 +10,26 @@
 
 typedef struct
 {
-    double t;
+    real_t t;
     void *object;
-    double u;
-    double v;
+    void *instance;
+    real_t u;
+    real_t v;
 } intersection_t;
 
+// A growable list of hits. Intersection functions append to a list passed
+// by pointer, so it is never copied and a ray may cross any number of
+// surfaces. Rendering reuses per-thread lists from intersections_scratch.
 typedef struct
 {
     int count;
-    intersection_t intersections[MAX_INTERSECTIONS];
+    int capacity;
+    intersection_t *intersections;
 } intersections_t;
 
 typedef struct
 {
-    double t;
+    real_t t;
     void *object;
     tuple_t point;
     tuple_t eyev;
@@ -49,15 +54,45 @@ computations_t intersections_prepare_computations(const intersection_t *i,
                                                   const ray_t *r,
                                                   const intersections_t *xs);
 
+void intersections_refractive_indices(const intersection_t *hit,
+                                      const intersections_t *xs, double *n1,
+                                      double *n2);
+
 double intersections_shlick(const computations_t *c);
 
 void intersections_sort(intersections_t *xs);
 
+// Drops the hits from index from onwards that repeat the object and exact
+// distance of an earlier hit, as a shape tested twice for one ray reports.
+void intersections_drop_repeats(intersections_t *xs, int from);
+
+bool intersections_reserve(intersections_t *xs, int capacity);
+bool intersections_grow(intersections_t *xs);
+void intersections_free(intersections_t *xs);
+
+// Each thread has one scratch list per recursion level of world_color_at,
+// plus one for shadow rays, so nested rays never overwrite a list still in
+// use. intersections_scratch_reserve gives the calling thread's lists their
+// initial capacity, so that allocation happens before a render starts.
+#define INTERSECTIONS_SHADOW_SCRATCH (MAX_RECURSION + 1)
+
+intersections_t *intersections_scratch(unsigned level);
+void intersections_scratch_reserve(void);
+
 static inline intersections_t empty_intersections(void)
 {
-    intersections_t result;
-    result.count = 0;
+    intersections_t result = {0, 0, NULL};
     return result;
 }
 
+static inline void intersections_add(intersections_t *xs, intersection_t x)
+{
+    if (__builtin_expect(xs->count == xs->capacity, 0) &&
+        !intersections_grow(xs))
+    {
+        return;
+    }
+    xs->intersections[xs->count++] = x;
+}
+
 #endif
@@ -26,6 +26,20 @@ typedef struct
     int vsteps;
     int samples;
     sequence_t jitter_by;
+
+    // With patterns above zero, samples are jittered by that many patterns
+    // generated from jitter_seed instead of by jitter_by, and each pixel is
+    // shaded with the pattern lights_select_pixel picks for it.
+    int patterns;
+    uint32_t jitter_seed;
+
+    // Sample positions as separate x, y and z arrays of sample_count
+    // entries, samples per pattern, filled by lights_prepare_samples before
+    // a render; NULL until then.
+    double *sample_x;
+    double *sample_y;
+    double *sample_z;
+    size_t sample_count;
 } light_t;
 
 light_t lights_point_light(const tuple_t position, const tuple_t intensity);
@@ -36,4 +50,25 @@ light_t lights_area_light(const tuple_t corner, const tuple_t full_uvec,
 
 tuple_t lights_point_on_light(const light_t *light, const int u, const int v);
 
+// Gives an area light patterns stratified jitter patterns in place of
+// jitter_by: every pattern keeps one sample in each cell of the light, at
+// offsets hashed from seed, the pattern and the sample. Neighbouring pixels
+// use different patterns, so undersampled soft shadows turn into fine noise
+// instead of bands.
+bool lights_set_stratified_jitter(light_t *light, int patterns,
+                                  uint32_t seed);
+
+// Selects the jitter pattern the calling thread shades pixel (px, py) with.
+void lights_select_pixel(unsigned px, unsigned py);
+
+// The index in the light's sample table of the first sample of the pattern
+// the calling thread shades with.
+int lights_sample_offset(const light_t *light);
+
+// Fills the light's sample table with every pattern's sample positions, so
+// shading and shadow rays read them from contiguous arrays. Call it again
+// after changing the light's geometry or jitter.
+bool lights_prepare_samples(light_t *light);
+void lights_free_samples(light_t *light);
+
 #endif
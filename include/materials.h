@@ -25,4 +25,24 @@ typedef struct
 
 material_t material(void);
 
+// x raised to y for x in (0, 1] and y > 0, from a polynomial log2 and exp2
+// accurate to about 1e-8 relative, so the specular term vectorises where a
+// call to pow() would not.
+double materials_pow(double x, double y);
+
+// Sums the diffuse and specular factors of count light samples, given as
+// separate x, y and z arrays, lighting point p: each sample facing the
+// surface adds its light_dot_normal to *diffuse and its reflect_dot_eye
+// raised to shininess to *specular.
+void materials_phong_samples(const double *x, const double *y,
+                             const double *z, int count, tuple_t p,
+                             tuple_t eyev, tuple_t normalv, double shininess,
+                             double *diffuse, double *specular);
+
+// The diffuse and specular factors of a light at p, averaged over its
+// samples; read from the light's sample table when it has one.
+void materials_light_factors(const light_t *l, tuple_t p, tuple_t eyev,
+                             tuple_t normalv, double shininess,
+                             double *diffuse, double *specular);
+
 #endif
@@ -8,57 +8,12 @@
 
 typedef struct
 {
-    double m[16];
+    real_t m[16];
 } matrix_t;
 
 extern const matrix_t IDENTITY;
 
-static inline matrix_t matrix_mul(const matrix_t a, const matrix_t b)
-{
-    matrix_t output;
-
-    // Row 0
-    output.m[0] =
-        a.m[0] * b.m[0] + a.m[1] * b.m[4] + a.m[2] * b.m[8] + a.m[3] * b.m[12];
-    output.m[1] =
-        a.m[0] * b.m[1] + a.m[1] * b.m[5] + a.m[2] * b.m[9] + a.m[3] * b.m[13];
-    output.m[2] =
-        a.m[0] * b.m[2] + a.m[1] * b.m[6] + a.m[2] * b.m[10] + a.m[3] * b.m[14];
-    output.m[3] =
-        a.m[0] * b.m[3] + a.m[1] * b.m[7] + a.m[2] * b.m[11] + a.m[3] * b.m[15];
-
-    // Row 1
-    output.m[4] =
-        a.m[4] * b.m[0] + a.m[5] * b.m[4] + a.m[6] * b.m[8] + a.m[7] * b.m[12];
-    output.m[5] =
-        a.m[4] * b.m[1] + a.m[5] * b.m[5] + a.m[6] * b.m[9] + a.m[7] * b.m[13];
-    output.m[6] =
-        a.m[4] * b.m[2] + a.m[5] * b.m[6] + a.m[6] * b.m[10] + a.m[7] * b.m[14];
-    output.m[7] =
-        a.m[4] * b.m[3] + a.m[5] * b.m[7] + a.m[6] * b.m[11] + a.m[7] * b.m[15];
-
-    // Row 2
-    output.m[8] = a.m[8] * b.m[0] + a.m[9] * b.m[4] + a.m[10] * b.m[8] +
-                  a.m[11] * b.m[12];
-    output.m[9] = a.m[8] * b.m[1] + a.m[9] * b.m[5] + a.m[10] * b.m[9] +
-                  a.m[11] * b.m[13];
-    output.m[10] = a.m[8] * b.m[2] + a.m[9] * b.m[6] + a.m[10] * b.m[10] +
-                   a.m[11] * b.m[14];
-    output.m[11] = a.m[8] * b.m[3] + a.m[9] * b.m[7] + a.m[10] * b.m[11] +
-                   a.m[11] * b.m[15];
-
-    // Row 3
-    output.m[12] = a.m[12] * b.m[0] + a.m[13] * b.m[4] + a.m[14] * b.m[8] +
-                   a.m[15] * b.m[12];
-    output.m[13] = a.m[12] * b.m[1] + a.m[13] * b.m[5] + a.m[14] * b.m[9] +
-                   a.m[15] * b.m[13];
-    output.m[14] = a.m[12] * b.m[2] + a.m[13] * b.m[6] + a.m[14] * b.m[10] +
-                   a.m[15] * b.m[14];
-    output.m[15] = a.m[12] * b.m[3] + a.m[13] * b.m[7] + a.m[14] * b.m[11] +
-                   a.m[15] * b.m[15];
-
-    return output;
-}
+matrix_t matrix_mul(const matrix_t a, const matrix_t b);
 
 static inline tuple_t matrix_tmul(const matrix_t a, const tuple_t b)
 {
@@ -20,7 +20,7 @@ static inline ray_t ray(const tuple_t origin, const tuple_t direction)
     return (ray_t){origin, direction};
 }
 
-static inline tuple_t ray_position(const ray_t ray, const double t)
+static inline tuple_t ray_position(const ray_t ray, const real_t t)
 {
     return tuple_add(ray.origin, tuple_scale(ray.direction, t));
 }
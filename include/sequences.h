@@ -4,18 +4,33 @@
 #define SEQUENCES_H
 
 #include "config.h"
+#include <stdint.h>
 
+// A cycle of values of any length, grown on the heap as values are added.
+// Whoever creates a sequence frees it with sequence_free.
 typedef struct
 {
-    double values[MAX_SEQUENCE_LENGTH];
+    double *values;
     int count;
+    int capacity;
     int current_index;
 } sequence_t;
 
 sequence_t sequence_new(void);
 void sequence_add(sequence_t *seq, double value);
 sequence_t sequence_from_array(const double *values, int count);
+sequence_t sequence_copy(const sequence_t *seq);
+void sequence_free(sequence_t *seq);
 double sequence_next(sequence_t *seq);
 double sequence_at(const sequence_t *seq, int index);
 
+// A value in [0, 1) hashed from seed and index, so any number of jitter
+// values can be generated without storing a sequence.
+double sequence_hash(uint32_t seed, uint32_t index);
+
+// A value in [0, 1) for pixel (px, py) from the R2 low-discrepancy sequence.
+// Neighbouring pixels get well separated values, so picking a jitter
+// pattern from it spreads the patterns like blue noise.
+double sequence_pixel_dither(unsigned px, unsigned py);
+
 #endif
\ No newline at end of file
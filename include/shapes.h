@@ -30,7 +30,9 @@ typedef enum
     SHAPE_CONE,
     SHAPE_TRIANGLE,
     SHAPE_SMOOTH_TRIANGLE,
-    SHAPE_GROUP
+    SHAPE_GROUP,
+    SHAPE_INSTANCE,
+    SHAPE_CLIPPED
 } shape_type_t;
 
 typedef struct
@@ -126,6 +128,22 @@ typedef struct
 
 typedef struct group_s group_t;
 
+// A uniform grid a group can use instead of testing each child; see
+// grid.h.
+typedef struct grid_s grid_t;
+
+// Hierarchy builders for group_t; see bvh.h. A group remembers the one it
+// was built with so a rebuild after refitting uses the same one.
+typedef enum
+{
+    BVH_BUILD_MIDPOINT,
+    BVH_BUILD_LBVH30,
+    BVH_BUILD_LBVH63,
+    BVH_BUILD_SAH,
+    BVH_BUILD_SBVH,
+    BVH_BUILDER_COUNT
+} bvh_builder_t;
+
 struct group_s
 {
     shape_type_t type;
@@ -142,39 +160,75 @@ struct group_s
     tuple_t cached_bounds_min;
     tuple_t cached_bounds_max;
     bool bounds_cached;
+    bool is_bvh_node;
+    unsigned build_threshold;
+    double build_cost;
+    bvh_builder_t builder;
+    grid_t *grid;
 };
 
+// A placement of a shared mesh. The mesh is not copied or re-parented, so
+// many instances can reference one built BVH; the caller keeps ownership of
+// the mesh and must free it after the world. Meshes may not contain
+// instances themselves.
+typedef struct
+{
+    shape_type_t type;
+    matrix_t transform;
+    matrix_t inverse_transform;
+    matrix_t transposed_inverse_transform;
+    material_t material;
+    void *parent;
+    bounding_box_t world_bounds;
+    bool world_bounds_cached;
+    shape_t *mesh;
+    bool material_override;
+} instance_t;
+
+// One of the pieces a spatial split cut a triangle into. Its world_bounds
+// are the piece's box; the whole triangle is intersected but only hits
+// inside the box are kept, and a hit another piece already reported is
+// dropped. Exactly one piece owns the triangle, which has that piece as its
+// parent and is freed with it.
+typedef struct
+{
+    shape_type_t type;
+    matrix_t transform;
+    matrix_t inverse_transform;
+    matrix_t transposed_inverse_transform;
+    material_t material;
+    void *parent;
+    bounding_box_t world_bounds;
+    bool world_bounds_cached;
+    shape_t *target;
+    bool owns_target;
+} clipped_t;
+
 void shape(shape_t *shape, const shape_type_t type);
 void shape_set_transform(shape_t *shape, const matrix_t m);
 tuple_t shape_normal_at(const shape_t *shape, const tuple_t world_point,
                         const intersection_t *hit);
 tuple_t normal_at(const void *shape, const tuple_t world_point,
                   const intersection_t *hit);
-intersections_t shape_intersect(const shape_t *shape, const ray_t r);
+void shape_intersect(const shape_t *shape, const ray_t r, intersections_t *xs);
 
 sphere_t sphere(void);
 sphere_t glass_sphere(void);
 void sphere_set_transform(sphere_t *s, matrix_t m);
-intersections_t sphere_intersect(const sphere_t *s, const ray_t r);
+void sphere_intersect(const sphere_t *s, const ray_t r, intersections_t *xs);
 
 plane_t plane(void);
 
-static inline intersections_t plane_intersect(const plane_t *p, ray_t r)
+static inline void plane_intersect(const plane_t *p, ray_t r,
+                                   intersections_t *xs)
 {
-    if (p == NULL)
-    {
-        return empty_intersections();
-    }
-
-    if (fabs(r.direction.y) < EPSILON)
+    if (p == NULL || xs == NULL || fabs(r.direction.y) < EPSILON)
     {
-        return empty_intersections();
+        return;
     }
 
-    double t = -r.origin.y / r.direction.y;
-
-    return (intersections_t){.count         = 1,
-                             .intersections = {intersection(t, (void *)p)}};
+    real_t t = -r.origin.y / r.direction.y;
+    intersections_add(xs, intersection(t, (void *)p));
 }
 
 tuple_t pattern_at_shape(pattern_t pattern, shape_t object,
@@ -204,66 +258,13 @@ static inline tuple_t materials_lighting(const material_t *m, const shape_t *o,
     tuple_t effective_color = tuple_hadamard(c, l->intensity);
     tuple_t ambient         = tuple_scale(effective_color, m->ambient);
 
-    tuple_t sum = color(0, 0, 0);
+    double diffuse, specular;
+    materials_light_factors(l, p, eyev, normalv, m->shininess, &diffuse,
+                            &specular);
 
-    if (l->type == LIGHT_POINT)
-    {
-        tuple_t light_vector    = tuple_subtract(l->position, p);
-        tuple_t lightv          = tuple_normalize(light_vector);
-        double light_dot_normal = tuple_dot(lightv, normalv);
-
-        if (light_dot_normal > 0)
-        {
-            tuple_t diffuse =
-                tuple_scale(effective_color, m->diffuse * light_dot_normal);
-            sum = tuple_add(sum, diffuse);
-
-            tuple_t reflectv = tuple_reflect(tuple_negate(lightv), normalv);
-            double reflect_dot_eye = tuple_dot(reflectv, eyev);
-
-            if (reflect_dot_eye > 0)
-            {
-                double factor = pow(reflect_dot_eye, m->shininess);
-                tuple_t specular =
-                    tuple_scale(l->intensity, m->specular * factor);
-                sum = tuple_add(sum, specular);
-            }
-        }
-    }
-    else if (l->type == LIGHT_AREA)
-    {
-        for (int v = 0; v < l->vsteps; v++)
-        {
-            for (int u = 0; u < l->usteps; u++)
-            {
-                tuple_t light_position =
-                    lights_point_on_light((light_t *)l, u, v);
-                tuple_t light_vector    = tuple_subtract(light_position, p);
-                tuple_t lightv          = tuple_normalize(light_vector);
-                double light_dot_normal = tuple_dot(lightv, normalv);
-
-                if (light_dot_normal > 0)
-                {
-                    tuple_t diffuse = tuple_scale(
-                        effective_color, m->diffuse * light_dot_normal);
-                    sum = tuple_add(sum, diffuse);
-
-                    tuple_t reflectv =
-                        tuple_reflect(tuple_negate(lightv), normalv);
-                    double reflect_dot_eye = tuple_dot(reflectv, eyev);
-
-                    if (reflect_dot_eye > 0)
-                    {
-                        double factor = pow(reflect_dot_eye, m->shininess);
-                        tuple_t specular =
-                            tuple_scale(l->intensity, m->specular * factor);
-                        sum = tuple_add(sum, specular);
-                    }
-                }
-            }
-        }
-        sum = tuple_scale(sum, 1.0 / l->samples);
-    }
+    tuple_t sum =
+        tuple_add(tuple_scale(effective_color, m->diffuse * diffuse),
+                  tuple_scale(l->intensity, m->specular * specular));
 
     sum = tuple_scale(sum, intensity);
 
@@ -273,24 +274,55 @@ static inline tuple_t materials_lighting(const material_t *m, const shape_t *o,
 cube_t cube(void);
 
 cylinder_t cylinder(void);
-intersections_t cylinder_intersect(const cylinder_t *c, ray_t r);
+void cylinder_intersect(const cylinder_t *c, ray_t r, intersections_t *xs);
 
 cone_t cone(void);
-intersections_t cone_intersect(const cone_t *c, ray_t r);
+void cone_intersect(const cone_t *c, ray_t r, intersections_t *xs);
 
 triangle_t triangle(tuple_t p1, tuple_t p2, tuple_t p3);
-intersections_t triangle_intersect(const triangle_t *t, ray_t r);
+void triangle_set_points(triangle_t *t, tuple_t p1, tuple_t p2, tuple_t p3);
+void triangle_intersect(const triangle_t *t, ray_t r, intersections_t *xs);
 
 smooth_triangle_t smooth_triangle(tuple_t p1, tuple_t p2, tuple_t p3,
                                   tuple_t n1, tuple_t n2, tuple_t n3);
-intersections_t smooth_triangle_intersect(const smooth_triangle_t *t, ray_t r);
+void smooth_triangle_intersect(const smooth_triangle_t *t, ray_t r,
+                               intersections_t *xs);
 
 group_t *group(void);
 void group_free(group_t *g);
+void group_free_children(group_t *g);
 void group_add_child(group_t *g, shape_t *s);
 bool group_includes(const group_t *g, const shape_t *s);
-intersections_t group_intersect(const group_t *g, ray_t r);
-intersections_t group_local_intersect(const group_t *g, ray_t r);
+void group_invalidate_bounds_cache(group_t *g);
+void group_refit(group_t *g);
+void group_warm_bounds(group_t *g);
+double group_sah_cost(const group_t *g);
+bool group_refit_or_rebuild(group_t *g);
+bool group_build_grid(group_t *g);
+void group_clear_grid(group_t *g);
+void group_intersect(const group_t *g, ray_t r, intersections_t *xs);
+void group_local_intersect(const group_t *g, ray_t r, intersections_t *xs);
+
+instance_t instance(shape_t *mesh);
+void instance_set_material(instance_t *i, material_t m);
+void instance_intersect(const instance_t *i, ray_t r, intersections_t *xs);
+
+clipped_t *clipped(shape_t *target, bounding_box_t box, bool owns_target);
+void clipped_free(clipped_t *c);
+void clipped_intersect(const clipped_t *c, ray_t r, intersections_t *xs);
+
+// The shape whose material shades an intersection: the instance when it
+// overrides the material of its mesh, otherwise the primitive that was hit.
+static inline const shape_t *
+intersection_material_shape(const intersection_t *i)
+{
+    const instance_t *inst = (const instance_t *)i->instance;
+    if (inst != NULL && inst->material_override)
+    {
+        return (const shape_t *)inst;
+    }
+    return (const shape_t *)i->object;
+}
 
 tuple_t world_to_object(const shape_t *shape, tuple_t point);
 tuple_t normal_to_world(const shape_t *shape, tuple_t normal);
@@ -313,13 +345,13 @@ void divide_recursive(shape_t *shape, unsigned threshold, unsigned max_depth);
 
 #define group_is_empty(g) ((g)->child_count == 0)
 
-static inline void check_axis(const double origin, const double direction,
-                              double *tmin, double *tmax)
+static inline void check_axis(const real_t origin, const real_t direction,
+                              real_t *tmin, real_t *tmax)
 {
-    double tmin_numerator = (-1 - origin);
-    double tmax_numerator = (1 - origin);
+    real_t tmin_numerator = (-1 - origin);
+    real_t tmax_numerator = (1 - origin);
 
-    if (fabs(direction) >= EPSILON)
+    if (real_fabs(direction) >= EPSILON)
     {
         *tmin = tmin_numerator / direction;
         *tmax = tmax_numerator / direction;
@@ -332,15 +364,15 @@ static inline void check_axis(const double origin, const double direction,
 
     if (*tmin > *tmax)
     {
-        double temp = *tmin;
+        real_t temp = *tmin;
         *tmin       = *tmax;
         *tmax       = temp;
     }
 }
 
-intersections_t cube_intersect(const cube_t *c, ray_t r);
+void cube_intersect(const cube_t *c, ray_t r, intersections_t *xs);
 
 test_shape_t test_shape(void);
-intersections_t test_shape_intersect(test_shape_t *t, ray_t r);
+void test_shape_intersect(test_shape_t *t, ray_t r, intersections_t *xs);
 
 #endif
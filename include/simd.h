@@ -0,0 +1,100 @@
+// simd.h
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdbool.h>
+
+typedef enum
+{
+    SIMD_ISA_GENERIC,
+    SIMD_ISA_SSE42,
+    SIMD_ISA_AVX2,
+    SIMD_ISA_AVX512,
+    SIMD_ISA_COUNT
+} simd_isa_t;
+
+// Index into every kernel's variant table. Chosen once at startup from
+// CPUID, or from the RT_ISA environment variable (generic, sse4.2, avx2 or
+// avx512) when it names an instruction set this CPU supports.
+extern simd_isa_t simd_active_isa;
+
+simd_isa_t simd_detect_isa(void);
+bool simd_set_isa(simd_isa_t isa);
+const char *simd_isa_name(simd_isa_t isa);
+
+// Kernel bodies are force-inlined into each variant so every copy is
+// compiled for that variant's instruction set.
+#define SIMD_KERNEL static inline __attribute__((always_inline))
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_TARGET_SSE42  __attribute__((target("sse4.2,popcnt")))
+#define SIMD_TARGET_AVX2   __attribute__((target("avx2,fma,bmi2")))
+#define SIMD_TARGET_AVX512                                                     \
+    __attribute__((target("avx512f,avx512vl,avx512dq,avx2,fma")))
+
+// Defines name_generic, name_sse42, name_avx2 and name_avx512 around the
+// inline kernel body name##_impl, so the body is compiled once per ISA, and
+// a public name() that calls the variant selected at startup.
+#define SIMD_DISPATCH(ret, name, params, args)                                 \
+    static ret name##_generic params                                           \
+    {                                                                          \
+        return name##_impl args;                                               \
+    }                                                                          \
+    SIMD_TARGET_SSE42 static ret name##_sse42 params                           \
+    {                                                                          \
+        return name##_impl args;                                               \
+    }                                                                          \
+    SIMD_TARGET_AVX2 static ret name##_avx2 params                             \
+    {                                                                          \
+        return name##_impl args;                                               \
+    }                                                                          \
+    SIMD_TARGET_AVX512 static ret name##_avx512 params                         \
+    {                                                                          \
+        return name##_impl args;                                               \
+    }                                                                          \
+    static ret(*const name##_variants[SIMD_ISA_COUNT]) params = {              \
+        name##_generic, name##_sse42, name##_avx2, name##_avx512};             \
+    ret name params                                                            \
+    {                                                                          \
+        return name##_variants[simd_active_isa] args;                          \
+    }
+
+// The same for kernels without a result.
+#define SIMD_DISPATCH_VOID(name, params, args)                                 \
+    static void name##_generic params                                          \
+    {                                                                          \
+        name##_impl args;                                                      \
+    }                                                                          \
+    SIMD_TARGET_SSE42 static void name##_sse42 params                          \
+    {                                                                          \
+        name##_impl args;                                                      \
+    }                                                                          \
+    SIMD_TARGET_AVX2 static void name##_avx2 params                            \
+    {                                                                          \
+        name##_impl args;                                                      \
+    }                                                                          \
+    SIMD_TARGET_AVX512 static void name##_avx512 params                        \
+    {                                                                          \
+        name##_impl args;                                                      \
+    }                                                                          \
+    static void(*const name##_variants[SIMD_ISA_COUNT]) params = {             \
+        name##_generic, name##_sse42, name##_avx2, name##_avx512};             \
+    void name params                                                           \
+    {                                                                          \
+        name##_variants[simd_active_isa] args;                                 \
+    }
+#else
+#define SIMD_DISPATCH(ret, name, params, args)                                 \
+    ret name params                                                            \
+    {                                                                          \
+        return name##_impl args;                                               \
+    }
+#define SIMD_DISPATCH_VOID(name, params, args)                                 \
+    void name params                                                           \
+    {                                                                          \
+        name##_impl args;                                                      \
+    }
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+// stats.h
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "config.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum
+{
+    STAT_CAMERA_RAYS,
+    STAT_SHADOW_RAYS,
+    STAT_SCENE_RAYS,
+    STAT_BOUNDS_TESTS,
+    STAT_NODE_VISITS,
+    STAT_PRIMITIVE_TESTS,
+    STAT_HIT_BUFFER_GROWTHS,
+    STAT_COUNT
+} stat_t;
+
+typedef struct
+{
+    uint64_t counts[STAT_COUNT];
+} stats_t;
+
+// Counters are only compiled in when configured with -DRT_STATS=ON; every
+// STATS_ADD is otherwise removed, arguments included. Each thread counts
+// into its own cache-line-sized slot, claimed on its first count and
+// released, counts kept, when the thread exits, so the hot path never
+// writes a line another thread is using. Threads beyond STATS_MAX_THREADS
+// alive at once are not counted.
+#ifdef RT_STATS
+typedef struct
+{
+    _Alignas(STATS_CACHE_LINE) uint64_t counts[STAT_COUNT];
+} stats_slot_t;
+
+extern _Thread_local stats_slot_t *stats_thread_slot;
+stats_slot_t *stats_claim_slot(void);
+
+#define STATS_ADD(stat, n)                                                     \
+    do                                                                         \
+    {                                                                          \
+        if (__builtin_expect(stats_thread_slot == NULL, 0))                    \
+        {                                                                      \
+            stats_thread_slot = stats_claim_slot();                            \
+        }                                                                      \
+        stats_thread_slot->counts[stat] += (uint64_t)(n);                      \
+    } while (0)
+#else
+#define STATS_ADD(stat, n) ((void)0)
+#endif
+
+bool stats_enabled(void);
+void stats_reset(void);
+stats_t stats_collect(void);
+const char *stats_name(stat_t stat);
+void stats_print(const stats_t *s, FILE *file);
+void stats_write_json(const stats_t *s, FILE *file);
+
+// Called around a whole render: resets the counters, then sums, prints and
+// (when RT_STATS_JSON names a file) writes them as JSON. No-ops unless
+// counters are compiled in.
+void stats_begin_render(void);
+void stats_end_render(void);
+
+#endif
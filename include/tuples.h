@@ -11,7 +11,7 @@
 
 typedef struct
 {
-    double x, y, z, w;
+    real_t x, y, z, w;
 } tuple_t;
 
 static inline tuple_t vector(const double x, const double y, const double z)
@@ -50,28 +50,28 @@ static inline tuple_t tuple_negate(const tuple_t a)
     return (tuple_t){-a.x, -a.y, -a.z, -a.w};
 }
 
-static inline tuple_t tuple_scale(const tuple_t a, const double n)
+static inline tuple_t tuple_scale(const tuple_t a, const real_t n)
 {
     return (tuple_t){a.x * n, a.y * n, a.z * n, a.w * n};
 }
 
-static inline tuple_t tuple_scalar_divide(const tuple_t a, const double n)
+static inline tuple_t tuple_scalar_divide(const tuple_t a, const real_t n)
 {
-    if (fabs(n) < EPSILON)
+    if (real_fabs(n) < EPSILON)
     {
         return (tuple_t){0.0, 0.0, 0.0, 0.0};
     }
     return (tuple_t){a.x / n, a.y / n, a.z / n, a.w / n};
 }
 
-static inline double tuple_magnitude(const tuple_t a)
+static inline real_t tuple_magnitude(const tuple_t a)
 {
-    return sqrt(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w);
+    return real_sqrt(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w);
 }
 
 static inline tuple_t tuple_normalize(const tuple_t a)
 {
-    double mag = tuple_magnitude(a);
+    real_t mag = tuple_magnitude(a);
     if (mag > EPSILON)
     {
         return tuple_scale(a, 1 / mag);
@@ -79,7 +79,7 @@ static inline tuple_t tuple_normalize(const tuple_t a)
     return (tuple_t){0.0, 0.0, 0.0, 0.0};
 }
 
-static inline double tuple_dot(const tuple_t a, const tuple_t b)
+static inline real_t tuple_dot(const tuple_t a, const tuple_t b)
 {
     return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
 }
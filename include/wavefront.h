@@ -0,0 +1,62 @@
+// wavefront.h
+
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include "camera.h"
+#include <stdint.h>
+
+// Wavefront rendering traces a tile one bounce at a time instead of
+// recursing from each hit. Every bounce's rays are collected into a stream,
+// sorted so rays leaving the same region in the same direction octant run
+// one after another, and intersected as a batch; the hits are then sorted
+// by material and shaded in a separate pass that adds their direct light to
+// the pixels and emits the next bounce's reflected and refracted rays. Each
+// ray carries the weight the recursive tracer would scale its colour by, so
+// the image matches world_color_at up to rounding.
+typedef struct
+{
+    ray_t ray;
+    double weight;
+    unsigned pixel;
+    unsigned remaining;
+    uint32_t key;
+} wavefront_ray_t;
+
+// A compact record of a stream ray's hit, from which the shading pass
+// rebuilds the full computations. The refractive indices are resolved while
+// the ray's hit list is still at hand. Hits are shaded in order of key,
+// which groups them by pattern and then by material shape, so consecutive
+// shading calls take the same branches over the same material data.
+typedef struct
+{
+    intersection_t hit;
+    double n1;
+    double n2;
+    unsigned ray;
+    uint32_t key;
+} wavefront_hit_t;
+
+// The sort key of a ray: the Morton code of its origin's cell within
+// origins, above the octant of its direction.
+uint32_t wavefront_sort_key(const ray_t *r, bounding_box_t origins);
+
+// The shading order key of a hit: its pattern type, or none, above a hash
+// of the shape whose material it uses.
+uint32_t wavefront_material_key(const intersection_t *hit);
+
+// Sorts rays by key in ascending order, keeping the order of equal keys;
+// temp must hold count rays.
+void wavefront_sort(wavefront_ray_t *rays, wavefront_ray_t *temp,
+                    size_t count);
+
+// Gives the calling thread's streams their initial capacity, so that
+// allocation happens before a render starts.
+void wavefront_reserve(void);
+
+// Renders the camera pixels inside r like camera_render_rect, in tiles of
+// WAVEFRONT_TILE_SIZE pixels.
+bool wavefront_render(const camera_t *c, const world_t *w, render_region_t r,
+                      canvas_t *dst, unsigned dst_x, unsigned dst_y);
+
+#endif
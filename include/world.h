@@ -18,6 +18,7 @@ typedef union
     triangle_t triangle;
     smooth_triangle_t smooth_triangle;
     group_t group;
+    instance_t instance;
 } object_t;
 
 typedef struct
@@ -36,8 +37,25 @@ world_t world_default(void);
 
 void world_free(world_t *w);
 
+// Computes every lazily cached group bound before a render, so the render
+// threads never write to the scene.
+void world_warm_bounds(world_t *w);
+
+// Fills every light's sample table before a render; lights keep the
+// tables until world_free.
+void world_prepare_lights(world_t *w);
+
+// Warms the bounds and fills the light tables. Call it from one thread,
+// before any thread of a render starts; the rendering entry points that
+// take a world_t * do so themselves.
+void world_prepare(world_t *w);
+
 void world_intersect(const world_t *w, const ray_t *r, intersections_t *xs);
 
+// The light a hit receives directly from every light, without the
+// reflected and refracted rays world_shade_hit adds to it.
+tuple_t world_direct_light(const world_t *w, const computations_t *c);
+
 tuple_t world_shade_hit(const world_t *w, const computations_t *c,
                         const unsigned remaining);
 
@@ -52,6 +70,9 @@ void world_add_cylinder(world_t *w, cylinder_t c);
 void world_add_triangle(world_t *w, triangle_t t);
 void world_add_smooth_triangle(world_t *w, smooth_triangle_t t);
 void world_add_group(world_t *w, group_t *g);
+void world_add_instance(world_t *w, instance_t i);
+// Adds a copy of light; its jitter_by values are copied too, so the caller
+// still frees its own.
 void world_add_light(world_t *w, light_t light);
 
 tuple_t world_reflected_color(const world_t *w, const computations_t *c,
@@ -60,6 +81,15 @@ tuple_t world_reflected_color(const world_t *w, const computations_t *c,
 tuple_t world_refracted_color(const world_t *w, const computations_t *c,
                               const unsigned remaining);
 
+// The secondary rays world_reflected_color and world_refracted_color trace;
+// false when the material or remaining depth spawns none, or on total
+// internal reflection.
+bool world_reflected_ray(const computations_t *c, const unsigned remaining,
+                         ray_t *out);
+
+bool world_refracted_ray(const computations_t *c, const unsigned remaining,
+                         ray_t *out);
+
 double lights_intensity_at(const light_t *light, const tuple_t point,
                            const world_t *world);
 
@@ -0,0 +1,257 @@
+// animation.c
+
+#include "../include/animation.h"
+#include "../include/dynamic_array.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+animation_t animation(camera_t base)
+{
+    animation_t a = {0};
+    a.camera      = base;
+    return a;
+}
+
+void animation_free(animation_t *a)
+{
+    if (a == NULL)
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < a->track_count; i++)
+    {
+        free(a->tracks[i].keys);
+    }
+    free(a->tracks);
+    free(a->camera_keys);
+    *a = animation(a->camera);
+}
+
+static bool camera_keys_ensure_capacity(animation_t *a)
+{
+    DYN_ARRAY_ENSURE_CAPACITY_IMPL(a->camera_keys, a->camera_key_count,
+                                   a->camera_key_capacity, camera_keyframe_t,
+                                   MAX_ANIMATION_KEYS);
+    return true;
+}
+
+static bool tracks_ensure_capacity(animation_t *a)
+{
+    DYN_ARRAY_ENSURE_CAPACITY_IMPL(a->tracks, a->track_count,
+                                   a->track_capacity, object_track_t,
+                                   MAX_NUM_OBJECTS);
+    return true;
+}
+
+static bool track_keys_ensure_capacity(object_track_t *t)
+{
+    DYN_ARRAY_ENSURE_CAPACITY_IMPL(t->keys, t->key_count, t->key_capacity,
+                                   transform_keyframe_t, MAX_ANIMATION_KEYS);
+    return true;
+}
+
+bool animation_add_camera_key(animation_t *a, double time, tuple_t from,
+                              tuple_t to, tuple_t up)
+{
+    if (a == NULL || !camera_keys_ensure_capacity(a))
+    {
+        return false;
+    }
+
+    // Keep keys sorted by time so lookups can stop at the first later key.
+    unsigned i = a->camera_key_count;
+    while (i > 0 && a->camera_keys[i - 1].time > time)
+    {
+        a->camera_keys[i] = a->camera_keys[i - 1];
+        i--;
+    }
+    a->camera_keys[i] = (camera_keyframe_t){time, from, to, up};
+    a->camera_key_count++;
+    return true;
+}
+
+bool animation_add_object_key(animation_t *a, shape_t *shape, double time,
+                              tuple_t translation, tuple_t rotation,
+                              tuple_t scale)
+{
+    if (a == NULL || shape == NULL)
+    {
+        return false;
+    }
+
+    object_track_t *track = NULL;
+    for (unsigned i = 0; i < a->track_count; i++)
+    {
+        if (a->tracks[i].shape == shape)
+        {
+            track = &a->tracks[i];
+            break;
+        }
+    }
+
+    if (track == NULL)
+    {
+        if (!tracks_ensure_capacity(a))
+        {
+            return false;
+        }
+        track = &a->tracks[a->track_count++];
+        memset(track, 0, sizeof(*track));
+        track->shape = shape;
+    }
+
+    if (!track_keys_ensure_capacity(track))
+    {
+        return false;
+    }
+
+    unsigned i = track->key_count;
+    while (i > 0 && track->keys[i - 1].time > time)
+    {
+        track->keys[i] = track->keys[i - 1];
+        i--;
+    }
+    track->keys[i] =
+        (transform_keyframe_t){time, translation, rotation, scale};
+    track->key_count++;
+    return true;
+}
+
+static tuple_t tuple_lerp(tuple_t a, tuple_t b, double f)
+{
+    return tuple_add(a, tuple_scale(tuple_subtract(b, a), f));
+}
+
+// Blend factor between two keys; times outside the keyed range hold the
+// first or last key.
+static double keyframe_blend(double t0, double t1, double time)
+{
+    if (t1 <= t0)
+    {
+        return 0.0;
+    }
+    return fmin(1.0, fmax(0.0, (time - t0) / (t1 - t0)));
+}
+
+static matrix_t keyframe_transform(const transform_keyframe_t *k)
+{
+    matrix_t rotation =
+        matrix_mul(transform_rotation_x(k->rotation.x),
+                   matrix_mul(transform_rotation_y(k->rotation.y),
+                              transform_rotation_z(k->rotation.z)));
+    return matrix_mul(
+        transform_translation(k->translation.x, k->translation.y,
+                              k->translation.z),
+        matrix_mul(rotation,
+                   transform_scaling(k->scale.x, k->scale.y, k->scale.z)));
+}
+
+unsigned animation_apply(animation_t *a, double time)
+{
+    if (a == NULL)
+    {
+        return 0;
+    }
+
+    unsigned updated = 0;
+
+    if (a->camera_key_count > 0)
+    {
+        unsigned i = 0;
+        while (i + 1 < a->camera_key_count &&
+               a->camera_keys[i + 1].time <= time)
+        {
+            i++;
+        }
+        const camera_keyframe_t *k0 = &a->camera_keys[i];
+        const camera_keyframe_t *k1 =
+            &a->camera_keys[i + 1 < a->camera_key_count ? i + 1 : i];
+        double f = keyframe_blend(k0->time, k1->time, time);
+
+        camera_set_transform(&a->camera,
+                             transform_view(tuple_lerp(k0->from, k1->from, f),
+                                            tuple_lerp(k0->to, k1->to, f),
+                                            tuple_lerp(k0->up, k1->up, f)));
+    }
+
+    for (unsigned t = 0; t < a->track_count; t++)
+    {
+        object_track_t *track = &a->tracks[t];
+        if (track->key_count == 0)
+        {
+            continue;
+        }
+
+        unsigned i = 0;
+        while (i + 1 < track->key_count && track->keys[i + 1].time <= time)
+        {
+            i++;
+        }
+        const transform_keyframe_t *k0 = &track->keys[i];
+        const transform_keyframe_t *k1 =
+            &track->keys[i + 1 < track->key_count ? i + 1 : i];
+        double f = keyframe_blend(k0->time, k1->time, time);
+
+        transform_keyframe_t k = {
+            time, tuple_lerp(k0->translation, k1->translation, f),
+            tuple_lerp(k0->rotation, k1->rotation, f),
+            tuple_lerp(k0->scale, k1->scale, f)};
+        matrix_t m = keyframe_transform(&k);
+
+        // Objects holding still between frames keep their inverse matrices
+        // and cached bounds untouched; moved ones mark their parent groups
+        // dirty.
+        if (track->has_applied && matrix_equal(track->applied, m))
+        {
+            continue;
+        }
+
+        shape_set_transform(track->shape, m);
+        track->applied     = m;
+        track->has_applied = true;
+        updated++;
+    }
+
+    return updated;
+}
+
+bool animation_render(animation_t *a, world_t *w, unsigned frame_count,
+                      double frames_per_second, const char *path_prefix)
+{
+    if (a == NULL || w == NULL || path_prefix == NULL ||
+        frames_per_second <= 0)
+    {
+        printf("Invalid parameters for animation_render\n");
+        return false;
+    }
+
+    // Frames render back to back in this process, so the world, its meshes
+    // and the OpenMP thread pool are all set up once for the whole sequence.
+    for (unsigned frame = 0; frame < frame_count; frame++)
+    {
+        unsigned updated = animation_apply(a, frame / frames_per_second);
+        printf("Frame %u/%u (%u objects moved)\n", frame + 1, frame_count,
+               updated);
+
+        canvas_t *image = camera_render(&a->camera, w);
+        if (!image)
+        {
+            return false;
+        }
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s%04u.ppm", path_prefix, frame);
+        bool saved = canvas_save(image, path);
+        canvas_free(image);
+
+        if (!saved)
+        {
+            printf("Failed to save frame %u\n", frame);
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -1,11 +1,13 @@
 // bounds.c
 
 #include "../include/bounds.h"
+#include "../include/hot_path.h"
+#include "../include/simd.h"
 
 bounding_box_t bounding_box_empty(void)
 {
-    return (bounding_box_t){point(DBL_MAX, DBL_MAX, DBL_MAX),
-                            point(-DBL_MAX, -DBL_MAX, -DBL_MAX)};
+    return (bounding_box_t){point(REAL_MAX, REAL_MAX, REAL_MAX),
+                            point(-REAL_MAX, -REAL_MAX, -REAL_MAX)};
 }
 
 bounding_box_t bounding_box(tuple_t min, tuple_t max)
@@ -46,31 +48,35 @@ bounding_box_t bounds_of(const void *shape_ptr)
         break;
 
     case SHAPE_PLANE:
-        return (bounding_box_t){point(-DBL_MAX, 0, -DBL_MAX),
-                                point(DBL_MAX, 0, DBL_MAX)};
+        return (bounding_box_t){point(-REAL_MAX, 0, -REAL_MAX),
+                                point(REAL_MAX, 0, REAL_MAX)};
         break;
 
     case SHAPE_CUBE:
         return (bounding_box_t){point(-1, -1, -1), point(1, 1, 1)};
         break;
 
+    // Open cylinders and cones are clamped to REAL_MAX so their bounds stay
+    // finite when real_t is narrower than their double extents.
     case SHAPE_CYLINDER:
     {
         cylinder_t *cyl = (cylinder_t *)shape_ptr;
-        return (bounding_box_t){point(-1, cyl->minimum, -1),
-                                point(1, cyl->maximum, 1)};
+        double minimum  = fmax(cyl->minimum, -REAL_MAX);
+        double maximum  = fmin(cyl->maximum, REAL_MAX);
+        return (bounding_box_t){point(-1, minimum, -1),
+                                point(1, maximum, 1)};
     }
     break;
 
     case SHAPE_CONE:
     {
-        cone_t *cone = (cone_t *)shape_ptr;
-        double a     = fabs(cone->minimum);
-        double b     = fabs(cone->maximum);
-        double limit = fmax(a, b);
+        cone_t *cone   = (cone_t *)shape_ptr;
+        double minimum = fmax(cone->minimum, -REAL_MAX);
+        double maximum = fmin(cone->maximum, REAL_MAX);
+        double limit   = fmax(fabs(minimum), fabs(maximum));
 
-        return (bounding_box_t){point(-limit, cone->minimum, -limit),
-                                point(limit, cone->maximum, limit)};
+        return (bounding_box_t){point(-limit, minimum, -limit),
+                                point(limit, maximum, limit)};
     }
     break;
 
@@ -90,6 +96,15 @@ bounding_box_t bounds_of(const void *shape_ptr)
         return bounds_of_group(shape_ptr);
         break;
 
+    case SHAPE_INSTANCE:
+        return bounds_parent_space_bounds_of(
+            ((const instance_t *)shape_ptr)->mesh);
+        break;
+
+    case SHAPE_CLIPPED:
+        return ((const clipped_t *)shape_ptr)->world_bounds;
+        break;
+
     default:
         return box;
         break;
@@ -129,6 +144,23 @@ bool bounds_box_contains_box(bounding_box_t box1, bounding_box_t box2)
            bounds_box_contains_point(box1, box2.max);
 }
 
+bool bounds_is_empty(bounding_box_t box)
+{
+    return box.min.x > box.max.x || box.min.y > box.max.y ||
+           box.min.z > box.max.z;
+}
+
+// The part of space inside both boxes; its min exceeds its max on some axis
+// when they do not meet.
+bounding_box_t bounds_intersection(bounding_box_t box1, bounding_box_t box2)
+{
+    return (bounding_box_t){
+        point(fmax(box1.min.x, box2.min.x), fmax(box1.min.y, box2.min.y),
+              fmax(box1.min.z, box2.min.z)),
+        point(fmin(box1.max.x, box2.max.x), fmin(box1.max.y, box2.max.y),
+              fmin(box1.max.z, box2.max.z))};
+}
+
 bounding_box_t bounds_transform(bounding_box_t bbox, matrix_t matrix)
 {
     tuple_t p1        = bbox.min;
@@ -196,6 +228,7 @@ bounding_box_t bounds_of_group(const void *group_ptr)
         }
     }
 
+    hot_path_shared_write("a group bounds cache");
     group->cached_bounds_min = box.min;
     group->cached_bounds_max = box.max;
     group->bounds_cached     = true;
@@ -203,19 +236,21 @@ bounding_box_t bounds_of_group(const void *group_ptr)
     return box;
 }
 
-static void bounds_check_axis(const double origin, const double direction,
-                              const double min_bound, const double max_bound,
-                              double *tmin, double *tmax)
+SIMD_KERNEL void bounds_check_axis(const real_t origin,
+                                   const real_t direction,
+                                   const real_t min_bound,
+                                   const real_t max_bound, real_t *tmin,
+                                   real_t *tmax)
 {
     if (tmin == NULL || tmax == NULL)
     {
         return;
     }
 
-    double tmin_numerator = (min_bound - origin);
-    double tmax_numerator = (max_bound - origin);
+    real_t tmin_numerator = (min_bound - origin);
+    real_t tmax_numerator = (max_bound - origin);
 
-    if (fabs(direction) >= EPSILON)
+    if (real_fabs(direction) >= EPSILON)
     {
         *tmin = tmin_numerator / direction;
         *tmax = tmax_numerator / direction;
@@ -228,15 +263,15 @@ static void bounds_check_axis(const double origin, const double direction,
 
     if (*tmin > *tmax)
     {
-        double temp = *tmin;
+        real_t temp = *tmin;
         *tmin       = *tmax;
         *tmax       = temp;
     }
 }
 
-bool bounds_intersects(bounding_box_t box, ray_t ray)
+SIMD_KERNEL bool bounds_intersects_impl(bounding_box_t box, ray_t ray)
 {
-    double xtmin, xtmax, ytmin, ytmax, ztmin, ztmax;
+    real_t xtmin, xtmax, ytmin, ytmax, ztmin, ztmax;
 
     bounds_check_axis(ray.origin.x, ray.direction.x, box.min.x, box.max.x,
                       &xtmin, &xtmax);
@@ -245,12 +280,29 @@ bool bounds_intersects(bounding_box_t box, ray_t ray)
     bounds_check_axis(ray.origin.z, ray.direction.z, box.min.z, box.max.z,
                       &ztmin, &ztmax);
 
-    double tmin = fmax(fmax(xtmin, ytmin), ztmin);
-    double tmax = fmin(fmin(xtmax, ytmax), ztmax);
+    real_t tmin = real_fmax(real_fmax(xtmin, ytmin), ztmin);
+    real_t tmax = real_fmin(real_fmin(xtmax, ytmax), ztmax);
 
     return tmin <= tmax;
 }
 
+SIMD_DISPATCH(bool, bounds_intersects, (bounding_box_t box, ray_t ray),
+              (box, ray))
+
+double bounds_surface_area(bounding_box_t box)
+{
+    double dx = box.max.x - box.min.x;
+    double dy = box.max.y - box.min.y;
+    double dz = box.max.z - box.min.z;
+
+    if (dx < 0 || dy < 0 || dz < 0)
+    {
+        return 0.0;
+    }
+
+    return 2.0 * (dx * dy + dy * dz + dz * dx);
+}
+
 void split_bounds(bounding_box_t box, bounding_box_t *left,
                   bounding_box_t *right)
 {
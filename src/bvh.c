@@ -0,0 +1,880 @@
+// bvh.c
+
+#include "../include/bvh.h"
+#include "../include/bounds.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LBVH_RADIX_BUCKETS (1u << LBVH_RADIX_BITS)
+
+static const char *bvh_builder_names[BVH_BUILDER_COUNT] = {
+    "midpoint", "lbvh30", "lbvh63", "sah", "sbvh"};
+
+const char *bvh_builder_name(bvh_builder_t builder)
+{
+    return builder < BVH_BUILDER_COUNT ? bvh_builder_names[builder]
+                                       : "unknown";
+}
+
+bool bvh_builder_parse(const char *name, bvh_builder_t *builder)
+{
+    if (name == NULL || builder == NULL)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < BVH_BUILDER_COUNT; i++)
+    {
+        if (strcmp(name, bvh_builder_names[i]) == 0)
+        {
+            *builder = (bvh_builder_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool bvh_build(shape_t *shape, unsigned threshold, bvh_builder_t builder)
+{
+    if (shape == NULL || shape->type != SHAPE_GROUP)
+    {
+        return false;
+    }
+
+    switch (builder)
+    {
+    case BVH_BUILD_MIDPOINT:
+        divide(shape, threshold);
+        return true;
+
+    case BVH_BUILD_LBVH30:
+        divide_lbvh(shape, threshold, 30);
+        return true;
+
+    case BVH_BUILD_LBVH63:
+        divide_lbvh(shape, threshold, 63);
+        return true;
+
+    case BVH_BUILD_SAH:
+        divide_sah(shape, threshold);
+        return true;
+
+    case BVH_BUILD_SBVH:
+        divide_sbvh(shape, threshold);
+        return true;
+
+    default:
+        printf("Error: Unknown BVH builder %d\n", (int)builder);
+        return false;
+    }
+}
+
+bool bvh_is_bounded(bounding_box_t box)
+{
+    return box.min.x > -REAL_MAX && box.min.y > -REAL_MAX &&
+           box.min.z > -REAL_MAX && box.max.x < REAL_MAX &&
+           box.max.y < REAL_MAX && box.max.z < REAL_MAX &&
+           box.min.x <= box.max.x;
+}
+
+void bvh_adopt_root(group_t *g, shape_t *root)
+{
+    if (root != NULL && root->type == SHAPE_GROUP &&
+        ((group_t *)root)->is_bvh_node)
+    {
+        group_t *top = (group_t *)root;
+        for (unsigned i = 0; i < top->child_count; i++)
+        {
+            group_add_child(g, top->children[i]);
+        }
+        free(top->children);
+        free(top);
+    }
+    else
+    {
+        group_add_child(g, root);
+    }
+}
+
+static bool bvh_is_node(const shape_t *s)
+{
+    return s != NULL && s->type == SHAPE_GROUP &&
+           ((const group_t *)s)->is_bvh_node;
+}
+
+// Only sibling nodes are compared; the primitives within a leaf are tested
+// together anyway.
+static double bvh_overlap_sum(const group_t *g)
+{
+    double sum = 0.0;
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        const shape_t *child = g->children[i];
+        if (!bvh_is_node(child))
+        {
+            continue;
+        }
+
+        bounding_box_t box = bounds_of_group(child);
+        for (unsigned j = i + 1; j < g->child_count; j++)
+        {
+            if (bvh_is_node(g->children[j]))
+            {
+                sum += bounds_surface_area(bounds_intersection(
+                    box, bounds_of_group(g->children[j])));
+            }
+        }
+        sum += bvh_overlap_sum((const group_t *)child);
+    }
+    return sum;
+}
+
+double bvh_overlap(const group_t *g)
+{
+    if (g == NULL)
+    {
+        return 0.0;
+    }
+
+    bounding_box_t box = bounding_box_empty();
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        bounding_box_t child = bounds_parent_space_bounds_of(g->children[i]);
+        if (bvh_is_bounded(child))
+        {
+            bounds_add_box(&box, &child);
+        }
+    }
+
+    double area = bvh_is_bounded(box) ? bounds_surface_area(box) : 0.0;
+    return area > 0.0 ? bvh_overlap_sum(g) / area : 0.0;
+}
+
+// Spreads the low 10 bits of v two bits apart.
+static uint64_t bvh_expand_bits10(uint64_t v)
+{
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// Spreads the low 21 bits of v two bits apart.
+static uint64_t bvh_expand_bits21(uint64_t v)
+{
+    v &= 0x1FFFFF;
+    v = (v | v << 32) & 0x1F00000000FFFFull;
+    v = (v | v << 16) & 0x1F0000FF0000FFull;
+    v = (v | v << 8) & 0x100F00F00F00F00Full;
+    v = (v | v << 4) & 0x10C30C30C30C30C3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+static uint64_t bvh_quantize(double x, unsigned bits)
+{
+    double cells = (double)(1u << bits);
+    return (uint64_t)fmin(fmax(x * cells, 0.0), cells - 1.0);
+}
+
+uint64_t bvh_morton_code(double x, double y, double z, unsigned bits)
+{
+    if (bits <= 30)
+    {
+        return bvh_expand_bits10(bvh_quantize(x, 10)) << 2 |
+               bvh_expand_bits10(bvh_quantize(y, 10)) << 1 |
+               bvh_expand_bits10(bvh_quantize(z, 10));
+    }
+
+    return bvh_expand_bits21(bvh_quantize(x, 21)) << 2 |
+           bvh_expand_bits21(bvh_quantize(y, 21)) << 1 |
+           bvh_expand_bits21(bvh_quantize(z, 21));
+}
+
+// Least significant digit first. Each thread counts the digits of its own
+// slice, so after a prefix sum over (digit, thread) every thread scatters
+// its slice to a disjoint, stable range of the output.
+bool bvh_radix_sort(uint64_t *keys, uint32_t *values, size_t count,
+                    unsigned bits)
+{
+    if (keys == NULL || values == NULL)
+    {
+        return false;
+    }
+
+    int max_threads   = omp_get_max_threads();
+    uint64_t *key_tmp = malloc(count * sizeof(uint64_t));
+    uint32_t *val_tmp = malloc(count * sizeof(uint32_t));
+    size_t *offsets =
+        malloc((size_t)max_threads * LBVH_RADIX_BUCKETS * sizeof(size_t));
+    if (key_tmp == NULL || val_tmp == NULL || offsets == NULL)
+    {
+        printf("Error: Failed to allocate radix sort buffers\n");
+        free(key_tmp);
+        free(val_tmp);
+        free(offsets);
+        return false;
+    }
+
+    uint64_t *key_in = keys, *key_out = key_tmp;
+    uint32_t *val_in = values, *val_out = val_tmp;
+
+    for (unsigned shift = 0; shift < bits; shift += LBVH_RADIX_BITS)
+    {
+#pragma omp parallel num_threads(max_threads)
+        {
+            size_t thread  = (size_t)omp_get_thread_num();
+            size_t threads = (size_t)omp_get_num_threads();
+            size_t begin   = count * thread / threads;
+            size_t end     = count * (thread + 1) / threads;
+            size_t *bucket = offsets + thread * LBVH_RADIX_BUCKETS;
+
+            memset(bucket, 0, LBVH_RADIX_BUCKETS * sizeof(size_t));
+            for (size_t i = begin; i < end; i++)
+            {
+                bucket[(key_in[i] >> shift) & (LBVH_RADIX_BUCKETS - 1)]++;
+            }
+
+#pragma omp barrier
+#pragma omp single
+            {
+                size_t sum = 0;
+                for (unsigned d = 0; d < LBVH_RADIX_BUCKETS; d++)
+                {
+                    for (size_t t = 0; t < threads; t++)
+                    {
+                        size_t n = offsets[t * LBVH_RADIX_BUCKETS + d];
+                        offsets[t * LBVH_RADIX_BUCKETS + d] = sum;
+                        sum += n;
+                    }
+                }
+            }
+
+            for (size_t i = begin; i < end; i++)
+            {
+                size_t slot =
+                    bucket[(key_in[i] >> shift) & (LBVH_RADIX_BUCKETS - 1)]++;
+                key_out[slot] = key_in[i];
+                val_out[slot] = val_in[i];
+            }
+        }
+
+        uint64_t *key_swap = key_in;
+        uint32_t *val_swap = val_in;
+        key_in             = key_out;
+        val_in             = val_out;
+        key_out            = key_swap;
+        val_out            = val_swap;
+    }
+
+    if (key_in != keys)
+    {
+        memcpy(keys, key_in, count * sizeof(uint64_t));
+        memcpy(values, val_in, count * sizeof(uint32_t));
+    }
+
+    free(key_tmp);
+    free(val_tmp);
+    free(offsets);
+    return true;
+}
+
+// Internal node of the binary radix tree over the sorted primitives. Its
+// children index internal nodes, or sorted primitives when marked as
+// leaves, and it covers the primitives first to last.
+typedef struct
+{
+    uint32_t left, right;
+    uint32_t first, last;
+    bool left_leaf, right_leaf;
+} lbvh_node_t;
+
+typedef struct
+{
+    shape_t **prims;
+    uint64_t *keys;
+    lbvh_node_t *nodes;
+    int count;
+    unsigned threshold;
+    shape_list_t orphans;
+} lbvh_t;
+
+// Length of the common prefix of the keys at i and j, or -1 when j is out
+// of range. Equal keys are told apart by their index, as if it were
+// appended to the key.
+static int lbvh_delta(const lbvh_t *b, int i, int j)
+{
+    if (j < 0 || j >= b->count)
+    {
+        return -1;
+    }
+
+    uint64_t diff = b->keys[i] ^ b->keys[j];
+    if (diff == 0)
+    {
+        return 64 + __builtin_clz((uint32_t)(i ^ j));
+    }
+    return __builtin_clzll(diff);
+}
+
+// Finds the range covered by internal node i and where it splits, following
+// Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and
+// k-d Trees" (2012). Every node is found independently of the others.
+static void lbvh_find_node(lbvh_t *b, int i)
+{
+    int d =
+        lbvh_delta(b, i, i + 1) - lbvh_delta(b, i, i - 1) > 0 ? 1 : -1;
+    int delta_min = lbvh_delta(b, i, i - d);
+
+    int length_max = 2;
+    while (lbvh_delta(b, i, i + length_max * d) > delta_min)
+    {
+        length_max *= 2;
+    }
+
+    int length = 0;
+    for (int step = length_max / 2; step >= 1; step /= 2)
+    {
+        if (lbvh_delta(b, i, i + (length + step) * d) > delta_min)
+        {
+            length += step;
+        }
+    }
+
+    int j          = i + length * d;
+    int delta_node = lbvh_delta(b, i, j);
+    int split      = 0;
+    int step       = length;
+    do
+    {
+        step = (step + 1) / 2;
+        if (lbvh_delta(b, i, i + (split + step) * d) > delta_node)
+        {
+            split += step;
+        }
+    } while (step > 1);
+
+    int gamma = i + split * d + (d < 0 ? -1 : 0);
+    int first = i < j ? i : j;
+    int last  = i < j ? j : i;
+
+    lbvh_node_t *node = &b->nodes[i];
+    node->left        = (uint32_t)gamma;
+    node->right       = (uint32_t)gamma + 1;
+    node->left_leaf   = first == gamma;
+    node->right_leaf  = last == gamma + 1;
+    node->first       = (uint32_t)first;
+    node->last        = (uint32_t)last;
+}
+
+// Primitives whose group could not be allocated go straight into the root.
+static void lbvh_orphan(lbvh_t *b, uint32_t first, uint32_t last)
+{
+#pragma omp critical(lbvh_orphans)
+    for (uint32_t i = first; i <= last; i++)
+    {
+        shape_list_add(&b->orphans, b->prims[i]);
+    }
+}
+
+static shape_t *lbvh_emit(lbvh_t *b, uint32_t index, bool leaf);
+
+// The children of one node are emitted as separate tasks for large
+// subtrees; each builds and bounds its own groups, so they share nothing.
+static void lbvh_emit_children(lbvh_t *b, uint32_t index, shape_t **left,
+                               shape_t **right)
+{
+    const lbvh_node_t *node = &b->nodes[index];
+    uint32_t count          = node->last - node->first + 1;
+
+#pragma omp task if (count >= LBVH_TASK_MIN)
+    *left = lbvh_emit(b, node->left, node->left_leaf);
+
+    *right = lbvh_emit(b, node->right, node->right_leaf);
+#pragma omp taskwait
+}
+
+static shape_t *lbvh_emit(lbvh_t *b, uint32_t index, bool leaf)
+{
+    if (leaf)
+    {
+        return b->prims[index];
+    }
+
+    const lbvh_node_t *node = &b->nodes[index];
+    group_t *g              = group();
+    if (g == NULL)
+    {
+        lbvh_orphan(b, node->first, node->last);
+        return NULL;
+    }
+    g->is_bvh_node = true;
+
+    if (node->last - node->first + 1 < b->threshold)
+    {
+        for (uint32_t i = node->first; i <= node->last; i++)
+        {
+            group_add_child(g, b->prims[i]);
+        }
+    }
+    else
+    {
+        shape_t *left = NULL, *right = NULL;
+        lbvh_emit_children(b, index, &left, &right);
+        group_add_child(g, left);
+        group_add_child(g, right);
+    }
+
+    bounds_of_group(g);
+    return (shape_t *)g;
+}
+
+static double lbvh_unit(double value, double min, double max)
+{
+    return max > min ? (value - min) / (max - min) : 0.0;
+}
+
+// Rebuilds g from its children, sorted along the Morton curve into
+// b->prims. The hierarchy is only touched once the sort has succeeded.
+static void lbvh_divide_group(group_t *g, lbvh_t *b, shape_t **children,
+                              tuple_t *centroids, uint32_t *ids,
+                              unsigned morton_bits)
+{
+    int unbounded = 0;
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        shape_t *child = g->children[i];
+        if (child == NULL)
+        {
+            continue;
+        }
+
+        bounding_box_t box = bounds_parent_space_bounds_of(child);
+        if (bvh_is_bounded(box))
+        {
+            b->prims[b->count++] = child;
+        }
+        else
+        {
+            children[unbounded++] = child;
+        }
+    }
+
+    bounding_box_t centroid_bounds = bounding_box_empty();
+#pragma omp parallel
+    {
+        bounding_box_t local = bounding_box_empty();
+#pragma omp for schedule(static) nowait
+        for (int i = 0; i < b->count; i++)
+        {
+            bounding_box_t box = bounds_parent_space_bounds_of(b->prims[i]);
+            centroids[i] = tuple_scale(tuple_add(box.min, box.max), 0.5);
+            bounds_add_point(&local, centroids[i]);
+        }
+#pragma omp critical(lbvh_centroid_bounds)
+        bounds_add_box(&centroid_bounds, &local);
+    }
+
+    tuple_t lo = centroid_bounds.min, hi = centroid_bounds.max;
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < b->count; i++)
+    {
+        b->keys[i] = bvh_morton_code(lbvh_unit(centroids[i].x, lo.x, hi.x),
+                                     lbvh_unit(centroids[i].y, lo.y, hi.y),
+                                     lbvh_unit(centroids[i].z, lo.z, hi.z),
+                                     morton_bits);
+        ids[i] = (uint32_t)i;
+    }
+
+    if (!bvh_radix_sort(b->keys, ids, (size_t)b->count, morton_bits))
+    {
+        return;
+    }
+
+    for (int i = 0; i < b->count; i++)
+    {
+        children[unbounded + i] = b->prims[ids[i]];
+    }
+    memcpy(b->prims, children + unbounded,
+           (size_t)b->count * sizeof(shape_t *));
+
+    g->child_count = 0;
+    for (int i = 0; i < unbounded; i++)
+    {
+        group_add_child(g, children[i]);
+    }
+
+    if (b->count < 2 || (unsigned)b->count < b->threshold)
+    {
+        for (int i = 0; i < b->count; i++)
+        {
+            group_add_child(g, b->prims[i]);
+        }
+    }
+    else
+    {
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < b->count - 1; i++)
+        {
+            lbvh_find_node(b, i);
+        }
+
+        shape_t *left = NULL, *right = NULL;
+#pragma omp parallel
+#pragma omp single
+        lbvh_emit_children(b, 0, &left, &right);
+
+        group_add_child(g, left);
+        group_add_child(g, right);
+    }
+
+    for (unsigned i = 0; i < b->orphans.count; i++)
+    {
+        group_add_child(g, b->orphans.shapes[i]);
+    }
+
+    g->build_threshold = b->threshold;
+    g->build_cost      = group_sah_cost(g);
+    g->builder = morton_bits <= 30 ? BVH_BUILD_LBVH30 : BVH_BUILD_LBVH63;
+}
+
+void divide_lbvh(shape_t *shape, unsigned threshold, unsigned morton_bits)
+{
+    if (shape == NULL || shape->type != SHAPE_GROUP)
+    {
+        return;
+    }
+
+    group_t *g   = (group_t *)shape;
+    size_t count = g->child_count > 0 ? g->child_count : 1;
+
+    lbvh_t b    = {0};
+    b.threshold = threshold;
+    b.orphans   = shape_list_create();
+
+    shape_t **children = malloc(count * sizeof(shape_t *));
+    tuple_t *centroids = malloc(count * sizeof(tuple_t));
+    uint32_t *ids      = malloc(count * sizeof(uint32_t));
+    b.prims            = malloc(count * sizeof(shape_t *));
+    b.keys             = malloc(count * sizeof(uint64_t));
+    b.nodes            = malloc(count * sizeof(lbvh_node_t));
+
+    if (children == NULL || centroids == NULL || ids == NULL ||
+        b.prims == NULL || b.keys == NULL || b.nodes == NULL)
+    {
+        printf("Error: Failed to allocate the linear BVH build\n");
+    }
+    else
+    {
+        lbvh_divide_group(g, &b, children, centroids, ids, morton_bits);
+    }
+
+    shape_list_free(&b.orphans);
+    free(children);
+    free(centroids);
+    free(ids);
+    free(b.prims);
+    free(b.keys);
+    free(b.nodes);
+}
+
+typedef struct
+{
+    shape_t *shape;
+    bounding_box_t box;
+    tuple_t centroid;
+} sah_prim_t;
+
+typedef struct
+{
+    bounding_box_t box;
+    unsigned count;
+} sah_bin_t;
+
+typedef struct
+{
+    sah_prim_t *prims;
+    unsigned threshold;
+    shape_list_t orphans;
+} sah_t;
+
+static unsigned sah_bin_index(real_t value, real_t min, double scale)
+{
+    double bin = (value - min) * scale;
+    return bin > 0.0 ? (unsigned)fmin(bin, SAH_BINS - 1) : 0;
+}
+
+static void sah_bin_range(const sah_t *s, size_t begin, size_t end,
+                          bounding_box_t centroids, const double *scale,
+                          sah_bin_t bins[3][SAH_BINS])
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        const sah_prim_t *p = &s->prims[i];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            unsigned b = sah_bin_index(bvh_axis(p->centroid, axis),
+                                       bvh_axis(centroids.min, axis),
+                                       scale[axis]);
+            bounds_add_box(&bins[axis][b].box, &p->box);
+            bins[axis][b].count++;
+        }
+    }
+}
+
+// Empty bins are skipped, as adding an empty box would stretch the result
+// to the corners of the empty box.
+static void sah_add_bin(sah_bin_t *bin, const sah_bin_t *other)
+{
+    if (other->count > 0)
+    {
+        bounds_add_box(&bin->box, &other->box);
+        bin->count += other->count;
+    }
+}
+
+static void sah_clear_bins(sah_bin_t bins[3][SAH_BINS])
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (int b = 0; b < SAH_BINS; b++)
+        {
+            bins[axis][b].box   = bounding_box_empty();
+            bins[axis][b].count = 0;
+        }
+    }
+}
+
+// Sorts the range so the primitives left of the cheapest binned split plane
+// come first, and returns where the right side starts. Ranges whose
+// centroids cannot be separated are split in half.
+static size_t sah_split(sah_t *s, size_t begin, size_t end)
+{
+    size_t count             = end - begin;
+    bounding_box_t centroids = bounding_box_empty();
+    sah_bin_t bins[3][SAH_BINS];
+
+    for (size_t i = begin; i < end; i++)
+    {
+        bounds_add_point(&centroids, s->prims[i].centroid);
+    }
+
+    double scale[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        double extent =
+            bvh_axis(centroids.max, axis) - bvh_axis(centroids.min, axis);
+        scale[axis] = extent > 0.0 ? SAH_BINS / extent : 0.0;
+    }
+
+    sah_clear_bins(bins);
+    if (count >= SAH_PARALLEL_BIN_MIN)
+    {
+        // Each chunk bins into its own table, merged at the end.
+        size_t chunks = count / (SAH_PARALLEL_BIN_MIN / 4);
+#pragma omp taskloop shared(bins)
+        for (size_t c = 0; c < chunks; c++)
+        {
+            sah_bin_t local[3][SAH_BINS];
+            sah_clear_bins(local);
+            sah_bin_range(s, begin + count * c / chunks,
+                          begin + count * (c + 1) / chunks, centroids, scale,
+                          local);
+
+#pragma omp critical(sah_bins)
+            for (int axis = 0; axis < 3; axis++)
+            {
+                for (int b = 0; b < SAH_BINS; b++)
+                {
+                    sah_add_bin(&bins[axis][b], &local[axis][b]);
+                }
+            }
+        }
+    }
+    else
+    {
+        sah_bin_range(s, begin, end, centroids, scale, bins);
+    }
+
+    int best_axis  = -1;
+    int best_split = 0;
+    double best    = INFINITY;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (scale[axis] <= 0.0)
+        {
+            continue;
+        }
+
+        // right_cost[b] is the cost of the bins from b onwards.
+        double right_cost[SAH_BINS];
+        sah_bin_t side = {bounding_box_empty(), 0};
+        for (int b = SAH_BINS - 1; b > 0; b--)
+        {
+            sah_add_bin(&side, &bins[axis][b]);
+            right_cost[b] = bounds_surface_area(side.box) * side.count;
+        }
+
+        side = (sah_bin_t){bounding_box_empty(), 0};
+        for (int b = 0; b < SAH_BINS - 1; b++)
+        {
+            sah_add_bin(&side, &bins[axis][b]);
+            double cost =
+                bounds_surface_area(side.box) * side.count + right_cost[b + 1];
+            if (side.count > 0 && side.count < count && cost < best)
+            {
+                best       = cost;
+                best_axis  = axis;
+                best_split = b;
+            }
+        }
+    }
+
+    if (best_axis < 0)
+    {
+        return begin + count / 2;
+    }
+
+    size_t left  = begin;
+    size_t right = end;
+    while (left < right)
+    {
+        const sah_prim_t *p = &s->prims[left];
+        if ((int)sah_bin_index(bvh_axis(p->centroid, best_axis),
+                               bvh_axis(centroids.min, best_axis),
+                               scale[best_axis]) <= best_split)
+        {
+            left++;
+        }
+        else
+        {
+            right--;
+            sah_prim_t swap = s->prims[left];
+            s->prims[left]  = s->prims[right];
+            s->prims[right] = swap;
+        }
+    }
+    return left;
+}
+
+static shape_t *sah_build(sah_t *s, size_t begin, size_t end)
+{
+    size_t count = end - begin;
+    if (count == 1)
+    {
+        return s->prims[begin].shape;
+    }
+
+    group_t *g = group();
+    if (g == NULL)
+    {
+#pragma omp critical(sah_orphans)
+        for (size_t i = begin; i < end; i++)
+        {
+            shape_list_add(&s->orphans, s->prims[i].shape);
+        }
+        return NULL;
+    }
+    g->is_bvh_node = true;
+
+    if (count < s->threshold)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            group_add_child(g, s->prims[i].shape);
+        }
+    }
+    else
+    {
+        size_t mid    = sah_split(s, begin, end);
+        shape_t *left = NULL, *right = NULL;
+
+#pragma omp task shared(left) if (mid - begin >= SAH_TASK_MIN)
+        left = sah_build(s, begin, mid);
+
+        right = sah_build(s, mid, end);
+#pragma omp taskwait
+
+        group_add_child(g, left);
+        group_add_child(g, right);
+    }
+
+    bounds_of_group(g);
+    return (shape_t *)g;
+}
+
+void divide_sah(shape_t *shape, unsigned threshold)
+{
+    if (shape == NULL || shape->type != SHAPE_GROUP)
+    {
+        return;
+    }
+
+    group_t *g  = (group_t *)shape;
+    sah_t s     = {0};
+    s.threshold = threshold;
+    s.orphans   = shape_list_create();
+    s.prims     = malloc((g->child_count + 1) * sizeof(sah_prim_t));
+    if (s.prims == NULL)
+    {
+        printf("Error: Failed to allocate the SAH BVH build\n");
+        shape_list_free(&s.orphans);
+        return;
+    }
+
+    size_t count           = 0;
+    shape_list_t unbounded = shape_list_create();
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        shape_t *child = g->children[i];
+        if (child == NULL)
+        {
+            continue;
+        }
+
+        bounding_box_t box = bounds_parent_space_bounds_of(child);
+        if (bvh_is_bounded(box))
+        {
+            s.prims[count].shape    = child;
+            s.prims[count].box      = box;
+            s.prims[count].centroid =
+                tuple_scale(tuple_add(box.min, box.max), 0.5);
+            count++;
+        }
+        else
+        {
+            shape_list_add(&unbounded, child);
+        }
+    }
+
+    g->child_count = 0;
+    for (unsigned i = 0; i < unbounded.count; i++)
+    {
+        group_add_child(g, unbounded.shapes[i]);
+    }
+
+    shape_t *root = NULL;
+    if (count > 0)
+    {
+#pragma omp parallel
+#pragma omp single
+        root = sah_build(&s, 0, count);
+    }
+    bvh_adopt_root(g, root);
+
+    for (unsigned i = 0; i < s.orphans.count; i++)
+    {
+        group_add_child(g, s.orphans.shapes[i]);
+    }
+
+    g->build_threshold = threshold;
+    g->build_cost      = group_sah_cost(g);
+    g->builder         = BVH_BUILD_SAH;
+
+    shape_list_free(&unbounded);
+    shape_list_free(&s.orphans);
+    free(s.prims);
+}
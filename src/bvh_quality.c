@@ -0,0 +1,125 @@
+// bvh_quality.c
+
+#include "../include/bounds.h"
+#include "../include/bvh.h"
+
+static void bvh_analyze_node(const group_t *g, unsigned depth,
+                             bvh_quality_t *q, double *leaf_depths)
+{
+    q->nodes++;
+    if (depth > q->max_depth)
+    {
+        q->max_depth = depth;
+    }
+
+    // Checked against the cache as it stands, without refreshing it, so
+    // a shape moved without refitting its groups is caught.
+    bounding_box_t bounds = bounding_box(g->cached_bounds_min,
+                                         g->cached_bounds_max);
+    unsigned groups = 0, primitives = 0;
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        const shape_t *child = g->children[i];
+        if (child == NULL)
+        {
+            continue;
+        }
+
+        bounding_box_t box = bounds_parent_space_bounds_of(child);
+        if (g->bounds_cached && !bounds_is_empty(box) &&
+            !bounds_box_contains_box(bounds, box))
+        {
+            q->invalid_bounds++;
+        }
+
+        if (child->type == SHAPE_GROUP)
+        {
+            groups++;
+            bvh_analyze_node((const group_t *)child, depth + 1, q,
+                             leaf_depths);
+        }
+        else
+        {
+            primitives++;
+        }
+    }
+
+    q->primitives += primitives;
+    if (groups > 0)
+    {
+        q->straddlers += primitives;
+        return;
+    }
+
+    q->leaves++;
+    *leaf_depths += depth;
+    q->mean_leaf_size += primitives;
+    q->min_leaf_size = primitives < q->min_leaf_size ? primitives
+                                                     : q->min_leaf_size;
+    q->max_leaf_size = primitives > q->max_leaf_size ? primitives
+                                                     : q->max_leaf_size;
+    q->leaf_sizes[primitives < BVH_LEAF_HISTOGRAM_BINS
+                      ? primitives
+                      : BVH_LEAF_HISTOGRAM_BINS - 1]++;
+}
+
+// Children are checked against cached bounds, so group_warm_bounds() or a
+// render should have filled them first; nodes without a cache are skipped.
+bvh_quality_t bvh_analyze(const group_t *g)
+{
+    bvh_quality_t q = {0};
+    if (g == NULL)
+    {
+        return q;
+    }
+
+    double leaf_depths = 0.0;
+    q.min_leaf_size    = UINT32_MAX;
+    bvh_analyze_node(g, 0, &q, &leaf_depths);
+
+    if (q.leaves > 0)
+    {
+        q.mean_leaf_depth = leaf_depths / q.leaves;
+        q.mean_leaf_size /= q.leaves;
+    }
+    else
+    {
+        q.min_leaf_size = 0;
+    }
+
+    q.sah_cost = group_sah_cost(g);
+    q.overlap  = bvh_overlap(g);
+    return q;
+}
+
+void bvh_quality_print(const bvh_quality_t *q, FILE *file)
+{
+    if (q == NULL || file == NULL)
+    {
+        return;
+    }
+
+    fprintf(file, "BVH quality:\n");
+    fprintf(file, "  %-16s %u\n", "nodes", q->nodes);
+    fprintf(file, "  %-16s %u\n", "leaves", q->leaves);
+    fprintf(file, "  %-16s %u\n", "primitives", q->primitives);
+    fprintf(file, "  %-16s %u\n", "straddlers", q->straddlers);
+    fprintf(file, "  %-16s %u (mean leaf %.2f)\n", "depth", q->max_depth,
+            q->mean_leaf_depth);
+    fprintf(file, "  %-16s %u to %u (mean %.2f)\n", "leaf size",
+            q->min_leaf_size, q->max_leaf_size, q->mean_leaf_size);
+    fprintf(file, "  %-16s %.2f\n", "SAH cost", q->sah_cost);
+    fprintf(file, "  %-16s %.3f\n", "overlap", q->overlap);
+    fprintf(file, "  %-16s %u\n", "invalid bounds", q->invalid_bounds);
+
+    fprintf(file, "Leaf sizes:\n");
+    for (int i = 0; i < BVH_LEAF_HISTOGRAM_BINS; i++)
+    {
+        if (q->leaf_sizes[i] > 0)
+        {
+            fprintf(file, "  %3d%s %u\n", i,
+                    i == BVH_LEAF_HISTOGRAM_BINS - 1 ? "+" : " ",
+                    q->leaf_sizes[i]);
+        }
+    }
+}
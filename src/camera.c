@@ -1,13 +1,19 @@
 #include "../include/camera.h"
+#include "../include/hot_path.h"
+#include "../include/stats.h"
+#include "../include/wavefront.h"
 #include <math.h>
 
 #include <omp.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 camera_t camera(const unsigned hsize, const unsigned vsize,
                 const double field_of_view)
 {
-    camera_t c = {hsize, vsize, field_of_view, IDENTITY, IDENTITY, 1, 1, 1};
+    camera_t c = {hsize,    vsize, field_of_view, IDENTITY,
+                  IDENTITY, 1,     1,             1,
+                  1,        AA_DEFAULT_THRESHOLD, false};
     double half_view = tan(c.field_of_view / 2);
     double aspect    = (double)c.hsize / (double)c.vsize;
 
@@ -28,14 +34,21 @@ camera_t camera(const unsigned hsize, const unsigned vsize,
 }
 
 ray_t camera_ray_for_pixel(const camera_t *c, unsigned px, unsigned py)
+{
+    return camera_ray_for_sample(c, px + 0.5, py + 0.5);
+}
+
+ray_t camera_ray_for_sample(const camera_t *c, double sx, double sy)
 {
     if (c == NULL)
     {
         return ray(point(0, 0, 0), vector(0, 0, 1));
     }
 
-    double xoffset = (px + 0.5) * c->pixel_size;
-    double yoffset = (py + 0.5) * c->pixel_size;
+    STATS_ADD(STAT_CAMERA_RAYS, 1);
+
+    double xoffset = sx * c->pixel_size;
+    double yoffset = sy * c->pixel_size;
 
     double world_x = c->half_width - xoffset;
     double world_y = c->half_height - yoffset;
@@ -59,7 +72,317 @@ void camera_set_transform(camera_t *c, matrix_t transform)
     c->inverse_transform = matrix_inverse(transform);
 }
 
-canvas_t *camera_render(const camera_t *c, const world_t *w)
+void camera_set_antialiasing(camera_t *c, unsigned max_samples,
+                             double threshold)
+{
+    if (c == NULL)
+    {
+        return;
+    }
+
+    if (max_samples <= 1)
+    {
+        max_samples = 1;
+    }
+    else if (max_samples < AA_MIN_SAMPLES)
+    {
+        max_samples = AA_MIN_SAMPLES;
+    }
+
+    c->aa_max_samples = max_samples;
+    c->aa_threshold   = threshold;
+}
+
+void camera_set_wavefront(camera_t *c, bool wavefront)
+{
+    if (c == NULL)
+    {
+        return;
+    }
+
+    c->wavefront = wavefront;
+}
+
+static inline tuple_t camera_sample(const camera_t *c, const world_t *w,
+                                    double sx, double sy)
+{
+    ray_t r = camera_ray_for_sample(c, sx, sy);
+    lights_select_pixel((unsigned)sx, (unsigned)sy);
+    return world_color_at(w, &r, MAX_RECURSION);
+}
+
+// The largest spread of any colour channel over the four corners.
+static double camera_contrast(const tuple_t corners[4])
+{
+    tuple_t lo = corners[0];
+    tuple_t hi = corners[0];
+    for (int i = 1; i < 4; i++)
+    {
+        lo.x = fmin(lo.x, corners[i].x);
+        lo.y = fmin(lo.y, corners[i].y);
+        lo.z = fmin(lo.z, corners[i].z);
+        hi.x = fmax(hi.x, corners[i].x);
+        hi.y = fmax(hi.y, corners[i].y);
+        hi.z = fmax(hi.z, corners[i].z);
+    }
+    return fmax(hi.x - lo.x, fmax(hi.y - lo.y, hi.z - lo.z));
+}
+
+// A quad is split when its corners disagree and the pixel can still afford
+// the five samples at its edge midpoints and centre.
+static inline bool camera_splits(const camera_t *c, const tuple_t corners[4],
+                                 unsigned budget)
+{
+    return budget >= 5 && camera_contrast(corners) > c->aa_threshold;
+}
+
+static tuple_t camera_sample_quad(const camera_t *c, const world_t *w,
+                                  double x, double y, double size,
+                                  const tuple_t corners[4], unsigned *budget);
+
+// Corners are ordered top-left, top-right, bottom-left, bottom-right and
+// edges top, left, right, bottom. The centre is traced and the four child
+// quads share it and the edge midpoints.
+static tuple_t camera_split_quad(const camera_t *c, const world_t *w,
+                                 double x, double y, double size,
+                                 const tuple_t corners[4],
+                                 const tuple_t edges[4], unsigned *budget)
+{
+    *budget -= 5;
+
+    double half    = size / 2;
+    tuple_t centre = camera_sample(c, w, x + half, y + half);
+
+    tuple_t quads[4][4] = {{corners[0], edges[0], edges[1], centre},
+                           {edges[0], corners[1], centre, edges[2]},
+                           {edges[1], centre, corners[2], edges[3]},
+                           {centre, edges[2], edges[3], corners[3]}};
+
+    double offsets[4][2] = {{0, 0}, {half, 0}, {0, half}, {half, half}};
+
+    tuple_t sum = color(0, 0, 0);
+    for (int i = 0; i < 4; i++)
+    {
+        sum = tuple_add(sum, camera_sample_quad(c, w, x + offsets[i][0],
+                                                y + offsets[i][1], half,
+                                                quads[i], budget));
+    }
+    return tuple_scale(sum, 0.25);
+}
+
+// A quad whose corners agree is averaged; otherwise its edge midpoints are
+// traced and it is split.
+static tuple_t camera_sample_quad(const camera_t *c, const world_t *w,
+                                  double x, double y, double size,
+                                  const tuple_t corners[4], unsigned *budget)
+{
+    if (!camera_splits(c, corners, *budget))
+    {
+        return tuple_scale(
+            tuple_add(tuple_add(corners[0], corners[1]),
+                      tuple_add(corners[2], corners[3])),
+            0.25);
+    }
+
+    double half      = size / 2;
+    tuple_t edges[4] = {camera_sample(c, w, x + half, y),
+                        camera_sample(c, w, x, y + half),
+                        camera_sample(c, w, x + size, y + half),
+                        camera_sample(c, w, x + half, y + size)};
+
+    return camera_split_quad(c, w, x, y, size, corners, edges, budget);
+}
+
+static bool camera_render_adaptive(const camera_t *c, const world_t *w,
+                                   render_region_t r, canvas_t *dst,
+                                   unsigned dst_x, unsigned dst_y)
+{
+    // Pixel corners are traced once into a shared grid, so neighbouring
+    // pixels reuse each other's edge samples and flat regions cost one ray
+    // per pixel. The midpoints of the pixel edges are shared the same way:
+    // once it is known which pixels split, each midpoint one of them needs
+    // is traced once into hgrid, for horizontal edges, or vgrid, for
+    // vertical ones.
+    unsigned grid_width = r.width + 1;
+    size_t pixels       = (size_t)r.width * r.height;
+    tuple_t *grid =
+        malloc((size_t)grid_width * (r.height + 1) * sizeof(tuple_t));
+    tuple_t *hgrid = malloc((size_t)r.width * (r.height + 1) * sizeof(tuple_t));
+    tuple_t *vgrid = malloc((size_t)grid_width * r.height * sizeof(tuple_t));
+    bool *splits   = malloc(pixels * sizeof(bool));
+    if (!grid || !hgrid || !vgrid || !splits)
+    {
+        printf("Failed to allocate anti-aliasing sample grid\n");
+        free(grid);
+        free(hgrid);
+        free(vgrid);
+        free(splits);
+        return false;
+    }
+
+    unsigned first_budget = c->aa_max_samples > 4 ? c->aa_max_samples - 4 : 0;
+
+    hot_path_begin();
+
+#pragma omp parallel for schedule(dynamic, 64) collapse(2)
+    for (unsigned y = 0; y <= r.height; y++)
+    {
+        for (unsigned x = 0; x <= r.width; x++)
+        {
+            grid[y * grid_width + x] = camera_sample(c, w, r.x + x, r.y + y);
+        }
+    }
+
+#pragma omp parallel for schedule(static) collapse(2)
+    for (unsigned y = 0; y < r.height; y++)
+    {
+        for (unsigned x = 0; x < r.width; x++)
+        {
+            const tuple_t *row = &grid[y * grid_width + x];
+            tuple_t corners[4] = {row[0], row[1], row[grid_width],
+                                  row[grid_width + 1]};
+            splits[y * r.width + x] = camera_splits(c, corners, first_budget);
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic, 64) collapse(2)
+    for (unsigned y = 0; y <= r.height; y++)
+    {
+        for (unsigned x = 0; x < r.width; x++)
+        {
+            if ((y > 0 && splits[(y - 1) * r.width + x]) ||
+                (y < r.height && splits[y * r.width + x]))
+            {
+                hgrid[y * r.width + x] =
+                    camera_sample(c, w, r.x + x + 0.5, r.y + y);
+            }
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic, 64) collapse(2)
+    for (unsigned y = 0; y < r.height; y++)
+    {
+        for (unsigned x = 0; x <= r.width; x++)
+        {
+            if ((x > 0 && splits[y * r.width + x - 1]) ||
+                (x < r.width && splits[y * r.width + x]))
+            {
+                vgrid[y * grid_width + x] =
+                    camera_sample(c, w, r.x + x, r.y + y + 0.5);
+            }
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic, 64) collapse(2)
+    for (unsigned y = 0; y < r.height; y++)
+    {
+        for (unsigned x = 0; x < r.width; x++)
+        {
+            const tuple_t *row = &grid[y * grid_width + x];
+            tuple_t corners[4] = {row[0], row[1], row[grid_width],
+                                  row[grid_width + 1]};
+            unsigned budget    = first_budget;
+            tuple_t color;
+            if (splits[y * r.width + x])
+            {
+                tuple_t edges[4] = {hgrid[y * r.width + x],
+                                    vgrid[y * grid_width + x],
+                                    vgrid[y * grid_width + x + 1],
+                                    hgrid[(y + 1) * r.width + x]};
+                color = camera_split_quad(c, w, r.x + x, r.y + y, 1.0,
+                                          corners, edges, &budget);
+            }
+            else
+            {
+                color = camera_sample_quad(c, w, r.x + x, r.y + y, 1.0,
+                                           corners, &budget);
+            }
+            canvas_write_pixel(dst, dst_x + x, dst_y + y, color);
+        }
+    }
+
+    hot_path_end();
+
+    free(grid);
+    free(hgrid);
+    free(vgrid);
+    free(splits);
+    return true;
+}
+
+// Sizes every render thread's hit lists and ray streams, so the render
+// loops do not allocate. The scene itself is prepared once per render by
+// world_prepare, before any of this runs.
+static void camera_reserve(const camera_t *c)
+{
+    bool wavefront = c->wavefront && c->aa_max_samples <= 1;
+#pragma omp parallel
+    {
+        intersections_scratch_reserve();
+        if (wavefront)
+        {
+            wavefront_reserve();
+        }
+    }
+}
+
+// Renders the camera pixels inside r, writing pixel (r.x + i, r.y + j) to
+// (dst_x + i, dst_y + j) in dst. Only reads the scene, so several calls may
+// run at once on a world prepared beforehand.
+static bool camera_render_rect(const camera_t *c, const world_t *w,
+                               render_region_t r, canvas_t *dst,
+                               unsigned dst_x, unsigned dst_y)
+{
+    camera_reserve(c);
+
+    if (c->aa_max_samples > 1)
+    {
+        return camera_render_adaptive(c, w, r, dst, dst_x, dst_y);
+    }
+    if (c->wavefront)
+    {
+        return wavefront_render(c, w, r, dst, dst_x, dst_y);
+    }
+
+    hot_path_begin();
+
+#pragma omp parallel for schedule(dynamic, 64) collapse(2)
+    for (unsigned y = 0; y < r.height; y++)
+    {
+        for (unsigned x = 0; x < r.width; x++)
+        {
+            ray_t ray = camera_ray_for_pixel(c, r.x + x, r.y + y);
+            lights_select_pixel(r.x + x, r.y + y);
+            tuple_t color = world_color_at(w, &ray, MAX_RECURSION);
+            canvas_write_pixel(dst, dst_x + x, dst_y + y, color);
+        }
+    }
+
+    hot_path_end();
+
+    return true;
+}
+
+static bool camera_clip_region(const camera_t *c, render_region_t *r)
+{
+    if (r->x >= c->hsize || r->y >= c->vsize)
+    {
+        return false;
+    }
+
+    if (r->width > c->hsize - r->x)
+    {
+        r->width = c->hsize - r->x;
+    }
+    if (r->height > c->vsize - r->y)
+    {
+        r->height = c->vsize - r->y;
+    }
+
+    return r->width > 0 && r->height > 0;
+}
+
+canvas_t *camera_render(const camera_t *c, world_t *w)
 {
     if (!c || !w)
     {
@@ -76,17 +399,211 @@ canvas_t *camera_render(const camera_t *c, const world_t *w)
 
     printf("Rendering %dx%d image...\n", c->hsize, c->vsize);
 
-#pragma omp parallel for schedule(dynamic, 64) collapse(2)
-    for (unsigned y = 0; y < c->vsize; y++)
+    world_prepare(w);
+    stats_begin_render();
+
+    render_region_t full = {0, 0, c->hsize, c->vsize};
+    if (!camera_render_rect(c, w, full, image, 0, 0))
+    {
+        canvas_free(image);
+        return NULL;
+    }
+
+    printf("Rendering complete!\n");
+    stats_end_render();
+    return image;
+}
+
+bool camera_render_tile(const camera_t *c, const world_t *w,
+                        render_region_t region, canvas_t *dst)
+{
+    if (!c || !w || !dst || !camera_clip_region(c, &region) ||
+        region.width > dst->width || region.height > dst->height)
     {
-        for (unsigned x = 0; x < c->hsize; x++)
+        return false;
+    }
+
+    return camera_render_rect(c, w, region, dst, 0, 0);
+}
+
+bool camera_render_tile_into(const camera_t *c, const world_t *w,
+                             render_region_t region, canvas_t *target)
+{
+    if (!c || !w || !target || target->width != c->hsize ||
+        target->height != c->vsize || !camera_clip_region(c, &region))
+    {
+        return false;
+    }
+
+    return camera_render_rect(c, w, region, target, region.x, region.y);
+}
+
+canvas_t *camera_render_region(const camera_t *c, world_t *w,
+                               render_region_t region)
+{
+    if (!c || !w || !camera_clip_region(c, &region))
+    {
+        printf("Invalid parameters for camera_render_region\n");
+        return NULL;
+    }
+
+    canvas_t *image = canvas(region.width, region.height);
+    if (!image)
+    {
+        printf("Failed to create canvas for rendering\n");
+        return NULL;
+    }
+
+    printf("Rendering %ux%u region at (%u, %u)...\n", region.width,
+           region.height, region.x, region.y);
+
+    world_prepare(w);
+    if (!camera_render_rect(c, w, region, image, 0, 0))
+    {
+        canvas_free(image);
+        return NULL;
+    }
+
+    return image;
+}
+
+bool camera_render_into(const camera_t *c, world_t *w,
+                        render_region_t region, canvas_t *target)
+{
+    if (!c || !w || !target || target->width != c->hsize ||
+        target->height != c->vsize || !camera_clip_region(c, &region))
+    {
+        printf("Invalid parameters for camera_render_into\n");
+        return false;
+    }
+
+    world_prepare(w);
+    return camera_render_rect(c, w, region, target, region.x, region.y);
+}
+
+static void camera_fill_preview(canvas_t *image, unsigned step_x,
+                                unsigned step_y)
+{
+#pragma omp parallel for schedule(static)
+    for (unsigned y = 0; y < image->height; y++)
+    {
+        unsigned src_y = y - y % step_y;
+        for (unsigned x = 0; x < image->width; x++)
         {
-            ray_t ray     = camera_ray_for_pixel(c, x, y);
-            tuple_t color = world_color_at(w, &ray, MAX_RECURSION);
-            canvas_write_pixel(image, x, y, color);
+            unsigned src_x = x - x % step_x;
+            if (src_x != x || src_y != y)
+            {
+                image->pixels[y * image->width + x] =
+                    image->pixels[src_y * image->width + src_x];
+            }
         }
     }
+}
 
-    printf("Rendering complete!\n");
+canvas_t *camera_render_progressive(const camera_t *c, world_t *w,
+                                    const char *preview_path)
+{
+    if (!c || !w)
+    {
+        printf("Invalid parameters for camera_render_progressive\n");
+        return NULL;
+    }
+
+    canvas_t *image = canvas(c->hsize, c->vsize);
+    if (!image)
+    {
+        printf("Failed to create canvas for rendering\n");
+        return NULL;
+    }
+
+    printf("Rendering %dx%d image progressively...\n", c->hsize, c->vsize);
+
+    // Passes alternate halving the horizontal and vertical pixel spacing, so
+    // each one samples only pixels no earlier pass has touched. Between
+    // passes the missing pixels are filled from their nearest sampled
+    // neighbour for the preview. Anti-aliased and wavefront renders do not
+    // trace one ray per pixel centre, so for them the earlier passes are
+    // only previews and the last one renders every pixel as camera_render
+    // does. Either way the final image is identical to camera_render.
+    bool one_ray = c->aa_max_samples <= 1 && !c->wavefront;
+    unsigned step_x = PROGRESSIVE_INITIAL_STEP;
+    unsigned step_y = PROGRESSIVE_INITIAL_STEP;
+    unsigned prev_x = 0;
+    unsigned prev_y = 0;
+    unsigned pass   = 0;
+
+    world_prepare(w);
+    camera_reserve(c);
+    stats_begin_render();
+
+    for (;;)
+    {
+        if (!one_ray && step_x == 1 && step_y == 1)
+        {
+            render_region_t full = {0, 0, c->hsize, c->vsize};
+            if (!camera_render_rect(c, w, full, image, 0, 0))
+            {
+                canvas_free(image);
+                return NULL;
+            }
+            pass++;
+            break;
+        }
+
+        hot_path_begin();
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (unsigned y = 0; y < c->vsize; y += step_y)
+        {
+            for (unsigned x = 0; x < c->hsize; x += step_x)
+            {
+                if (prev_x != 0 && x % prev_x == 0 && y % prev_y == 0)
+                {
+                    continue;
+                }
+                ray_t ray = camera_ray_for_pixel(c, x, y);
+                lights_select_pixel(x, y);
+                tuple_t color = world_color_at(w, &ray, MAX_RECURSION);
+                canvas_write_pixel(image, x, y, color);
+            }
+        }
+
+        hot_path_end();
+
+        pass++;
+
+        if (step_x == 1 && step_y == 1)
+        {
+            break;
+        }
+
+        if (preview_path != NULL)
+        {
+            camera_fill_preview(image, step_x, step_y);
+            if (!canvas_save(image, preview_path))
+            {
+                printf("Failed to save preview after pass %u\n", pass);
+            }
+        }
+
+        prev_x = step_x;
+        prev_y = step_y;
+        if (step_x == step_y)
+        {
+            step_x /= 2;
+        }
+        else
+        {
+            step_y /= 2;
+        }
+    }
+
+    if (preview_path != NULL && !canvas_save(image, preview_path))
+    {
+        printf("Failed to save final preview\n");
+    }
+
+    printf("Rendering complete after %u passes!\n", pass);
+    stats_end_render();
     return image;
 }
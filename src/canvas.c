@@ -1,6 +1,7 @@
 // canvas.c
 
 #include "../include/canvas.h"
+#include "../include/simd.h"
 
 #include <errno.h>
 #include <math.h>
@@ -54,6 +55,28 @@ tuple_t canvas_pixel_at(const canvas_t *c, unsigned x, unsigned y)
     return c->pixels[y * c->width + x];
 }
 
+// Converts pixels to 8-bit RGB triples, rounding to nearest. Written as a
+// branch-free loop so each ISA variant vectorises it.
+SIMD_KERNEL unsigned canvas_quantize_impl(const tuple_t *pixels,
+                                          unsigned count, unsigned char *rgb)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        double r = 255.0 * canvas_clamp(pixels[i].x) + 0.5;
+        double g = 255.0 * canvas_clamp(pixels[i].y) + 0.5;
+        double b = 255.0 * canvas_clamp(pixels[i].z) + 0.5;
+
+        rgb[3 * i]     = (unsigned char)r;
+        rgb[3 * i + 1] = (unsigned char)g;
+        rgb[3 * i + 2] = (unsigned char)b;
+    }
+    return 3 * count;
+}
+
+SIMD_DISPATCH(unsigned, canvas_quantize,
+              (const tuple_t *pixels, unsigned count, unsigned char *rgb),
+              (pixels, count, rgb))
+
 char *canvas_to_ppm(const canvas_t *c)
 {
     if (!c || c->width <= 0 || c->height <= 0)
@@ -62,28 +85,31 @@ char *canvas_to_ppm(const canvas_t *c)
     size_t size = 32 + (12ULL * c->width * c->height);
     if (size < (12ULL * c->width * c->height))
         return NULL;
-    char *buffer = malloc(size);
-    if (!buffer)
+    char *buffer       = malloc(size);
+    unsigned char *rgb = malloc(3 * (size_t)c->width);
+    if (!buffer || !rgb)
+    {
+        free(buffer);
+        free(rgb);
         return NULL;
+    }
 
     int pos = sprintf(buffer, "P3\n%u %u\n255\n", c->width, c->height);
 
     for (unsigned y = 0; y < c->height; y++)
     {
+        canvas_quantize(&c->pixels[y * c->width], c->width, rgb);
+
         for (unsigned x = 0; x < c->width; x++)
         {
-            tuple_t pixel = c->pixels[y * c->width + x];
-
-            int r = (int)round(255.0 * canvas_clamp(pixel.x));
-            int g = (int)round(255.0 * canvas_clamp(pixel.y));
-            int b = (int)round(255.0 * canvas_clamp(pixel.z));
-
-            pos += sprintf(buffer + pos, "%d %d %d ", r, g, b);
+            pos += sprintf(buffer + pos, "%d %d %d ", rgb[3 * x],
+                           rgb[3 * x + 1], rgb[3 * x + 2]);
         }
 
         buffer[pos - 1] = '\n';
     }
 
+    free(rgb);
     return buffer;
 }
 
@@ -114,9 +140,12 @@ bool canvas_save(const canvas_t *c, const char *file_path)
 
     fprintf(file, "P3\n%u %u\n255\n", c->width, c->height);
 
-    char *line_buffer = malloc(c->width * 12 + 2);
-    if (!line_buffer)
+    char *line_buffer  = malloc(c->width * 12 + 2);
+    unsigned char *rgb = malloc(3 * (size_t)c->width);
+    if (!line_buffer || !rgb)
     {
+        free(line_buffer);
+        free(rgb);
         fclose(file);
         return false;
     }
@@ -125,15 +154,12 @@ bool canvas_save(const canvas_t *c, const char *file_path)
     {
         int line_pos = 0;
 
+        canvas_quantize(&c->pixels[y * c->width], c->width, rgb);
+
         for (unsigned x = 0; x < c->width; x++)
         {
-            tuple_t pixel = c->pixels[y * c->width + x];
-
-            int r = (int)round(255.0 * canvas_clamp(pixel.x));
-            int g = (int)round(255.0 * canvas_clamp(pixel.y));
-            int b = (int)round(255.0 * canvas_clamp(pixel.z));
-
-            line_pos += sprintf(line_buffer + line_pos, "%d %d %d ", r, g, b);
+            line_pos += sprintf(line_buffer + line_pos, "%d %d %d ", rgb[3 * x],
+                                rgb[3 * x + 1], rgb[3 * x + 2]);
         }
 
         line_buffer[line_pos - 1] = '\n';
@@ -142,6 +168,7 @@ bool canvas_save(const canvas_t *c, const char *file_path)
         fputs(line_buffer, file);
     }
 
+    free(rgb);
     free(line_buffer);
     fclose(file);
 
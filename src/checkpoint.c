@@ -0,0 +1,478 @@
+// checkpoint.c
+
+#include "../include/checkpoint.h"
+#include "../include/stats.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
+
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= bytes[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+static uint64_t hash_double(uint64_t h, double value)
+{
+    return hash_bytes(h, &value, sizeof(value));
+}
+
+static uint64_t hash_tuple(uint64_t h, tuple_t t)
+{
+    h = hash_double(h, t.x);
+    h = hash_double(h, t.y);
+    h = hash_double(h, t.z);
+    return hash_double(h, t.w);
+}
+
+static uint64_t hash_material(uint64_t h, const material_t *m)
+{
+    h = hash_tuple(h, m->color);
+    h = hash_double(h, m->ambient);
+    h = hash_double(h, m->diffuse);
+    h = hash_double(h, m->specular);
+    h = hash_double(h, m->shininess);
+    h = hash_double(h, m->reflective);
+    h = hash_double(h, m->transparency);
+    h = hash_double(h, m->refractive_index);
+    return hash_bytes(h, &m->has_pattern, sizeof(m->has_pattern));
+}
+
+// Hashes a shape's type, transform, material and geometry, descending into
+// group children, instanced meshes and clipped triangles, so editing any
+// part of a mesh changes the hash even when its size stays the same.
+static uint64_t hash_shape(uint64_t h, const shape_t *s)
+{
+    if (s == NULL)
+    {
+        return hash_bytes(h, "", 1);
+    }
+
+    h = hash_bytes(h, &s->type, sizeof(s->type));
+    for (int k = 0; k < 16; k++)
+    {
+        h = hash_double(h, s->transform.m[k]);
+    }
+    h = hash_material(h, &s->material);
+
+    switch (s->type)
+    {
+    case SHAPE_CYLINDER:
+    {
+        const cylinder_t *cyl = (const cylinder_t *)s;
+        h = hash_double(h, cyl->minimum);
+        h = hash_double(h, cyl->maximum);
+        h = hash_bytes(h, &cyl->closed, sizeof(cyl->closed));
+        break;
+    }
+
+    case SHAPE_CONE:
+    {
+        const cone_t *cone = (const cone_t *)s;
+        h = hash_double(h, cone->minimum);
+        h = hash_double(h, cone->maximum);
+        h = hash_bytes(h, &cone->closed, sizeof(cone->closed));
+        break;
+    }
+
+    case SHAPE_TRIANGLE:
+    {
+        const triangle_t *t = (const triangle_t *)s;
+        h = hash_tuple(h, t->p1);
+        h = hash_tuple(h, t->p2);
+        h = hash_tuple(h, t->p3);
+        break;
+    }
+
+    case SHAPE_SMOOTH_TRIANGLE:
+    {
+        const smooth_triangle_t *t = (const smooth_triangle_t *)s;
+        h = hash_tuple(h, t->p1);
+        h = hash_tuple(h, t->p2);
+        h = hash_tuple(h, t->p3);
+        h = hash_tuple(h, t->n1);
+        h = hash_tuple(h, t->n2);
+        h = hash_tuple(h, t->n3);
+        break;
+    }
+
+    case SHAPE_GROUP:
+    {
+        const group_t *g = (const group_t *)s;
+        h = hash_bytes(h, &g->child_count, sizeof(g->child_count));
+        for (unsigned i = 0; i < g->child_count; i++)
+        {
+            h = hash_shape(h, g->children[i]);
+        }
+        break;
+    }
+
+    case SHAPE_INSTANCE:
+    {
+        const instance_t *inst = (const instance_t *)s;
+        h = hash_bytes(h, &inst->material_override,
+                       sizeof(inst->material_override));
+        h = hash_shape(h, inst->mesh);
+        break;
+    }
+
+    case SHAPE_CLIPPED:
+    {
+        const clipped_t *c = (const clipped_t *)s;
+        h = hash_tuple(h, c->world_bounds.min);
+        h = hash_tuple(h, c->world_bounds.max);
+        h = hash_shape(h, c->target);
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    return h;
+}
+
+// Fingerprints the parts of a scene that survive a restart: every shape's
+// type, transform, material and geometry, down through groups and meshes,
+// and the lights, including the cells and jitter patterns of area lights.
+// Pointers and padding are deliberately left out.
+uint64_t checkpoint_scene_hash(const world_t *w)
+{
+    uint64_t h = FNV_OFFSET;
+
+    if (w == NULL)
+    {
+        return h;
+    }
+
+    h = hash_bytes(h, &w->object_count, sizeof(w->object_count));
+    for (unsigned i = 0; i < w->object_count; i++)
+    {
+        h = hash_shape(h, &w->objects[i].shape);
+    }
+
+    h = hash_bytes(h, &w->light_count, sizeof(w->light_count));
+    for (unsigned i = 0; i < w->light_count; i++)
+    {
+        const light_t *l = &w->lights[i];
+        h = hash_bytes(h, &l->type, sizeof(l->type));
+        h = hash_tuple(h, l->position);
+        h = hash_tuple(h, l->intensity);
+        h = hash_tuple(h, l->corner);
+        h = hash_tuple(h, l->uvec);
+        h = hash_tuple(h, l->vvec);
+        h = hash_bytes(h, &l->usteps, sizeof(l->usteps));
+        h = hash_bytes(h, &l->vsteps, sizeof(l->vsteps));
+        h = hash_bytes(h, &l->samples, sizeof(l->samples));
+        h = hash_bytes(h, &l->patterns, sizeof(l->patterns));
+        h = hash_bytes(h, &l->jitter_seed, sizeof(l->jitter_seed));
+        h = hash_bytes(h, &l->jitter_by.count, sizeof(l->jitter_by.count));
+        for (int k = 0; k < l->jitter_by.count; k++)
+        {
+            h = hash_double(h, l->jitter_by.values[k]);
+        }
+    }
+
+    return h;
+}
+
+static checkpoint_header_t checkpoint_header(const camera_t *c,
+                                             const world_t *w)
+{
+    checkpoint_header_t header = {0};
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version        = CHECKPOINT_VERSION;
+    header.hsize          = c->hsize;
+    header.vsize          = c->vsize;
+    header.tile_size      = CHECKPOINT_TILE_SIZE;
+    header.aa_max_samples = c->aa_max_samples;
+    header.field_of_view  = c->field_of_view;
+    header.aa_threshold   = c->aa_threshold;
+    memcpy(header.transform, c->transform.m, sizeof(header.transform));
+    header.scene_hash = checkpoint_scene_hash(w);
+    return header;
+}
+
+static render_region_t checkpoint_tile(const camera_t *c, unsigned index)
+{
+    unsigned tiles_x = (c->hsize + CHECKPOINT_TILE_SIZE - 1) /
+                       CHECKPOINT_TILE_SIZE;
+    render_region_t r;
+    r.x      = (index % tiles_x) * CHECKPOINT_TILE_SIZE;
+    r.y      = (index / tiles_x) * CHECKPOINT_TILE_SIZE;
+    r.width  = c->hsize - r.x < CHECKPOINT_TILE_SIZE ? c->hsize - r.x
+                                                     : CHECKPOINT_TILE_SIZE;
+    r.height = c->vsize - r.y < CHECKPOINT_TILE_SIZE ? c->vsize - r.y
+                                                     : CHECKPOINT_TILE_SIZE;
+    return r;
+}
+
+static bool checkpoint_write_tile(FILE *file, const canvas_t *image,
+                                  const camera_t *c, unsigned index)
+{
+    render_region_t r = checkpoint_tile(c, index);
+    uint32_t tile     = index;
+    float row[CHECKPOINT_TILE_SIZE * 3];
+
+    if (fwrite(&tile, sizeof(tile), 1, file) != 1)
+    {
+        return false;
+    }
+
+    for (unsigned y = 0; y < r.height; y++)
+    {
+        for (unsigned x = 0; x < r.width; x++)
+        {
+            tuple_t p      = canvas_pixel_at(image, r.x + x, r.y + y);
+            row[x * 3]     = (float)p.x;
+            row[x * 3 + 1] = (float)p.y;
+            row[x * 3 + 2] = (float)p.z;
+        }
+        if (fwrite(row, sizeof(float) * 3, r.width, file) != r.width)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool checkpoint_read_tile(FILE *file, canvas_t *image,
+                                 const camera_t *c, unsigned tile_count,
+                                 bool *done)
+{
+    uint32_t tile;
+    float row[CHECKPOINT_TILE_SIZE * 3];
+
+    if (fread(&tile, sizeof(tile), 1, file) != 1 || tile >= tile_count)
+    {
+        return false;
+    }
+
+    render_region_t r = checkpoint_tile(c, tile);
+    canvas_t *staging = canvas(r.width, r.height);
+    if (!staging)
+    {
+        return false;
+    }
+
+    for (unsigned y = 0; y < r.height; y++)
+    {
+        if (fread(row, sizeof(float) * 3, r.width, file) != r.width)
+        {
+            canvas_free(staging);
+            return false;
+        }
+        for (unsigned x = 0; x < r.width; x++)
+        {
+            canvas_write_pixel(staging, x, y,
+                               color((double)row[x * 3],
+                                     (double)row[x * 3 + 1],
+                                     (double)row[x * 3 + 2]));
+        }
+    }
+
+    // Only copy a tile into the image once the whole record has been read, so
+    // a truncated trailing record leaves no partial tile behind.
+    for (unsigned y = 0; y < r.height; y++)
+    {
+        for (unsigned x = 0; x < r.width; x++)
+        {
+            canvas_write_pixel(image, r.x + x, r.y + y,
+                               canvas_pixel_at(staging, x, y));
+        }
+    }
+    done[tile] = true;
+
+    canvas_free(staging);
+    return true;
+}
+
+// Loads the finished tiles of a matching checkpoint and returns the file
+// positioned for appending, or NULL if there is nothing to resume from.
+static FILE *checkpoint_resume(const char *path,
+                               const checkpoint_header_t *expected,
+                               canvas_t *image, const camera_t *c,
+                               unsigned tile_count, bool *done,
+                               unsigned *restored)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return NULL;
+    }
+
+    checkpoint_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(&header, expected, sizeof(header)) != 0)
+    {
+        printf("Checkpoint %s does not match this render, starting over\n",
+               path);
+        fclose(file);
+        return NULL;
+    }
+
+    long valid_end = ftell(file);
+    while (checkpoint_read_tile(file, image, c, tile_count, done))
+    {
+        valid_end = ftell(file);
+    }
+    fclose(file);
+
+    for (unsigned i = 0; i < tile_count; i++)
+    {
+        *restored += done[i] ? 1 : 0;
+    }
+
+    // Reopen for update and drop any torn record at the end before appending.
+    file = fopen(path, "r+b");
+    if (!file || ftruncate(fileno(file), valid_end) != 0 ||
+        fseek(file, valid_end, SEEK_SET) != 0)
+    {
+        if (file)
+        {
+            fclose(file);
+        }
+        return NULL;
+    }
+
+    return file;
+}
+
+static bool checkpoint_flush(FILE *file, const canvas_t *image,
+                             const camera_t *c, unsigned *pending,
+                             unsigned *pending_count)
+{
+    bool ok = true;
+    for (unsigned i = 0; i < *pending_count && ok; i++)
+    {
+        ok = checkpoint_write_tile(file, image, c, pending[i]);
+    }
+    *pending_count = 0;
+    return ok && fflush(file) == 0;
+}
+
+canvas_t *checkpoint_render(const camera_t *c, world_t *w,
+                            const char *path, bool resume)
+{
+    if (!c || !w || !path)
+    {
+        printf("Invalid parameters for checkpoint_render\n");
+        return NULL;
+    }
+
+    canvas_t *image = canvas(c->hsize, c->vsize);
+    if (!image)
+    {
+        printf("Failed to create canvas for rendering\n");
+        return NULL;
+    }
+
+    unsigned tiles_x =
+        (c->hsize + CHECKPOINT_TILE_SIZE - 1) / CHECKPOINT_TILE_SIZE;
+    unsigned tiles_y =
+        (c->vsize + CHECKPOINT_TILE_SIZE - 1) / CHECKPOINT_TILE_SIZE;
+    unsigned tile_count = tiles_x * tiles_y;
+
+    bool *done        = calloc(tile_count, sizeof(bool));
+    unsigned *pending = malloc(tile_count * sizeof(unsigned));
+    if (!done || !pending)
+    {
+        free(done);
+        free(pending);
+        canvas_free(image);
+        return NULL;
+    }
+
+    checkpoint_header_t header = checkpoint_header(c, w);
+    unsigned restored          = 0;
+    FILE *file                 = NULL;
+
+    if (resume)
+    {
+        file = checkpoint_resume(path, &header, image, c, tile_count, done,
+                                 &restored);
+    }
+
+    if (!file)
+    {
+        memset(done, 0, tile_count * sizeof(bool));
+        restored = 0;
+        file     = fopen(path, "wb");
+        if (!file || fwrite(&header, sizeof(header), 1, file) != 1)
+        {
+            printf("Failed to create checkpoint %s\n", path);
+            if (file)
+            {
+                fclose(file);
+            }
+            free(done);
+            free(pending);
+            canvas_free(image);
+            return NULL;
+        }
+        fflush(file);
+    }
+
+    printf("Rendering %dx%d image with checkpoints (%u of %u tiles "
+           "restored)...\n",
+           c->hsize, c->vsize, restored, tile_count);
+
+    unsigned pending_count = 0;
+    double last_flush      = omp_get_wtime();
+    bool write_ok          = true;
+
+    // Tiles render concurrently and only read the scene, so it is prepared
+    // once up front.
+    world_prepare(w);
+    stats_begin_render();
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (unsigned i = 0; i < tile_count; i++)
+    {
+        if (done[i])
+        {
+            continue;
+        }
+
+        camera_render_tile_into(c, w, checkpoint_tile(c, i), image);
+
+#pragma omp critical(checkpoint_file)
+        {
+            pending[pending_count++] = i;
+            double now               = omp_get_wtime();
+            if (now - last_flush >= CHECKPOINT_INTERVAL_SECONDS)
+            {
+                write_ok   = checkpoint_flush(file, image, c, pending,
+                                              &pending_count) &&
+                             write_ok;
+                last_flush = now;
+            }
+        }
+    }
+
+    write_ok = checkpoint_flush(file, image, c, pending, &pending_count) &&
+               write_ok;
+    if (!write_ok)
+    {
+        printf("Warning: failed to write some tiles to checkpoint %s\n", path);
+    }
+
+    fclose(file);
+    free(done);
+    free(pending);
+
+    printf("Rendering complete!\n");
+    stats_end_render();
+    return image;
+}
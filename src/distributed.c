@@ -0,0 +1,438 @@
+// distributed.c
+
+#include "../include/distributed.h"
+#include <errno.h>
+#include <omp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+#define SHUTDOWN_TILE UINT32_MAX
+
+// Workers are forked from the coordinator, so each one inherits the already
+// loaded world without parsing or dividing anything again. They receive tile
+// indices, with the attempt at each, over a socket pair and reply with a
+// tile header followed by the tile's pixels as RGB floats.
+typedef struct
+{
+    uint32_t tile;
+    uint32_t attempt;
+} tile_request_t;
+
+typedef struct
+{
+    uint32_t tile;
+    uint32_t pixel_count;
+} tile_reply_t;
+
+typedef struct
+{
+    pid_t pid;
+    int fd;
+    int tile;
+} worker_t;
+
+static unsigned crash_attempts;
+
+void distributed_set_crash_attempts(unsigned attempts)
+{
+    crash_attempts = attempts;
+}
+
+distributed_options_t distributed_options(unsigned worker_count)
+{
+    distributed_options_t options = {0};
+    options.worker_count          = worker_count;
+    options.tile_size             = DISTRIBUTED_TILE_SIZE;
+    options.max_attempts          = DISTRIBUTED_MAX_ATTEMPTS;
+    return options;
+}
+
+static bool write_all(int fd, const void *data, size_t size)
+{
+    const char *bytes = data;
+    while (size > 0)
+    {
+        ssize_t n = send(fd, bytes, size, SEND_FLAGS);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        bytes += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void *data, size_t size)
+{
+    char *bytes = data;
+    while (size > 0)
+    {
+        ssize_t n = read(fd, bytes, size);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        bytes += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static render_region_t distributed_tile(const camera_t *c, unsigned size,
+                                        unsigned index)
+{
+    unsigned tiles_x = (c->hsize + size - 1) / size;
+    render_region_t r;
+    r.x      = (index % tiles_x) * size;
+    r.y      = (index / tiles_x) * size;
+    r.width  = c->hsize - r.x < size ? c->hsize - r.x : size;
+    r.height = c->vsize - r.y < size ? c->vsize - r.y : size;
+    return r;
+}
+
+static void worker_main(int fd, const camera_t *c, const world_t *w,
+                        const distributed_options_t *options)
+{
+    // One process per core: keep each worker single-threaded.
+    omp_set_num_threads(1);
+
+    canvas_t *tile = canvas(options->tile_size, options->tile_size);
+    float *pixels =
+        malloc((size_t)options->tile_size * options->tile_size * 3 *
+               sizeof(float));
+
+    while (tile && pixels)
+    {
+        tile_request_t request;
+        if (!read_all(fd, &request, sizeof(request)) ||
+            request.tile == SHUTDOWN_TILE)
+        {
+            break;
+        }
+
+        if (request.attempt <= crash_attempts)
+        {
+            _exit(EXIT_FAILURE);
+        }
+
+        uint32_t index    = request.tile;
+        render_region_t r = distributed_tile(c, options->tile_size, index);
+        if (!camera_render_tile(c, w, r, tile))
+        {
+            break;
+        }
+
+        for (unsigned y = 0; y < r.height; y++)
+        {
+            for (unsigned x = 0; x < r.width; x++)
+            {
+                tuple_t p  = canvas_pixel_at(tile, x, y);
+                float *out = &pixels[(y * r.width + x) * 3];
+                out[0]     = (float)p.x;
+                out[1]     = (float)p.y;
+                out[2]     = (float)p.z;
+            }
+        }
+
+        tile_reply_t reply = {index, r.width * r.height};
+        if (!write_all(fd, &reply, sizeof(reply)) ||
+            !write_all(fd, pixels, reply.pixel_count * 3 * sizeof(float)))
+        {
+            break;
+        }
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+static bool worker_spawn(worker_t *workers, unsigned index,
+                         const camera_t *c, const world_t *w,
+                         const distributed_options_t *options)
+{
+    worker_t *worker = &workers[index];
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    {
+        return false;
+    }
+
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    // Flush before forking so buffered output is not printed twice.
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        close(fds[0]);
+        for (unsigned i = 0; i < options->worker_count; i++)
+        {
+            if (workers[i].fd >= 0)
+            {
+                close(workers[i].fd);
+            }
+        }
+        worker_main(fds[1], c, w, options);
+    }
+
+    close(fds[1]);
+    worker->pid  = pid;
+    worker->fd   = fds[0];
+    worker->tile = -1;
+    return true;
+}
+
+static void worker_reap(worker_t *worker)
+{
+    if (worker->fd >= 0)
+    {
+        close(worker->fd);
+        worker->fd = -1;
+    }
+    if (worker->pid > 0)
+    {
+        waitpid(worker->pid, NULL, 0);
+        worker->pid = -1;
+    }
+}
+
+static bool worker_receive(worker_t *worker, canvas_t *image,
+                           const camera_t *c, unsigned tile_size,
+                           float *pixels)
+{
+    tile_reply_t reply;
+    if (!read_all(worker->fd, &reply, sizeof(reply)) ||
+        (int)reply.tile != worker->tile)
+    {
+        return false;
+    }
+
+    render_region_t r = distributed_tile(c, tile_size, reply.tile);
+    if (reply.pixel_count != r.width * r.height ||
+        !read_all(worker->fd, pixels, reply.pixel_count * 3 * sizeof(float)))
+    {
+        return false;
+    }
+
+    for (unsigned y = 0; y < r.height; y++)
+    {
+        for (unsigned x = 0; x < r.width; x++)
+        {
+            const float *p = &pixels[(y * r.width + x) * 3];
+            canvas_write_pixel(image, r.x + x, r.y + y,
+                               color((double)p[0], (double)p[1],
+                                     (double)p[2]));
+        }
+    }
+
+    return true;
+}
+
+canvas_t *distributed_render(const camera_t *c, world_t *w,
+                             const distributed_options_t *options)
+{
+    if (!c || !w || !options || options->worker_count == 0 ||
+        options->tile_size == 0)
+    {
+        printf("Invalid parameters for distributed_render\n");
+        return NULL;
+    }
+
+    unsigned size     = options->tile_size;
+    unsigned tiles_x  = (c->hsize + size - 1) / size;
+    unsigned tiles_y  = (c->vsize + size - 1) / size;
+    unsigned total    = tiles_x * tiles_y;
+    unsigned nworkers = options->worker_count;
+
+    canvas_t *image    = canvas(c->hsize, c->vsize);
+    unsigned *queue    = malloc(total * sizeof(unsigned));
+    unsigned *tries    = calloc(total, sizeof(unsigned));
+    worker_t *workers  = calloc(nworkers, sizeof(worker_t));
+    struct pollfd *fds = calloc(nworkers, sizeof(struct pollfd));
+    float *pixels      = malloc((size_t)size * size * 3 * sizeof(float));
+
+    if (!image || !queue || !tries || !workers || !fds || !pixels)
+    {
+        canvas_free(image);
+        free(queue);
+        free(tries);
+        free(workers);
+        free(fds);
+        free(pixels);
+        return NULL;
+    }
+
+    printf("Rendering %dx%d image on %u worker processes...\n", c->hsize,
+           c->vsize, nworkers);
+
+    // Workers inherit the prepared scene, so they only ever read it.
+    world_prepare(w);
+
+    for (unsigned i = 0; i < total; i++)
+    {
+        queue[i] = i;
+    }
+    unsigned head = 0, tail = total, finished = 0;
+    bool failed = false;
+
+    // Respawns are bounded by the total tile attempts, so workers that crash
+    // even before taking a tile cannot make the coordinator loop forever.
+    unsigned respawns_left = nworkers + total * options->max_attempts;
+
+    for (unsigned i = 0; i < nworkers; i++)
+    {
+        workers[i].pid  = -1;
+        workers[i].fd   = -1;
+        workers[i].tile = -1;
+    }
+    for (unsigned i = 0; i < nworkers; i++)
+    {
+        if (!worker_spawn(workers, i, c, w, options))
+        {
+            printf("Failed to start worker %u\n", i);
+        }
+    }
+
+    while (finished < total && !failed)
+    {
+        unsigned alive = 0;
+
+        for (unsigned i = 0; i < nworkers; i++)
+        {
+            worker_t *worker = &workers[i];
+
+            if (worker->fd < 0 && head < tail && respawns_left > 0)
+            {
+                respawns_left--;
+                worker_spawn(workers, i, c, w, options);
+            }
+
+            if (worker->fd >= 0 && worker->tile < 0 && head < tail)
+            {
+                uint32_t index = queue[head++ % total];
+                worker->tile   = (int)index;
+                tries[index]++;
+                tile_request_t request = {index, tries[index]};
+                // A failed send shows up below as a hang-up on this worker.
+                write_all(worker->fd, &request, sizeof(request));
+            }
+
+            fds[i].fd      = worker->fd;
+            fds[i].events  = POLLIN;
+            fds[i].revents = 0;
+            alive += worker->fd >= 0 ? 1 : 0;
+        }
+
+        if (alive == 0)
+        {
+            printf("All workers failed\n");
+            failed = true;
+            break;
+        }
+
+        if (poll(fds, nworkers, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            failed = true;
+            break;
+        }
+
+        for (unsigned i = 0; i < nworkers && !failed; i++)
+        {
+            worker_t *worker = &workers[i];
+            if (worker->fd < 0 || fds[i].revents == 0)
+            {
+                continue;
+            }
+
+            if (worker->tile >= 0 &&
+                worker_receive(worker, image, c, size, pixels))
+            {
+                worker->tile = -1;
+                finished++;
+                continue;
+            }
+
+            // Hang-up or a short reply: the worker died mid-tile.
+            int tile = worker->tile;
+            worker_reap(worker);
+            worker->tile = -1;
+
+            if (tile >= 0)
+            {
+                if (tries[tile] >= options->max_attempts)
+                {
+                    printf("Tile %d failed %u times, giving up\n", tile,
+                           tries[tile]);
+                    failed = true;
+                }
+                else
+                {
+                    printf("Worker %u died, retrying tile %d\n", i, tile);
+                    queue[tail++ % total] = (unsigned)tile;
+                }
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < nworkers; i++)
+    {
+        if (workers[i].fd >= 0)
+        {
+            tile_request_t shutdown = {SHUTDOWN_TILE, 0};
+            write_all(workers[i].fd, &shutdown, sizeof(shutdown));
+        }
+        worker_reap(&workers[i]);
+    }
+
+    free(queue);
+    free(tries);
+    free(workers);
+    free(fds);
+    free(pixels);
+
+    if (failed)
+    {
+        canvas_free(image);
+        return NULL;
+    }
+
+    printf("Rendering complete!\n");
+    return image;
+}
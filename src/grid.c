@@ -0,0 +1,325 @@
+// grid.c
+
+#include "../include/grid.h"
+#include "../include/bounds.h"
+#include "../include/bvh.h"
+#include <math.h>
+#include <stdlib.h>
+
+static unsigned grid_cell(const grid_t *grid, int axis, double value)
+{
+    double size = grid->cell_size[axis];
+    if (size <= 0.0)
+    {
+        return 0;
+    }
+
+    double cell = (value - bvh_axis(grid->box.min, axis)) / size;
+    if (cell <= 0.0)
+    {
+        return 0;
+    }
+    return (unsigned)fmin(cell, grid->resolution[axis] - 1);
+}
+
+static unsigned grid_index(const grid_t *grid, unsigned x, unsigned y,
+                           unsigned z)
+{
+    return x + grid->resolution[0] * (y + grid->resolution[1] * z);
+}
+
+// Without a child, counts the box into counts[cell + 1] of every cell it
+// overlaps; with one, writes the child at each such cell's cursor.
+static void grid_add_box(grid_t *grid, bounding_box_t box, unsigned *counts,
+                         shape_t *child)
+{
+    unsigned lo[3], hi[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        lo[axis] = grid_cell(grid, axis, bvh_axis(box.min, axis));
+        hi[axis] = grid_cell(grid, axis, bvh_axis(box.max, axis));
+    }
+
+    for (unsigned z = lo[2]; z <= hi[2]; z++)
+    {
+        for (unsigned y = lo[1]; y <= hi[1]; y++)
+        {
+            for (unsigned x = lo[0]; x <= hi[0]; x++)
+            {
+                unsigned cell = grid_index(grid, x, y, z);
+                if (child == NULL)
+                {
+                    counts[cell + 1]++;
+                }
+                else
+                {
+                    grid->cell_children[counts[cell]++] = child;
+                }
+            }
+        }
+    }
+}
+
+void grid_free(grid_t *grid)
+{
+    if (grid == NULL)
+    {
+        return;
+    }
+
+    free(grid->cell_start);
+    free(grid->cell_children);
+    free(grid->unbounded);
+    free(grid);
+}
+
+// The resolution follows the child count, spread over the axes in
+// proportion to the grid's extent along them.
+static bool grid_allocate(grid_t *grid, unsigned bounded)
+{
+    double extent[3], longest = 0.0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        extent[axis] =
+            bvh_axis(grid->box.max, axis) - bvh_axis(grid->box.min, axis);
+        longest = fmax(longest, extent[axis]);
+    }
+
+    double per_unit =
+        longest > 0.0 ? GRID_DENSITY * cbrt((double)bounded) / longest : 0.0;
+    unsigned cells = 1;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        double resolution =
+            fmin(fmax(floor(extent[axis] * per_unit), 1.0), GRID_MAX_RESOLUTION);
+        grid->resolution[axis] = (unsigned)resolution;
+        grid->cell_size[axis]  = extent[axis] > 0.0 ? extent[axis] / resolution
+                                                    : 0.0;
+        cells *= grid->resolution[axis];
+    }
+
+    grid->cell_start = calloc(cells + 1, sizeof(unsigned));
+    return grid->cell_start != NULL;
+}
+
+grid_t *grid_build(const group_t *g)
+{
+    if (g == NULL)
+    {
+        return NULL;
+    }
+
+    grid_t *grid = calloc(1, sizeof(grid_t));
+    if (grid == NULL)
+    {
+        return NULL;
+    }
+
+    bounding_box_t *boxes = malloc((g->child_count + 1) * sizeof(*boxes));
+    grid->unbounded = malloc((g->child_count + 1) * sizeof(shape_t *));
+    if (boxes == NULL || grid->unbounded == NULL)
+    {
+        free(boxes);
+        grid_free(grid);
+        return NULL;
+    }
+
+    grid->box        = bounding_box_empty();
+    unsigned bounded = 0;
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        shape_t *child = g->children[i];
+        if (child == NULL)
+        {
+            continue;
+        }
+
+        boxes[i] = bounds_parent_space_bounds_of(child);
+        if (bvh_is_bounded(boxes[i]))
+        {
+            bounds_add_box(&grid->box, &boxes[i]);
+            bounded++;
+        }
+        else
+        {
+            grid->unbounded[grid->unbounded_count++] = child;
+        }
+    }
+
+    if (!grid_allocate(grid, bounded))
+    {
+        free(boxes);
+        grid_free(grid);
+        return NULL;
+    }
+
+    unsigned cells = grid->resolution[0] * grid->resolution[1] *
+                     grid->resolution[2];
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        if (g->children[i] != NULL && bvh_is_bounded(boxes[i]))
+        {
+            grid_add_box(grid, boxes[i], grid->cell_start, NULL);
+        }
+    }
+    for (unsigned c = 0; c < cells; c++)
+    {
+        grid->cell_start[c + 1] += grid->cell_start[c];
+    }
+
+    // The second pass fills each cell from a cursor that starts where the
+    // cell does.
+    unsigned *cursor    = malloc(cells * sizeof(unsigned));
+    grid->cell_children = malloc((grid->cell_start[cells] + 1) *
+                                 sizeof(shape_t *));
+    if (cursor == NULL || grid->cell_children == NULL)
+    {
+        free(cursor);
+        free(boxes);
+        grid_free(grid);
+        return NULL;
+    }
+
+    for (unsigned c = 0; c < cells; c++)
+    {
+        cursor[c] = grid->cell_start[c];
+    }
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        if (g->children[i] != NULL && bvh_is_bounded(boxes[i]))
+        {
+            grid_add_box(grid, boxes[i], cursor, g->children[i]);
+        }
+    }
+
+    free(cursor);
+    free(boxes);
+    return grid;
+}
+
+static bool grid_mailbox_contains(const shape_t *const *mailbox,
+                                  const shape_t *child)
+{
+    for (int i = 0; i < GRID_MAILBOX; i++)
+    {
+        if (mailbox[i] == child)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Walks the cells along the whole line of the ray, not only ahead of its
+// origin, so the group reports the same hits as testing every child.
+void grid_intersect(const grid_t *grid, ray_t r, intersections_t *xs)
+{
+    if (grid == NULL || xs == NULL)
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < grid->unbounded_count; i++)
+    {
+        shape_intersect(grid->unbounded[i], r, xs);
+    }
+
+    double enter = -INFINITY, leave = INFINITY;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        double origin    = bvh_axis(r.origin, axis);
+        double direction = bvh_axis(r.direction, axis);
+        double min       = bvh_axis(grid->box.min, axis);
+        double max       = bvh_axis(grid->box.max, axis);
+        if (direction > 0.0 || direction < 0.0)
+        {
+            double t0 = (min - origin) / direction;
+            double t1 = (max - origin) / direction;
+            enter     = fmax(enter, fmin(t0, t1));
+            leave     = fmin(leave, fmax(t0, t1));
+        }
+        else if (origin < min || origin > max)
+        {
+            return;
+        }
+    }
+    if (!(enter <= leave) || isinf(enter))
+    {
+        return;
+    }
+
+    int cell[3], step[3], end[3];
+    double next[3], delta[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        double origin    = bvh_axis(r.origin, axis);
+        double direction = bvh_axis(r.direction, axis);
+        double min       = bvh_axis(grid->box.min, axis);
+        double size      = grid->cell_size[axis];
+
+        cell[axis] = (int)grid_cell(grid, axis, origin + enter * direction);
+        if (grid->resolution[axis] == 1 ||
+            !(direction > 0.0 || direction < 0.0))
+        {
+            step[axis]  = 0;
+            end[axis]   = -1;
+            next[axis]  = INFINITY;
+            delta[axis] = INFINITY;
+        }
+        else if (direction > 0.0)
+        {
+            step[axis]  = 1;
+            end[axis]   = (int)grid->resolution[axis];
+            next[axis]  = (min + (cell[axis] + 1) * size - origin) / direction;
+            delta[axis] = size / direction;
+        }
+        else
+        {
+            step[axis]  = -1;
+            end[axis]   = -1;
+            next[axis]  = (min + cell[axis] * size - origin) / direction;
+            delta[axis] = -size / direction;
+        }
+    }
+
+    const shape_t *mailbox[GRID_MAILBOX] = {0};
+    unsigned slot                        = 0;
+    for (;;)
+    {
+        unsigned index = grid_index(grid, (unsigned)cell[0], (unsigned)cell[1],
+                                    (unsigned)cell[2]);
+        for (unsigned i = grid->cell_start[index];
+             i < grid->cell_start[index + 1]; i++)
+        {
+            shape_t *child = grid->cell_children[i];
+            if (grid_mailbox_contains(mailbox, child))
+            {
+                continue;
+            }
+            mailbox[slot++ % GRID_MAILBOX] = child;
+
+            // A child spanning several cells may be tested again once it
+            // has left the mailbox, and its hits are then dropped.
+            int before = xs->count;
+            shape_intersect(child, r, xs);
+            if (xs->count > before)
+            {
+                intersections_drop_repeats(xs, before);
+            }
+        }
+
+        int axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2)
+                                     : (next[1] < next[2] ? 1 : 2);
+        if (next[axis] > leave || step[axis] == 0)
+        {
+            break;
+        }
+
+        cell[axis] += step[axis];
+        if (cell[axis] == end[axis])
+        {
+            break;
+        }
+        next[axis] += delta[axis];
+    }
+}
@@ -0,0 +1,104 @@
+#include "../include/hot_path.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef RT_HOT_PATH_CHECKS
+
+static atomic_int hot_path_depth;
+static atomic_ulong hot_path_allocation_count;
+static _Thread_local int hot_path_amortized_depth;
+
+// The library is linked with -Wl,--wrap for these, so every allocation in
+// the renderer passes through here first.
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static void hot_path_count_allocation(void)
+{
+    if (hot_path_amortized_depth == 0 &&
+        atomic_load_explicit(&hot_path_depth, memory_order_relaxed) > 0)
+    {
+        atomic_fetch_add_explicit(&hot_path_allocation_count, 1,
+                                  memory_order_relaxed);
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    hot_path_count_allocation();
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    hot_path_count_allocation();
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    hot_path_count_allocation();
+    return __real_realloc(ptr, size);
+}
+
+// Regions may nest or overlap, as when checkpointed tiles render in
+// parallel; allocations are checked when the outermost one ends.
+void hot_path_begin(void)
+{
+    if (atomic_fetch_add(&hot_path_depth, 1) == 0)
+    {
+        atomic_store(&hot_path_allocation_count, 0);
+    }
+}
+
+void hot_path_end(void)
+{
+    if (atomic_fetch_sub(&hot_path_depth, 1) != 1)
+    {
+        return;
+    }
+
+    unsigned long count = atomic_load(&hot_path_allocation_count);
+    if (count > 0)
+    {
+        fprintf(stderr, "Error: %lu allocations on the render hot path\n",
+                count);
+        abort();
+    }
+}
+
+void hot_path_shared_write(const char *what)
+{
+    if (atomic_load(&hot_path_depth) > 0)
+    {
+        fprintf(stderr, "Error: shared write to %s on the render hot path\n",
+                what);
+        abort();
+    }
+}
+
+void hot_path_amortized_begin(void)
+{
+    hot_path_amortized_depth++;
+}
+
+void hot_path_amortized_end(void)
+{
+    hot_path_amortized_depth--;
+}
+
+unsigned long hot_path_allocations(void)
+{
+    return atomic_load(&hot_path_allocation_count);
+}
+
+#else
+
+unsigned long hot_path_allocations(void)
+{
+    return 0;
+}
+
+#endif
@@ -1,10 +1,14 @@
 // intersections.c
 
 #include "../include/intersections.h"
+#include "../include/hot_path.h"
 #include "../include/shapes.h"
+#include "../include/stats.h"
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 intersection_t intersection(double t, void *o)
 {
@@ -29,12 +33,12 @@ intersections_t intersections(int count, ...)
     va_list args;
     va_start(args, count);
 
-    intersections_t result;
-    result.count = count;
+    intersections_t result = empty_intersections();
+    intersections_reserve(&result, count);
 
     for (int i = 0; i < count; i++)
     {
-        result.intersections[i] = va_arg(args, intersection_t);
+        intersections_add(&result, va_arg(args, intersection_t));
     }
 
     va_end(args);
@@ -42,6 +46,121 @@ intersections_t intersections(int count, ...)
     return result;
 }
 
+bool intersections_reserve(intersections_t *xs, int capacity)
+{
+    if (xs == NULL)
+    {
+        return false;
+    }
+
+    if (capacity <= xs->capacity)
+    {
+        return true;
+    }
+
+    intersection_t *data =
+        realloc(xs->intersections, (size_t)capacity * sizeof(intersection_t));
+    if (data == NULL)
+    {
+        fprintf(stderr, "Error: Failed to grow intersection list to %d\n",
+                capacity);
+        return false;
+    }
+
+    xs->intersections = data;
+    xs->capacity      = capacity;
+    return true;
+}
+
+bool intersections_grow(intersections_t *xs)
+{
+    if (xs == NULL)
+    {
+        return false;
+    }
+
+    int capacity = xs->capacity > 0 ? xs->capacity * 2
+                                    : INTERSECTIONS_INITIAL_CAPACITY;
+
+    STATS_ADD(STAT_HIT_BUFFER_GROWTHS, 1);
+    hot_path_amortized_begin();
+    bool grown = intersections_reserve(xs, capacity);
+    hot_path_amortized_end();
+    return grown;
+}
+
+void intersections_free(intersections_t *xs)
+{
+    if (xs == NULL)
+    {
+        return;
+    }
+
+    free(xs->intersections);
+    xs->intersections = NULL;
+    xs->count         = 0;
+    xs->capacity      = 0;
+}
+
+static bool intersections_reported(const intersections_t *xs, int count,
+                                   const intersection_t *hit)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const intersection_t *x = &xs->intersections[i];
+        if (x->object == hit->object && x->instance == hit->instance &&
+            !(x->t < hit->t) && !(x->t > hit->t))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void intersections_drop_repeats(intersections_t *xs, int from)
+{
+    if (xs == NULL)
+    {
+        return;
+    }
+
+    int kept = from;
+    for (int i = from; i < xs->count; i++)
+    {
+        if (!intersections_reported(xs, from, &xs->intersections[i]))
+        {
+            xs->intersections[kept++] = xs->intersections[i];
+        }
+    }
+    xs->count = kept;
+}
+
+// Scratch lists live as long as their thread; OpenMP keeps its worker
+// threads for the life of the process.
+static _Thread_local intersections_t
+    scratch_lists[INTERSECTIONS_SHADOW_SCRATCH + 1];
+
+intersections_t *intersections_scratch(unsigned level)
+{
+    if (level > INTERSECTIONS_SHADOW_SCRATCH)
+    {
+        level = MAX_RECURSION;
+    }
+
+    intersections_t *xs = &scratch_lists[level];
+    xs->count           = 0;
+    return xs;
+}
+
+void intersections_scratch_reserve(void)
+{
+    for (unsigned i = 0; i <= INTERSECTIONS_SHADOW_SCRATCH; i++)
+    {
+        intersections_reserve(&scratch_lists[i],
+                              INTERSECTIONS_INITIAL_CAPACITY);
+    }
+}
+
 intersection_t *intersections_hit(const intersections_t *xs)
 {
     if (xs == NULL)
@@ -65,6 +184,111 @@ intersection_t *intersections_hit(const intersections_t *xs)
     return hit;
 }
 
+#define CONTAINER_TABLE_CAPACITY (2 * MAX_REFRACTION_CONTAINERS)
+
+static inline unsigned container_slot(const void *object, unsigned mask)
+{
+    uintptr_t key = (uintptr_t)object >> 4;
+    return (unsigned)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+void intersections_refractive_indices(const intersection_t *hit,
+                                      const intersections_t *xs, double *n1,
+                                      double *n2)
+{
+    *n1 = 1.0;
+    *n2 = 1.0;
+
+    if (hit == NULL || xs == NULL || xs->count == 0)
+    {
+        return;
+    }
+
+    // Containers are kept as a stack with lazy deletion: leaving an object
+    // clears its stack entry, and dead entries are popped once they reach the
+    // top. A small open-addressed table maps each object to its live stack
+    // index, so every intersection costs O(1) instead of a linear search.
+    const shape_t *stack[MAX_REFRACTION_CONTAINERS];
+    int top          = 0;
+    unsigned tracked = 0;
+
+    unsigned table_size = 8;
+    while (table_size < 2 * (unsigned)xs->count &&
+           table_size < CONTAINER_TABLE_CAPACITY)
+    {
+        table_size <<= 1;
+    }
+    unsigned mask = table_size - 1;
+
+    const void *keys[CONTAINER_TABLE_CAPACITY];
+    int entries[CONTAINER_TABLE_CAPACITY];
+    memset(keys, 0, table_size * sizeof(keys[0]));
+
+    for (int j = 0; j < xs->count; j++)
+    {
+        const intersection_t *x = &xs->intersections[j];
+        bool is_hit = x == hit || (x->object == hit->object &&
+                                   x->instance == hit->instance &&
+                                   equal(x->t, hit->t));
+
+        if (is_hit && top > 0)
+        {
+            *n1 = stack[top - 1]->material.refractive_index;
+        }
+
+        const shape_t *container = intersection_material_shape(x);
+        unsigned slot            = container_slot(container, mask);
+        while (keys[slot] != NULL && keys[slot] != container)
+        {
+            slot = (slot + 1) & mask;
+        }
+        if (keys[slot] == NULL && tracked < MAX_REFRACTION_CONTAINERS)
+        {
+            keys[slot]    = container;
+            entries[slot] = -1;
+            tracked++;
+        }
+
+        // Past MAX_REFRACTION_CONTAINERS further containers are ignored, so
+        // a hit on one of them sees the innermost tracked container on both
+        // sides; the stack stays on the C stack to keep shading alloc-free.
+        bool tracked_container = keys[slot] != NULL;
+
+        if (tracked_container && entries[slot] >= 0)
+        {
+            stack[entries[slot]] = NULL;
+            entries[slot]        = -1;
+            while (top > 0 && stack[top - 1] == NULL)
+            {
+                top--;
+            }
+        }
+        else if (tracked_container && top < MAX_REFRACTION_CONTAINERS)
+        {
+            entries[slot] = top;
+            stack[top++]  = container;
+        }
+
+        if (is_hit)
+        {
+            *n2 = top > 0 ? stack[top - 1]->material.refractive_index : 1.0;
+            return;
+        }
+    }
+}
+
+// Distance that over_point and under_point are lifted off the surface.
+static inline double surface_offset(tuple_t p)
+{
+#ifdef RT_SINGLE_PRECISION
+    double extent = fmax(fabs(p.x), fmax(fabs(p.y), fabs(p.z)));
+    return fmax(EPSILON, extent * SURFACE_OFFSET_RELATIVE);
+#else
+    (void)p;
+    return EPSILON;
+#endif
+}
+
 computations_t intersections_prepare_computations(const intersection_t *i,
                                                   const ray_t *r,
                                                   const intersections_t *xs)
@@ -80,8 +304,23 @@ computations_t intersections_prepare_computations(const intersection_t *i,
     comps.object = i->object;
     comps.point  = ray_position(*r, comps.t);
     comps.eyev   = tuple_negate(r->direction);
-    comps.normalv =
-        shape_normal_at((const shape_t *)comps.object, comps.point, i);
+
+    // A shared mesh only knows its own space, so the normal is found there
+    // and carried out through the instance that placed it.
+    if (i->instance != NULL)
+    {
+        const shape_t *inst = (const shape_t *)i->instance;
+        tuple_t mesh_point  = world_to_object(inst, comps.point);
+        comps.normalv       = normal_to_world(
+            inst, shape_normal_at((const shape_t *)i->object, mesh_point, i));
+        comps.object = (void *)intersection_material_shape(i);
+    }
+    else
+    {
+        comps.normalv =
+            shape_normal_at((const shape_t *)comps.object, comps.point, i);
+    }
+
     comps.reflectv = tuple_reflect(r->direction, comps.normalv);
 
     if (tuple_dot(comps.normalv, comps.eyev) < 0)
@@ -94,82 +333,21 @@ computations_t intersections_prepare_computations(const intersection_t *i,
         comps.inside = false;
     }
 
+    double offset = surface_offset(comps.point);
     comps.over_point =
-        tuple_add(comps.point, tuple_scale(comps.normalv, EPSILON));
+        tuple_add(comps.point, tuple_scale(comps.normalv, offset));
     comps.under_point =
-        tuple_subtract(comps.point, tuple_scale(comps.normalv, EPSILON));
+        tuple_subtract(comps.point, tuple_scale(comps.normalv, offset));
 
     comps.n1 = 1.0;
     comps.n2 = 1.0;
 
-    if (xs != NULL)
+    // n1/n2 only feed the refracted colour and the Schlick term, both of which
+    // are zero for opaque materials, so skip the container walk for them.
+    if (xs != NULL &&
+        ((const shape_t *)comps.object)->material.transparency > 0)
     {
-        int containers_count = 0;
-        shape_t *containers[MAX_INTERSECTIONS];
-
-        for (int j = 0; j < xs->count; j++)
-        {
-
-            bool is_hit = (equal(xs->intersections[j].t, i->t) &&
-                           xs->intersections[j].object == i->object);
-
-            if (is_hit)
-            {
-                if (containers_count == 0)
-                {
-                    comps.n1 = 1.0;
-                }
-                else
-                {
-
-                    shape_t *containing_object =
-                        containers[containers_count - 1];
-                    comps.n1 = containing_object->material.refractive_index;
-                }
-            }
-
-            int object_index = -1;
-            for (int k = 0; k < containers_count; k++)
-            {
-                if (containers[k] == (shape_t *)xs->intersections[j].object)
-                {
-                    object_index = k;
-                    break;
-                }
-            }
-
-            if (object_index >= 0)
-            {
-                if (object_index < containers_count - 1)
-                {
-                    containers[object_index] = containers[containers_count - 1];
-                }
-                containers_count--;
-            }
-            else
-            {
-
-                containers[containers_count] =
-                    (shape_t *)xs->intersections[j].object;
-                containers_count++;
-            }
-
-            if (is_hit)
-            {
-                if (containers_count == 0)
-                {
-                    comps.n2 = 1.0;
-                }
-                else
-                {
-
-                    shape_t *containing_object =
-                        containers[containers_count - 1];
-                    comps.n2 = containing_object->material.refractive_index;
-                }
-                break;
-            }
-        }
+        intersections_refractive_indices(i, xs, &comps.n1, &comps.n2);
     }
 
     return comps;
@@ -205,16 +383,42 @@ double intersections_shlick(const computations_t *c)
                     ((1 - cos) * (1 - cos) * (1 - cos) * (1 - cos) * (1 - cos));
 }
 
-static int compare_intersections(const void *a, const void *b)
+static void sift_down_intersections(intersection_t *xs, int root, int count)
 {
-    const intersection_t *ia = (const intersection_t *)a;
-    const intersection_t *ib = (const intersection_t *)b;
+    intersection_t key = xs[root];
 
-    if (ia->t < ib->t)
-        return -1;
-    if (ia->t > ib->t)
-        return 1;
-    return 0;
+    for (int child = 2 * root + 1; child < count; child = 2 * root + 1)
+    {
+        if (child + 1 < count && xs[child + 1].t > xs[child].t)
+        {
+            child++;
+        }
+        if (xs[child].t <= key.t)
+        {
+            break;
+        }
+        xs[root] = xs[child];
+        root     = child;
+    }
+    xs[root] = key;
+}
+
+// In place and without recursion: qsort may allocate a merge buffer, which
+// the per-ray path must not do.
+static void heap_sort_intersections(intersection_t *xs, int count)
+{
+    for (int i = count / 2 - 1; i >= 0; i--)
+    {
+        sift_down_intersections(xs, i, count);
+    }
+
+    for (int end = count - 1; end > 0; end--)
+    {
+        intersection_t top = xs[0];
+        xs[0]              = xs[end];
+        xs[end]            = top;
+        sift_down_intersections(xs, 0, end);
+    }
 }
 
 static void insertion_sort_intersections(intersection_t *xs, int count)
@@ -246,7 +450,6 @@ void intersections_sort(intersections_t *xs)
     }
     else
     {
-        qsort(xs->intersections, (size_t)xs->count, sizeof(intersection_t),
-              compare_intersections);
+        heap_sort_intersections(xs->intersections, xs->count);
     }
 }
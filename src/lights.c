@@ -3,6 +3,12 @@
 #include "../include/lights.h"
 #include "../include/sequences.h"
 #include "../include/world.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// The calling thread's pixel dither, from which each light with patterns
+// picks the one to shade with.
+static _Thread_local double pixel_dither;
 
 light_t lights_point_light(const tuple_t position, const tuple_t intensity)
 {
@@ -48,23 +54,149 @@ light_t lights_area_light(const tuple_t corner, const tuple_t full_uvec,
                      .jitter_by = default_jitter};
 }
 
-tuple_t lights_point_on_light(const light_t *light, const int u, const int v)
+// The pattern the calling thread shades with.
+static int lights_pattern(const light_t *light)
 {
-    if (light == NULL)
+    if (light->patterns < 1 || light->type != LIGHT_AREA)
     {
-        return point(0, 0, 0);
+        return 0;
     }
 
+    int pattern = (int)(pixel_dither * light->patterns);
+    return pattern < light->patterns ? pattern : light->patterns - 1;
+}
+
+// The position of sample (u, v) when jittered by the given pattern.
+static tuple_t lights_pattern_point(const light_t *light, int pattern, int u,
+                                    int v)
+{
     int sample_index = v * light->usteps + u;
-    double u_jitter  = sequence_at(&light->jitter_by, sample_index * 2);
-    double v_jitter  = sequence_at(&light->jitter_by, sample_index * 2 + 1);
+    double u_jitter, v_jitter;
+    if (light->patterns > 0)
+    {
+        uint32_t index = (uint32_t)(pattern * light->samples + sample_index);
+        u_jitter       = sequence_hash(light->jitter_seed, index * 2);
+        v_jitter       = sequence_hash(light->jitter_seed, index * 2 + 1);
+    }
+    else
+    {
+        u_jitter = sequence_at(&light->jitter_by, sample_index * 2);
+        v_jitter = sequence_at(&light->jitter_by, sample_index * 2 + 1);
+    }
 
     tuple_t u_offset = tuple_scale(light->uvec, u + u_jitter);
     tuple_t v_offset = tuple_scale(light->vvec, v + v_jitter);
     return tuple_add(tuple_add(light->corner, u_offset), v_offset);
 }
 
-double lights_intensity_at(const light_t *light, const tuple_t point,
+tuple_t lights_point_on_light(const light_t *light, const int u, const int v)
+{
+    if (light == NULL)
+    {
+        return point(0, 0, 0);
+    }
+
+    return lights_pattern_point(light, lights_pattern(light), u, v);
+}
+
+bool lights_set_stratified_jitter(light_t *light, int patterns,
+                                  uint32_t seed)
+{
+    if (light == NULL || light->type != LIGHT_AREA || patterns < 1)
+    {
+        return false;
+    }
+
+    light->patterns    = patterns;
+    light->jitter_seed = seed;
+    lights_free_samples(light);
+    return true;
+}
+
+void lights_select_pixel(unsigned px, unsigned py)
+{
+    pixel_dither = sequence_pixel_dither(px, py);
+}
+
+int lights_sample_offset(const light_t *light)
+{
+    return light != NULL ? lights_pattern(light) * light->samples : 0;
+}
+
+bool lights_prepare_samples(light_t *light)
+{
+    if (light == NULL)
+    {
+        return false;
+    }
+
+    // The positions are refilled every time, as the light may have moved
+    // since; the arrays are only reallocated when their size changes.
+    int count = light->type == LIGHT_POINT ? 1 : light->usteps * light->vsteps;
+    int patterns =
+        light->type == LIGHT_AREA && light->patterns > 0 ? light->patterns : 1;
+    if (count < 1)
+    {
+        lights_free_samples(light);
+        return false;
+    }
+
+    size_t total = (size_t)count * (size_t)patterns;
+    if (light->sample_x == NULL || light->sample_count != total)
+    {
+        lights_free_samples(light);
+        light->sample_x = malloc(3 * total * sizeof(double));
+        if (light->sample_x == NULL)
+        {
+            fprintf(stderr, "Error: Failed to allocate light samples\n");
+            return false;
+        }
+        light->sample_y     = light->sample_x + total;
+        light->sample_z     = light->sample_y + total;
+        light->sample_count = total;
+    }
+
+    if (light->type == LIGHT_POINT)
+    {
+        light->sample_x[0] = light->position.x;
+        light->sample_y[0] = light->position.y;
+        light->sample_z[0] = light->position.z;
+        return true;
+    }
+
+    for (int pattern = 0; pattern < patterns; pattern++)
+    {
+        for (int v = 0; v < light->vsteps; v++)
+        {
+            for (int u = 0; u < light->usteps; u++)
+            {
+                int i            = pattern * count + v * light->usteps + u;
+                tuple_t position = lights_pattern_point(light, pattern, u, v);
+
+                light->sample_x[i] = position.x;
+                light->sample_y[i] = position.y;
+                light->sample_z[i] = position.z;
+            }
+        }
+    }
+    return true;
+}
+
+void lights_free_samples(light_t *light)
+{
+    if (light == NULL)
+    {
+        return;
+    }
+
+    free(light->sample_x);
+    light->sample_x     = NULL;
+    light->sample_y     = NULL;
+    light->sample_z     = NULL;
+    light->sample_count = 0;
+}
+
+double lights_intensity_at(const light_t *light, const tuple_t p,
                            const world_t *world)
 {
     if (light == NULL || world == NULL)
@@ -74,7 +206,7 @@ double lights_intensity_at(const light_t *light, const tuple_t point,
 
     if (light->type == LIGHT_POINT)
     {
-        if (world_is_shadowed(world, light->position, point))
+        if (world_is_shadowed(world, light->position, p))
         {
             return 0.0;
         }
@@ -84,12 +216,27 @@ double lights_intensity_at(const light_t *light, const tuple_t point,
     {
         double total = 0.0;
 
+        if (light->sample_x != NULL)
+        {
+            int offset = lights_sample_offset(light);
+            for (int i = offset; i < offset + light->samples; i++)
+            {
+                tuple_t light_position = point(
+                    light->sample_x[i], light->sample_y[i], light->sample_z[i]);
+                if (!world_is_shadowed(world, light_position, p))
+                {
+                    total += 1.0;
+                }
+            }
+            return total / light->samples;
+        }
+
         for (int v = 0; v < light->vsteps; v++)
         {
             for (int u = 0; u < light->usteps; u++)
             {
                 tuple_t light_position = lights_point_on_light(light, u, v);
-                if (!world_is_shadowed(world, light_position, point))
+                if (!world_is_shadowed(world, light_position, p))
                 {
                     total += 1.0;
                 }
@@ -1,9 +1,71 @@
 // main.c
 
+#include "../include/bvh.h"
+#include "../include/obj_parser.h"
 #include "../include/scenes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-int main(void)
+// Builds a BVH over an OBJ file and reports its quality; fails when a
+// child's box is outside its node's bounds.
+static int bvh_stats(const char *path, const char *builder_name,
+                     const char *threshold)
 {
+    bvh_builder_t builder = BVH_BUILD_MIDPOINT;
+    if (builder_name != NULL && !bvh_builder_parse(builder_name, &builder))
+    {
+        printf("Unknown BVH builder %s\n", builder_name);
+        return EXIT_FAILURE;
+    }
+
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        printf("Failed to open %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    obj_parser_t parser = obj_parse_file(file);
+    fclose(file);
+
+    group_t *mesh = obj_parser_get_default_group(&parser);
+    if (mesh == NULL || mesh->child_count == 0)
+    {
+        printf("No triangles found in %s\n", path);
+        obj_parser_free(&parser);
+        return EXIT_FAILURE;
+    }
+    parser.default_group = NULL;
+    obj_parser_free(&parser);
+
+    unsigned leaf = threshold ? (unsigned)strtoul(threshold, NULL, 10) : 4;
+    bvh_build((shape_t *)mesh, leaf, builder);
+    group_warm_bounds(mesh);
+
+    bvh_quality_t q = bvh_analyze(mesh);
+    printf("%s: %s builder, threshold %u\n", path, bvh_builder_name(builder),
+           leaf);
+    bvh_quality_print(&q, stdout);
+
+    group_free(mesh);
+    return q.invalid_bounds == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 2 && strcmp(argv[1], "bvh-stats") == 0)
+    {
+        return bvh_stats(argv[2], argc > 3 ? argv[3] : NULL,
+                         argc > 4 ? argv[4] : NULL);
+    }
+    if (argc > 1)
+    {
+        printf("Usage: %s [bvh-stats <file.obj> [builder] [threshold]]\n",
+               argv[0]);
+        return EXIT_FAILURE;
+    }
+
     // scene_cover();
     // scene_reflective();
     // scene_checkered();
@@ -1,6 +1,13 @@
 // material.c
 
 #include "../include/materials.h"
+#include "../include/simd.h"
+#include <stdint.h>
+#include <string.h>
+
+// Light samples gathered on the stack at a time for lights without a
+// sample table
+#define MATERIALS_SAMPLE_BLOCK 64
 
 material_t material(void)
 {
@@ -15,3 +22,164 @@ material_t material(void)
                         .has_pattern      = false,
                         .casts_shadow     = true};
 }
+
+// Adding 1.5 * 2^52 to a small whole number puts it in the low mantissa
+// bits, which converts between doubles and integers with bit operations
+// every ISA variant can vectorise.
+#define MATERIALS_ROUNDING_BIAS 6755399441055744.0
+
+// The exponent comes from the bits of x and the mantissa m, scaled into
+// [sqrt(1/2), sqrt(2)), from the series of ln(m) in t = (m - 1) / (m + 1).
+SIMD_KERNEL double materials_log2(double x)
+{
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    uint64_t exponent_bits = bits >> 52 | 0x4338000000000000ULL;
+    double exponent;
+    memcpy(&exponent, &exponent_bits, sizeof(exponent));
+    exponent -= MATERIALS_ROUNDING_BIAS + 1023.0;
+
+    bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+    double m;
+    memcpy(&m, &bits, sizeof(m));
+    bool high = m > M_SQRT2;
+    m         = high ? 0.5 * m : m;
+    exponent  = high ? exponent + 1.0 : exponent;
+
+    double t      = (m - 1.0) / (m + 1.0);
+    double t2     = t * t;
+    double series = 1.0 / 11;
+    for (int k = 9; k > 0; k -= 2)
+    {
+        series = 1.0 / k + t2 * series;
+    }
+    return exponent + 2.0 * t * series * M_LOG2E;
+}
+
+// 2^n for the nearest whole n is built in the exponent bits, and 2^(y - n)
+// from the Taylor series of e^((y - n) ln 2).
+SIMD_KERNEL double materials_exp2(double y)
+{
+    y               = y < -1022.0 ? -1022.0 : y;
+    double whole    = floor(y + 0.5);
+    double f        = (y - whole) * M_LN2;
+    double fraction = 1.0;
+    for (int k = 8; k > 0; k--)
+    {
+        fraction = 1.0 + fraction * f / k;
+    }
+
+    double biased = whole + MATERIALS_ROUNDING_BIAS;
+    uint64_t bits;
+    memcpy(&bits, &biased, sizeof(bits));
+    bits = (bits + 1023) << 52;
+    double scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return fraction * scale;
+}
+
+SIMD_KERNEL double materials_pow_impl(double x, double y)
+{
+    return x > 0.0 ? materials_exp2(y * materials_log2(x)) : 0.0;
+}
+
+SIMD_DISPATCH(double, materials_pow, (double x, double y), (x, y))
+
+// Written as a branch-free loop over the samples, so each ISA variant
+// evaluates two, four or eight of them per iteration.
+SIMD_KERNEL void materials_phong_samples_impl(
+    const double *x, const double *y, const double *z, int count, tuple_t p,
+    tuple_t eyev, tuple_t normalv, double shininess, double *diffuse,
+    double *specular)
+{
+    double normal_dot_eye = tuple_dot(normalv, eyev);
+    double diffuse_sum    = 0.0;
+    double specular_sum   = 0.0;
+
+    for (int i = 0; i < count; i++)
+    {
+        double lx     = x[i] - p.x;
+        double ly     = y[i] - p.y;
+        double lz     = z[i] - p.z;
+        double scale  = 1.0 / sqrt(fmax(lx * lx + ly * ly + lz * lz,
+                                        EPSILON * EPSILON));
+
+        double light_dot_normal =
+            (lx * normalv.x + ly * normalv.y + lz * normalv.z) * scale;
+        double light_dot_eye =
+            (lx * eyev.x + ly * eyev.y + lz * eyev.z) * scale;
+
+        // The light vector reflected about the normal, dotted with the eye.
+        double reflect_dot_eye =
+            2.0 * light_dot_normal * normal_dot_eye - light_dot_eye;
+        double factor = materials_pow_impl(
+            reflect_dot_eye > 0.0 ? reflect_dot_eye : 1.0, shininess);
+        double shine  = reflect_dot_eye > 0.0 ? factor : 0.0;
+
+        diffuse_sum  += fmax(light_dot_normal, 0.0);
+        specular_sum += light_dot_normal > 0.0 ? shine : 0.0;
+    }
+
+    *diffuse  += diffuse_sum;
+    *specular += specular_sum;
+}
+
+SIMD_DISPATCH_VOID(materials_phong_samples,
+                   (const double *x, const double *y, const double *z,
+                    int count, tuple_t p, tuple_t eyev, tuple_t normalv,
+                    double shininess, double *diffuse, double *specular),
+                   (x, y, z, count, p, eyev, normalv, shininess, diffuse,
+                    specular))
+
+void materials_light_factors(const light_t *l, tuple_t p, tuple_t eyev,
+                             tuple_t normalv, double shininess,
+                             double *diffuse, double *specular)
+{
+    *diffuse  = 0.0;
+    *specular = 0.0;
+    if (l == NULL || (l->type != LIGHT_POINT && l->type != LIGHT_AREA))
+    {
+        return;
+    }
+
+    int count = l->type == LIGHT_POINT ? 1 : l->usteps * l->vsteps;
+    if (l->sample_x != NULL)
+    {
+        int offset = lights_sample_offset(l);
+        materials_phong_samples(l->sample_x + offset, l->sample_y + offset,
+                                l->sample_z + offset, count, p, eyev, normalv,
+                                shininess, diffuse, specular);
+    }
+    else
+    {
+        double x[MATERIALS_SAMPLE_BLOCK];
+        double y[MATERIALS_SAMPLE_BLOCK];
+        double z[MATERIALS_SAMPLE_BLOCK];
+        for (int start = 0; start < count; start += MATERIALS_SAMPLE_BLOCK)
+        {
+            int n = count - start < MATERIALS_SAMPLE_BLOCK
+                        ? count - start
+                        : MATERIALS_SAMPLE_BLOCK;
+            for (int i = 0; i < n; i++)
+            {
+                int index = start + i;
+                tuple_t position =
+                    l->type == LIGHT_POINT
+                        ? l->position
+                        : lights_point_on_light(l, index % l->usteps,
+                                                index / l->usteps);
+                x[i] = position.x;
+                y[i] = position.y;
+                z[i] = position.z;
+            }
+            materials_phong_samples(x, y, z, n, p, eyev, normalv, shininess,
+                                    diffuse, specular);
+        }
+    }
+
+    if (l->type == LIGHT_AREA)
+    {
+        *diffuse /= l->samples;
+        *specular /= l->samples;
+    }
+}
@@ -0,0 +1,531 @@
+// sbvh.c
+
+#include "../include/bounds.h"
+#include "../include/bvh.h"
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct
+{
+    shape_t *shape;
+    bounding_box_t box;
+    bool cut;
+    bool owner;
+} sbvh_ref_t;
+
+typedef struct
+{
+    bounding_box_t box;
+    unsigned entries;
+    unsigned exits;
+} sbvh_bin_t;
+
+typedef struct
+{
+    int axis;
+    double position;
+    double cost;
+    bounding_box_t left;
+    bounding_box_t right;
+} sbvh_split_t;
+
+typedef struct
+{
+    unsigned threshold;
+    double overlap_area;
+    long budget;
+    shape_list_t orphans;
+} sbvh_t;
+
+static bool sbvh_clippable(const shape_t *s)
+{
+    return s->type == SHAPE_TRIANGLE || s->type == SHAPE_SMOOTH_TRIANGLE;
+}
+
+static tuple_t sbvh_centroid(bounding_box_t box)
+{
+    return tuple_scale(tuple_add(box.min, box.max), 0.5);
+}
+
+static void sbvh_add_crossing(bounding_box_t *box, tuple_t a, tuple_t b,
+                              int axis, double plane)
+{
+    double da = bvh_axis(a, axis) - plane;
+    double db = bvh_axis(b, axis) - plane;
+    if ((da < 0.0 && db > 0.0) || (da > 0.0 && db < 0.0))
+    {
+        bounds_add_point(box, tuple_add(a, tuple_scale(tuple_subtract(b, a),
+                                                       da / (da - db))));
+    }
+}
+
+// The bounds of the part of a triangle between lo and hi on axis, within
+// the box its reference was already cut to.
+static bounding_box_t sbvh_clip(const sbvh_ref_t *ref, int axis, double lo,
+                                double hi)
+{
+    const triangle_t *t = (const triangle_t *)ref->shape;
+    tuple_t v[3]        = {matrix_tmul(t->transform, t->p1),
+                           matrix_tmul(t->transform, t->p2),
+                           matrix_tmul(t->transform, t->p3)};
+
+    bounding_box_t box = bounding_box_empty();
+    for (int i = 0; i < 3; i++)
+    {
+        tuple_t a = v[i];
+        tuple_t b = v[(i + 1) % 3];
+        double x  = bvh_axis(a, axis);
+        if (x >= lo && x <= hi)
+        {
+            bounds_add_point(&box, a);
+        }
+        sbvh_add_crossing(&box, a, b, axis, lo);
+        sbvh_add_crossing(&box, a, b, axis, hi);
+    }
+
+    return bounds_is_empty(box) ? box : bounds_intersection(box, ref->box);
+}
+
+static unsigned sbvh_bin_index(real_t value, real_t min, double scale)
+{
+    double bin = (value - min) * scale;
+    return bin > 0.0 ? (unsigned)fmin(bin, SAH_BINS - 1) : 0;
+}
+
+static void sbvh_clear_bins(sbvh_bin_t *bins)
+{
+    for (int b = 0; b < SAH_BINS; b++)
+    {
+        bins[b] = (sbvh_bin_t){bounding_box_empty(), 0, 0};
+    }
+}
+
+// Finds the cheapest plane among SAH_BINS per axis at which to sort the
+// references to the side of their centroid, as the SAH builder does.
+static sbvh_split_t sbvh_object_split(const sbvh_ref_t *refs, size_t count)
+{
+    sbvh_split_t best        = {.axis = -1, .cost = INFINITY};
+    bounding_box_t centroids = bounding_box_empty();
+    for (size_t i = 0; i < count; i++)
+    {
+        bounds_add_point(&centroids, sbvh_centroid(refs[i].box));
+    }
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        double min    = bvh_axis(centroids.min, axis);
+        double extent = bvh_axis(centroids.max, axis) - min;
+        if (extent <= 0.0)
+        {
+            continue;
+        }
+
+        sbvh_bin_t bins[SAH_BINS];
+        sbvh_clear_bins(bins);
+        double scale = SAH_BINS / extent;
+        for (size_t i = 0; i < count; i++)
+        {
+            unsigned b = sbvh_bin_index(
+                bvh_axis(sbvh_centroid(refs[i].box), axis), min, scale);
+            bounds_add_box(&bins[b].box, &refs[i].box);
+            bins[b].entries++;
+        }
+
+        bounding_box_t right[SAH_BINS];
+        unsigned right_count[SAH_BINS];
+        bounding_box_t side = bounding_box_empty();
+        unsigned n          = 0;
+        for (int b = SAH_BINS - 1; b > 0; b--)
+        {
+            if (bins[b].entries > 0)
+            {
+                bounds_add_box(&side, &bins[b].box);
+                n += bins[b].entries;
+            }
+            right[b]       = side;
+            right_count[b] = n;
+        }
+
+        side = bounding_box_empty();
+        n    = 0;
+        for (int b = 0; b < SAH_BINS - 1; b++)
+        {
+            if (bins[b].entries > 0)
+            {
+                bounds_add_box(&side, &bins[b].box);
+                n += bins[b].entries;
+            }
+            if (n == 0 || right_count[b + 1] == 0)
+            {
+                continue;
+            }
+
+            double cost = bounds_surface_area(side) * n +
+                          bounds_surface_area(right[b + 1]) * right_count[b + 1];
+            if (cost < best.cost)
+            {
+                best = (sbvh_split_t){axis, min + (b + 1) / scale, cost, side,
+                                      right[b + 1]};
+            }
+        }
+    }
+    return best;
+}
+
+// Finds the cheapest plane among SAH_BINS per axis across the node's box,
+// where triangles that straddle it are cut and referenced from both sides.
+// Each triangle is clipped to every bin it spans; it enters the left side
+// in its first bin and leaves the right side in its last.
+static sbvh_split_t sbvh_spatial_split(const sbvh_ref_t *refs, size_t count,
+                                       bounding_box_t box)
+{
+    sbvh_split_t best = {.axis = -1, .cost = INFINITY};
+    for (int axis = 0; axis < 3; axis++)
+    {
+        double min    = bvh_axis(box.min, axis);
+        double extent = bvh_axis(box.max, axis) - min;
+        if (extent <= 0.0)
+        {
+            continue;
+        }
+
+        sbvh_bin_t bins[SAH_BINS];
+        sbvh_clear_bins(bins);
+        double scale = SAH_BINS / extent;
+        for (size_t i = 0; i < count; i++)
+        {
+            const sbvh_ref_t *ref = &refs[i];
+            if (!sbvh_clippable(ref->shape))
+            {
+                unsigned b = sbvh_bin_index(
+                    bvh_axis(sbvh_centroid(ref->box), axis), min, scale);
+                bounds_add_box(&bins[b].box, &ref->box);
+                bins[b].entries++;
+                bins[b].exits++;
+                continue;
+            }
+
+            unsigned first =
+                sbvh_bin_index(bvh_axis(ref->box.min, axis), min, scale);
+            unsigned last =
+                sbvh_bin_index(bvh_axis(ref->box.max, axis), min, scale);
+            for (unsigned b = first; b <= last; b++)
+            {
+                bounding_box_t piece =
+                    first == last
+                        ? ref->box
+                        : sbvh_clip(ref, axis, min + b / scale,
+                                    min + (b + 1) / scale);
+                if (!bounds_is_empty(piece))
+                {
+                    bounds_add_box(&bins[b].box, &piece);
+                }
+            }
+            bins[first].entries++;
+            bins[last].exits++;
+        }
+
+        bounding_box_t right[SAH_BINS];
+        unsigned right_count[SAH_BINS];
+        bounding_box_t side = bounding_box_empty();
+        unsigned n          = 0;
+        for (int b = SAH_BINS - 1; b > 0; b--)
+        {
+            if (!bounds_is_empty(bins[b].box))
+            {
+                bounds_add_box(&side, &bins[b].box);
+            }
+            n += bins[b].exits;
+            right[b]       = side;
+            right_count[b] = n;
+        }
+
+        side = bounding_box_empty();
+        n    = 0;
+        for (int b = 0; b < SAH_BINS - 1; b++)
+        {
+            if (!bounds_is_empty(bins[b].box))
+            {
+                bounds_add_box(&side, &bins[b].box);
+            }
+            n += bins[b].entries;
+            if (n == 0 || right_count[b + 1] == 0 ||
+                bounds_is_empty(side) || bounds_is_empty(right[b + 1]))
+            {
+                continue;
+            }
+
+            double cost = bounds_surface_area(side) * n +
+                          bounds_surface_area(right[b + 1]) * right_count[b + 1];
+            if (cost < best.cost)
+            {
+                best = (sbvh_split_t){axis, min + (b + 1) / scale, cost, side,
+                                      right[b + 1]};
+            }
+        }
+    }
+    return best;
+}
+
+// Claims one duplicate reference from the budget shared by every task.
+static bool sbvh_take_budget(sbvh_t *s)
+{
+    long left;
+#pragma omp atomic capture
+    left = s->budget--;
+    return left > 0;
+}
+
+// Sorts the references into left and right, which must each have room for
+// all of them, and returns how many went to the left. A straddling
+// triangle is cut in two while the budget lasts, with the left piece
+// keeping ownership; otherwise it goes whole to the side of its centroid.
+static size_t sbvh_partition(sbvh_t *s, const sbvh_ref_t *refs, size_t count,
+                             const sbvh_split_t *split, bool spatial,
+                             sbvh_ref_t *left, sbvh_ref_t *right,
+                             size_t *right_count)
+{
+    size_t l = 0, r = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const sbvh_ref_t *ref = &refs[i];
+        double lo             = bvh_axis(ref->box.min, split->axis);
+        double hi             = bvh_axis(ref->box.max, split->axis);
+        double centre = bvh_axis(sbvh_centroid(ref->box), split->axis);
+
+        if (spatial && sbvh_clippable(ref->shape) && lo < split->position &&
+            hi > split->position)
+        {
+            bounding_box_t lbox =
+                sbvh_clip(ref, split->axis, -INFINITY, split->position);
+            bounding_box_t rbox =
+                sbvh_clip(ref, split->axis, split->position, INFINITY);
+            if (!bounds_is_empty(lbox) && !bounds_is_empty(rbox) &&
+                sbvh_take_budget(s))
+            {
+                left[l++]  = (sbvh_ref_t){ref->shape, lbox, true, ref->owner};
+                right[r++] = (sbvh_ref_t){ref->shape, rbox, true, false};
+                continue;
+            }
+        }
+
+        if (centre < split->position)
+        {
+            left[l++] = *ref;
+        }
+        else
+        {
+            right[r++] = *ref;
+        }
+    }
+
+    *right_count = r;
+    return l;
+}
+
+static shape_t *sbvh_reference(sbvh_t *s, const sbvh_ref_t *ref)
+{
+    if (!ref->cut)
+    {
+        return ref->shape;
+    }
+
+    clipped_t *piece = clipped(ref->shape, ref->box, ref->owner);
+    if (piece == NULL && ref->owner)
+    {
+        printf("Error: Failed to allocate a spatial split reference\n");
+#pragma omp critical(sbvh_orphans)
+        shape_list_add(&s->orphans, ref->shape);
+    }
+    return (shape_t *)piece;
+}
+
+// Builds a subtree over refs and frees the array.
+static shape_t *sbvh_build(sbvh_t *s, sbvh_ref_t *refs, size_t count)
+{
+    if (count == 1)
+    {
+        shape_t *single = sbvh_reference(s, &refs[0]);
+        free(refs);
+        return single;
+    }
+
+    group_t *g = group();
+    if (g == NULL)
+    {
+#pragma omp critical(sbvh_orphans)
+        for (size_t i = 0; i < count; i++)
+        {
+            if (refs[i].owner)
+            {
+                shape_list_add(&s->orphans, refs[i].shape);
+            }
+        }
+        free(refs);
+        return NULL;
+    }
+    g->is_bvh_node = true;
+
+    sbvh_ref_t *left = NULL, *right = NULL;
+    size_t left_count = 0, right_count = 0;
+    if (count >= s->threshold)
+    {
+        left  = malloc(count * sizeof(sbvh_ref_t));
+        right = malloc(count * sizeof(sbvh_ref_t));
+    }
+
+    if (left == NULL || right == NULL)
+    {
+        free(left);
+        free(right);
+        for (size_t i = 0; i < count; i++)
+        {
+            group_add_child(g, sbvh_reference(s, &refs[i]));
+        }
+        free(refs);
+        bounds_of_group(g);
+        return (shape_t *)g;
+    }
+
+    bounding_box_t box = bounding_box_empty();
+    for (size_t i = 0; i < count; i++)
+    {
+        bounds_add_box(&box, &refs[i].box);
+    }
+
+    sbvh_split_t split = sbvh_object_split(refs, count);
+    bool spatial       = false;
+    long budget;
+#pragma omp atomic read
+    budget = s->budget;
+    if (budget > 0 && (split.axis < 0 || bounds_surface_area(
+                                  bounds_intersection(split.left, split.right)) >
+                                             s->overlap_area))
+    {
+        sbvh_split_t cut = sbvh_spatial_split(refs, count, box);
+        if (cut.axis >= 0 && cut.cost < split.cost)
+        {
+            split   = cut;
+            spatial = true;
+        }
+    }
+
+    if (split.axis >= 0)
+    {
+        left_count = sbvh_partition(s, refs, count, &split, spatial, left,
+                                    right, &right_count);
+    }
+
+    // Centroids that cannot be separated are split in half.
+    if (left_count == 0 || right_count == 0)
+    {
+        left_count  = count / 2;
+        right_count = count - left_count;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (i < left_count)
+            {
+                left[i] = refs[i];
+            }
+            else
+            {
+                right[i - left_count] = refs[i];
+            }
+        }
+    }
+    free(refs);
+
+    shape_t *left_node = NULL, *right_node = NULL;
+
+#pragma omp task shared(left_node) if (left_count >= SAH_TASK_MIN)
+    left_node = sbvh_build(s, left, left_count);
+
+    right_node = sbvh_build(s, right, right_count);
+#pragma omp taskwait
+
+    group_add_child(g, left_node);
+    group_add_child(g, right_node);
+
+    bounds_of_group(g);
+    return (shape_t *)g;
+}
+
+void divide_sbvh(shape_t *shape, unsigned threshold)
+{
+    if (shape == NULL || shape->type != SHAPE_GROUP)
+    {
+        return;
+    }
+
+    group_t *g       = (group_t *)shape;
+    sbvh_t s         = {0};
+    s.threshold      = threshold;
+    s.orphans        = shape_list_create();
+    sbvh_ref_t *refs = malloc((g->child_count + 1) * sizeof(sbvh_ref_t));
+    if (refs == NULL)
+    {
+        printf("Error: Failed to allocate the spatial split BVH build\n");
+        shape_list_free(&s.orphans);
+        return;
+    }
+
+    size_t count           = 0;
+    bounding_box_t bounds  = bounding_box_empty();
+    shape_list_t unbounded = shape_list_create();
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        shape_t *child = g->children[i];
+        if (child == NULL)
+        {
+            continue;
+        }
+
+        bounding_box_t box = bounds_parent_space_bounds_of(child);
+        if (bvh_is_bounded(box))
+        {
+            refs[count++] = (sbvh_ref_t){child, box, false, true};
+            bounds_add_box(&bounds, &box);
+        }
+        else
+        {
+            shape_list_add(&unbounded, child);
+        }
+    }
+
+    g->child_count = 0;
+    for (unsigned i = 0; i < unbounded.count; i++)
+    {
+        group_add_child(g, unbounded.shapes[i]);
+    }
+
+    shape_t *root = NULL;
+    if (count > 0)
+    {
+        s.overlap_area =
+            SBVH_OVERLAP_THRESHOLD * bounds_surface_area(bounds);
+        s.budget = (long)((double)count * SBVH_MAX_DUPLICATION);
+
+#pragma omp parallel
+#pragma omp single
+        root = sbvh_build(&s, refs, count);
+    }
+    else
+    {
+        free(refs);
+    }
+    bvh_adopt_root(g, root);
+
+    for (unsigned i = 0; i < s.orphans.count; i++)
+    {
+        group_add_child(g, s.orphans.shapes[i]);
+    }
+
+    g->build_threshold = threshold;
+    g->build_cost      = group_sah_cost(g);
+    g->builder         = BVH_BUILD_SBVH;
+
+    shape_list_free(&unbounded);
+    shape_list_free(&s.orphans);
+}
@@ -97,7 +97,8 @@ bool scene_dragon(void)
     matrix_t view_transform = transform_view(from, to, up);
     camera_set_transform(&c, view_transform);
 
-    canvas_t *image = camera_render(&c, &w);
+    canvas_t *image = camera_render_progressive(
+        &c, &w, "../renders/scene_dragon_preview.ppm");
     if (!image)
     {
         printf("Failed to render dragon scene\n");
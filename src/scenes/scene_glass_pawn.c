@@ -83,6 +83,7 @@ bool scene_glass_pawn(void)
                               0.75, 0.45, 0.55, 0.95, 0.05, 0.12};
     area_light.jitter_by   = sequence_from_array(jitter_values, 20);
     world_add_light(&w, area_light);
+    sequence_free(&area_light.jitter_by);
 
     camera_t c = camera(1000, 1000, M_PI / 3);
     matrix_t view_transform =
@@ -61,6 +61,7 @@ bool scene_shadow_glamour(void)
                               0.75, 0.45, 0.55, 0.95, 0.05, 0.12};
     area_light.jitter_by   = sequence_from_array(jitter_values, 20);
     world_add_light(&w, area_light);
+    sequence_free(&area_light.jitter_by);
 
     camera_t c = camera(400 * 8, 160 * 8, 0.7854);
     matrix_t view_transform =
@@ -44,7 +44,7 @@ bool scene_sphere_grid(void)
             }
         }
 
-        divide((shape_t *)grid, 1);
+        group_build_grid(grid);
 
         world_add_group(&w, grid);
     }
@@ -1,36 +1,79 @@
 // sequences.c
 
 #include "../include/sequences.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 sequence_t sequence_new(void)
 {
     sequence_t seq;
+    seq.values        = NULL;
     seq.count         = 0;
+    seq.capacity      = 0;
     seq.current_index = 0;
-    memset(seq.values, 0, sizeof(seq.values));
     return seq;
 }
 
+static bool sequence_reserve(sequence_t *seq, int capacity)
+{
+    if (capacity <= seq->capacity)
+    {
+        return true;
+    }
+
+    double *values = realloc(seq->values, (size_t)capacity * sizeof(double));
+    if (values == NULL)
+    {
+        printf("Failed to grow a sequence to %d values\n", capacity);
+        return false;
+    }
+
+    seq->values   = values;
+    seq->capacity = capacity;
+    return true;
+}
+
 void sequence_add(sequence_t *seq, double value)
 {
-    if (seq->count < MAX_SEQUENCE_LENGTH)
+    if (seq->count >= seq->capacity &&
+        !sequence_reserve(seq, seq->capacity == 0 ? 16 : seq->capacity * 2))
     {
-        seq->values[seq->count] = value;
-        seq->count++;
+        return;
     }
+
+    seq->values[seq->count] = value;
+    seq->count++;
 }
 
 sequence_t sequence_from_array(const double *values, int count)
 {
     sequence_t seq = sequence_new();
-    for (int i = 0; i < count && i < MAX_SEQUENCE_LENGTH; i++)
+    if (values == NULL || count <= 0 || !sequence_reserve(&seq, count))
     {
-        sequence_add(&seq, values[i]);
+        return seq;
     }
+
+    memcpy(seq.values, values, (size_t)count * sizeof(double));
+    seq.count = count;
     return seq;
 }
 
+sequence_t sequence_copy(const sequence_t *seq)
+{
+    sequence_t copy    = sequence_from_array(seq->values, seq->count);
+    copy.current_index = copy.count > 0 ? seq->current_index : 0;
+    return copy;
+}
+
+void sequence_free(sequence_t *seq)
+{
+    free(seq->values);
+    *seq = sequence_new();
+}
+
 double sequence_next(sequence_t *seq)
 {
     if (seq->count == 0)
@@ -50,4 +93,22 @@ double sequence_at(const sequence_t *seq, int index)
         return 0.5;
     }
     return seq->values[index % seq->count];
-}
\ No newline at end of file
+}
+
+double sequence_hash(uint32_t seed, uint32_t index)
+{
+    uint32_t h  = index + seed * 0x9e3779b9u;
+    h          ^= h >> 16;
+    h          *= 0x7feb352du;
+    h          ^= h >> 15;
+    h          *= 0x846ca68bu;
+    h          ^= h >> 16;
+    return (h >> 8) / 16777216.0;
+}
+
+double sequence_pixel_dither(unsigned px, unsigned py)
+{
+    // The inverses of the plastic number and of its square
+    double value = 0.5 + px * 0.7548776662466927 + py * 0.5698402909980532;
+    return value - floor(value);
+}
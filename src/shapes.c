@@ -1,6 +1,8 @@
 #include "../include/shapes.h"
 #include "../include/bounds.h"
+#include "../include/hot_path.h"
 #include "../include/patterns.h"
+#include "../include/stats.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,6 +40,11 @@ void shape_set_transform(shape_t *s, const matrix_t m)
     bounding_box_t local_bounds = bounds_of(s);
     s->world_bounds             = bounds_transform(local_bounds, m);
     s->world_bounds_cached      = true;
+
+    if (s->parent != NULL && ((shape_t *)s->parent)->type == SHAPE_GROUP)
+    {
+        group_invalidate_bounds_cache((group_t *)s->parent);
+    }
 }
 
 tuple_t shape_normal_at(const shape_t *s, const tuple_t world_point,
@@ -173,41 +180,67 @@ tuple_t normal_at(const void *shape, const tuple_t world_point,
     return shape_normal_at((const shape_t *)shape, world_point, hit);
 }
 
-__attribute__((hot)) intersections_t shape_intersect(const shape_t *s,
-                                                     const ray_t r)
+// Appends the hits of r with s to xs, unsorted.
+__attribute__((hot)) void shape_intersect(const shape_t *s, const ray_t r,
+                                          intersections_t *xs)
 {
-    if (__builtin_expect(s == NULL, 0))
+    if (__builtin_expect(s == NULL || xs == NULL, 0))
     {
-        return empty_intersections();
+        return;
     }
 
-    if (!bounds_intersects(s->world_bounds, r))
+    // A group tests its own bounds in group_local_intersect, so it is not
+    // culled, or counted, twice.
+    if (s->type != SHAPE_GROUP)
     {
-        return empty_intersections();
+        STATS_ADD(STAT_BOUNDS_TESTS, 1);
+        if (!bounds_intersects(s->world_bounds, r))
+        {
+            return;
+        }
     }
 
+    STATS_ADD(STAT_PRIMITIVE_TESTS, s->type != SHAPE_GROUP &&
+                                        s->type != SHAPE_INSTANCE &&
+                                        s->type != SHAPE_CLIPPED);
+
     ray_t local_ray = ray_transform(r, s->inverse_transform);
 
     switch (s->type)
     {
     case SHAPE_SPHERE:
-        return sphere_intersect((sphere_t *)s, local_ray);
+        sphere_intersect((sphere_t *)s, local_ray, xs);
+        return;
     case SHAPE_PLANE:
-        return plane_intersect((plane_t *)s, local_ray);
+        plane_intersect((plane_t *)s, local_ray, xs);
+        return;
     case SHAPE_CUBE:
-        return cube_intersect((cube_t *)s, local_ray);
+        cube_intersect((cube_t *)s, local_ray, xs);
+        return;
     case SHAPE_CYLINDER:
-        return cylinder_intersect((cylinder_t *)s, local_ray);
+        cylinder_intersect((cylinder_t *)s, local_ray, xs);
+        return;
     case SHAPE_CONE:
-        return cone_intersect((cone_t *)s, local_ray);
+        cone_intersect((cone_t *)s, local_ray, xs);
+        return;
     case SHAPE_TRIANGLE:
-        return triangle_intersect((triangle_t *)s, local_ray);
+        triangle_intersect((triangle_t *)s, local_ray, xs);
+        return;
     case SHAPE_SMOOTH_TRIANGLE:
-        return smooth_triangle_intersect((smooth_triangle_t *)s, local_ray);
+        smooth_triangle_intersect((smooth_triangle_t *)s, local_ray, xs);
+        return;
     case SHAPE_GROUP:
-        return group_intersect((group_t *)s, local_ray);
+        group_local_intersect((group_t *)s, local_ray, xs);
+        return;
+    case SHAPE_INSTANCE:
+        instance_intersect((instance_t *)s, local_ray, xs);
+        return;
+    case SHAPE_CLIPPED:
+        clipped_intersect((clipped_t *)s, local_ray, xs);
+        return;
     case SHAPE_TEST:
-        return test_shape_intersect((test_shape_t *)s, local_ray);
+        test_shape_intersect((test_shape_t *)s, local_ray, xs);
+        return;
     }
     __builtin_unreachable();
 }
@@ -268,15 +301,18 @@ test_shape_t test_shape(void)
     return t;
 }
 
-intersections_t test_shape_intersect(test_shape_t *t, ray_t r)
+void test_shape_intersect(test_shape_t *t, ray_t r, intersections_t *xs)
 {
+    (void)xs;
+
     if (t == NULL)
     {
-        return empty_intersections();
+        return;
     }
 
+    // Test shapes record the ray they were given, so they cannot be
+    // rendered from several threads.
+    hot_path_shared_write("a test shape");
     t->saved_ray     = r;
     t->has_saved_ray = true;
-
-    return empty_intersections();
 }
\ No newline at end of file
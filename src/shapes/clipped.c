@@ -0,0 +1,80 @@
+#include "../../include/shapes.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+clipped_t *clipped(shape_t *target, bounding_box_t box, bool owns_target)
+{
+    clipped_t *c = malloc(sizeof(clipped_t));
+    if (c == NULL)
+    {
+        return NULL;
+    }
+
+    c->type                         = SHAPE_CLIPPED;
+    c->transform                    = IDENTITY;
+    c->inverse_transform            = IDENTITY;
+    c->transposed_inverse_transform = IDENTITY;
+    c->material                     = target->material;
+    c->parent                       = NULL;
+
+    c->world_bounds        = box;
+    c->world_bounds_cached = true;
+
+    c->target      = target;
+    c->owns_target = owns_target;
+    if (owns_target)
+    {
+        target->parent = c;
+    }
+
+    return c;
+}
+
+void clipped_free(clipped_t *c)
+{
+    if (c == NULL)
+    {
+        return;
+    }
+
+    if (c->owns_target)
+    {
+        free(c->target);
+    }
+    free(c);
+}
+
+static bool clipped_contains(bounding_box_t box, tuple_t p)
+{
+    return p.x >= box.min.x - EPSILON && p.x <= box.max.x + EPSILON &&
+           p.y >= box.min.y - EPSILON && p.y <= box.max.y + EPSILON &&
+           p.z >= box.min.z - EPSILON && p.z <= box.max.z + EPSILON;
+}
+
+void clipped_intersect(const clipped_t *c, ray_t r, intersections_t *xs)
+{
+    if (c == NULL || c->target == NULL || xs == NULL)
+    {
+        return;
+    }
+
+    // Boxes are padded by EPSILON so a hit on a split plane is never lost;
+    // the pieces on both sides may then see it, and the second is dropped.
+    // Pieces of one triangle see the same ray, so both report exactly the
+    // same distance.
+    int first = xs->count;
+    shape_intersect(c->target, r, xs);
+
+    int kept = first;
+    for (int i = first; i < xs->count; i++)
+    {
+        intersection_t hit = xs->intersections[i];
+        if (clipped_contains(c->world_bounds, ray_position(r, hit.t)))
+        {
+            xs->intersections[kept++] = hit;
+        }
+    }
+    xs->count = kept;
+    intersections_drop_repeats(xs, first);
+}
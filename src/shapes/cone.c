@@ -2,14 +2,15 @@
 #include <float.h>
 #include <math.h>
 
-static bool check_cap(ray_t ray, double t, double y)
+static bool cone_check_cap(ray_t ray, double t, double y)
 {
     double x = ray.origin.x + t * ray.direction.x;
     double z = ray.origin.z + t * ray.direction.z;
     return (x * x + z * z) <= (y * y);
 }
 
-static void intersect_caps(const cone_t *cone, ray_t ray, intersections_t *xs)
+static void cone_intersect_caps(const cone_t *cone, ray_t ray,
+                                intersections_t *xs)
 {
     if (!cone->closed || fabs(ray.direction.y) < EPSILON)
     {
@@ -17,15 +18,15 @@ static void intersect_caps(const cone_t *cone, ray_t ray, intersections_t *xs)
     }
 
     double t = (cone->minimum - ray.origin.y) / ray.direction.y;
-    if (check_cap(ray, t, cone->minimum))
+    if (cone_check_cap(ray, t, cone->minimum))
     {
-        xs->intersections[xs->count++] = intersection(t, (void *)cone);
+        intersections_add(xs, intersection(t, (void *)cone));
     }
 
     t = (cone->maximum - ray.origin.y) / ray.direction.y;
-    if (check_cap(ray, t, cone->maximum))
+    if (cone_check_cap(ray, t, cone->maximum))
     {
-        xs->intersections[xs->count++] = intersection(t, (void *)cone);
+        intersections_add(xs, intersection(t, (void *)cone));
     }
 }
 
@@ -39,14 +40,11 @@ cone_t cone(void)
     return c;
 }
 
-intersections_t cone_intersect(const cone_t *c, ray_t r)
+void cone_intersect(const cone_t *c, ray_t r, intersections_t *xs)
 {
-    intersections_t result;
-    result.count = 0;
-
-    if (c == NULL)
+    if (c == NULL || xs == NULL)
     {
-        return result;
+        return;
     }
 
     double a = r.direction.x * r.direction.x - r.direction.y * r.direction.y +
@@ -59,34 +57,46 @@ intersections_t cone_intersect(const cone_t *c, ray_t r)
     double c_coef = r.origin.x * r.origin.x - r.origin.y * r.origin.y +
                     r.origin.z * r.origin.z;
 
-    if (fabs(a) < EPSILON)
+    // The ray is only as precise as real_t, so a and the discriminant are
+    // only zero to within a rounding error scaled by the terms behind them.
+    double a_scale = r.direction.x * r.direction.x +
+                     r.direction.y * r.direction.y +
+                     r.direction.z * r.direction.z;
+    double a_tolerance =
+        fmax(EPSILON, QUADRIC_ROUNDING_ULPS * REAL_EPSILON * a_scale);
+
+    if (fabs(a) < a_tolerance)
     {
         if (fabs(b) < EPSILON)
         {
-            intersect_caps(c, r, &result);
-            return result;
+            cone_intersect_caps(c, r, xs);
+            return;
         }
 
         double t = -c_coef / (2.0 * b);
         double y = r.origin.y + t * r.direction.y;
         if (c->minimum < y && y < c->maximum)
         {
-            result.intersections[result.count++] = intersection(t, (void *)c);
+            intersections_add(xs, intersection(t, (void *)c));
         }
 
-        intersect_caps(c, r, &result);
-        return result;
+        cone_intersect_caps(c, r, xs);
+        return;
     }
 
-    double disc = b * b - 4.0 * a * c_coef;
+    double disc          = b * b - 4.0 * a * c_coef;
+    double disc_rounding = QUADRIC_ROUNDING_ULPS * REAL_EPSILON *
+                           (b * b + fabs(4.0 * a * c_coef));
 
-    if (disc < -EPSILON)
+    if (disc < -fmax(EPSILON, disc_rounding))
     {
-        intersect_caps(c, r, &result);
-        return result;
+        cone_intersect_caps(c, r, xs);
+        return;
     }
 
-    if (disc < 0.0)
+    // A tangent ray touches the cone once; rounding must not split that
+    // into two hits either side of the true distance.
+    if (disc < disc_rounding)
     {
         disc = 0.0;
     }
@@ -105,16 +115,14 @@ intersections_t cone_intersect(const cone_t *c, ray_t r)
     double y0 = r.origin.y + t0 * r.direction.y;
     if (c->minimum < y0 && y0 < c->maximum)
     {
-        result.intersections[result.count++] = intersection(t0, (void *)c);
+        intersections_add(xs, intersection(t0, (void *)c));
     }
 
     double y1 = r.origin.y + t1 * r.direction.y;
     if (c->minimum < y1 && y1 < c->maximum)
     {
-        result.intersections[result.count++] = intersection(t1, (void *)c);
+        intersections_add(xs, intersection(t1, (void *)c));
     }
 
-    intersect_caps(c, r, &result);
-
-    return result;
+    cone_intersect_caps(c, r, xs);
 }
@@ -11,30 +11,27 @@ cube_t cube(void)
     return c;
 }
 
-intersections_t cube_intersect(const cube_t *c, ray_t r)
+void cube_intersect(const cube_t *c, ray_t r, intersections_t *xs)
 {
-    if (c == NULL)
+    if (c == NULL || xs == NULL)
     {
-        return empty_intersections();
+        return;
     }
 
-    double xtmin, xtmax, ytmin, ytmax, ztmin, ztmax;
+    real_t xtmin, xtmax, ytmin, ytmax, ztmin, ztmax;
 
     check_axis(r.origin.x, r.direction.x, &xtmin, &xtmax);
     check_axis(r.origin.y, r.direction.y, &ytmin, &ytmax);
     check_axis(r.origin.z, r.direction.z, &ztmin, &ztmax);
 
-    double tmin = MAX(MAX(xtmin, ytmin), ztmin);
-    double tmax = MIN(MIN(xtmax, ytmax), ztmax);
+    real_t tmin = MAX(MAX(xtmin, ytmin), ztmin);
+    real_t tmax = MIN(MIN(xtmax, ytmax), ztmax);
 
     if (tmin > tmax)
     {
-        return empty_intersections();
+        return;
     }
 
-    intersections_t result;
-    result.count            = 2;
-    result.intersections[0] = intersection(tmin, (void *)c);
-    result.intersections[1] = intersection(tmax, (void *)c);
-    return result;
+    intersections_add(xs, intersection(tmin, (void *)c));
+    intersections_add(xs, intersection(tmax, (void *)c));
 }
\ No newline at end of file
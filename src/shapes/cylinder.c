@@ -2,15 +2,15 @@
 #include <float.h>
 #include <math.h>
 
-static bool check_cap(ray_t ray, double t)
+static bool cylinder_check_cap(ray_t ray, double t)
 {
     double x = ray.origin.x + t * ray.direction.x;
     double z = ray.origin.z + t * ray.direction.z;
     return (x * x + z * z) <= 1.0;
 }
 
-static void intersect_caps(const cylinder_t *cyl, ray_t ray,
-                           intersections_t *xs)
+static void cylinder_intersect_caps(const cylinder_t *cyl, ray_t ray,
+                                    intersections_t *xs)
 {
     if (!cyl->closed || fabs(ray.direction.y) < EPSILON)
     {
@@ -18,15 +18,15 @@ static void intersect_caps(const cylinder_t *cyl, ray_t ray,
     }
 
     double t = (cyl->minimum - ray.origin.y) / ray.direction.y;
-    if (check_cap(ray, t))
+    if (cylinder_check_cap(ray, t))
     {
-        xs->intersections[xs->count++] = intersection(t, (void *)cyl);
+        intersections_add(xs, intersection(t, (void *)cyl));
     }
 
     t = (cyl->maximum - ray.origin.y) / ray.direction.y;
-    if (check_cap(ray, t))
+    if (cylinder_check_cap(ray, t))
     {
-        xs->intersections[xs->count++] = intersection(t, (void *)cyl);
+        intersections_add(xs, intersection(t, (void *)cyl));
     }
 }
 
@@ -40,14 +40,11 @@ cylinder_t cylinder(void)
     return c;
 }
 
-intersections_t cylinder_intersect(const cylinder_t *c, ray_t r)
+void cylinder_intersect(const cylinder_t *c, ray_t r, intersections_t *xs)
 {
-    intersections_t result;
-    result.count = 0;
-
-    if (c == NULL)
+    if (c == NULL || xs == NULL)
     {
-        return result;
+        return;
     }
 
     double a = r.direction.x * r.direction.x + r.direction.z * r.direction.z;
@@ -69,18 +66,16 @@ intersections_t cylinder_intersect(const cylinder_t *c, ray_t r)
             double y0 = r.origin.y + t0 * r.direction.y;
             if (c->minimum < y0 && y0 < c->maximum)
             {
-                result.intersections[result.count++] = intersection(t0, (void *)c);
+                intersections_add(xs, intersection(t0, (void *)c));
             }
 
             double y1 = r.origin.y + t1 * r.direction.y;
             if (c->minimum < y1 && y1 < c->maximum)
             {
-                result.intersections[result.count++] = intersection(t1, (void *)c);
+                intersections_add(xs, intersection(t1, (void *)c));
             }
         }
     }
 
-    intersect_caps(c, r, &result);
-
-    return result;
+    cylinder_intersect_caps(c, r, xs);
 }
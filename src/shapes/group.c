@@ -1,6 +1,9 @@
 #include "../../include/bounds.h"
+#include "../../include/bvh.h"
 #include "../../include/dynamic_array.h"
+#include "../../include/grid.h"
 #include "../../include/shapes.h"
+#include "../../include/stats.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,6 +41,12 @@ group_t *group(void)
     g->world_bounds        = bounding_box_empty();
     g->world_bounds_cached = false;
 
+    g->is_bvh_node     = false;
+    g->build_threshold = 0;
+    g->build_cost      = 0.0;
+    g->builder         = BVH_BUILD_MIDPOINT;
+    g->grid            = NULL;
+
     return g;
 }
 
@@ -54,11 +63,19 @@ static bool group_ensure_capacity(group_t *g)
     return true;
 }
 
-static void group_invalidate_bounds_cache(group_t *g)
+// Marks g and the groups above it dirty; group_warm_bounds refits them once
+// before the next render, however many children moved in between.
+void group_invalidate_bounds_cache(group_t *g)
 {
     while (g != NULL)
     {
-        g->bounds_cached = false;
+        g->bounds_cached       = false;
+        g->world_bounds        = bounding_box_empty();
+        g->world_bounds_cached = false;
+        if (g->grid != NULL)
+        {
+            g->grid->stale = true;
+        }
         if (g->parent != NULL && ((shape_t *)g->parent)->type == SHAPE_GROUP)
         {
             g = (group_t *)g->parent;
@@ -70,6 +87,234 @@ static void group_invalidate_bounds_cache(group_t *g)
     }
 }
 
+// Recomputes the cached bounds of a single group from its children's
+// current bounds, without descending into child groups.
+static void group_refit_node(group_t *g)
+{
+    bounding_box_t box = bounding_box_empty();
+
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        if (g->children[i] != NULL)
+        {
+            bounding_box_t cbox = bounds_parent_space_bounds_of(g->children[i]);
+            bounds_add_box(&box, &cbox);
+        }
+    }
+
+    g->cached_bounds_min   = box.min;
+    g->cached_bounds_max   = box.max;
+    g->bounds_cached       = true;
+    g->world_bounds        = bounds_transform(box, g->transform);
+    g->world_bounds_cached = true;
+    if (g->grid != NULL)
+    {
+        g->grid->stale = true;
+    }
+}
+
+void group_refit(group_t *g)
+{
+    if (g == NULL)
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        if (g->children[i] != NULL && g->children[i]->type == SHAPE_GROUP)
+        {
+            group_refit((group_t *)g->children[i]);
+        }
+    }
+
+    group_refit_node(g);
+}
+
+// Fills the bounds cache of every nested group up front, and rebuilds grids
+// whose children changed, so the threads of a render only ever read them.
+// It writes to the groups, so it runs on one thread before a render starts.
+void group_warm_bounds(group_t *g)
+{
+    if (g == NULL)
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        shape_t *child = g->children[i];
+        if (child == NULL)
+        {
+            continue;
+        }
+
+        if (child->type == SHAPE_GROUP)
+        {
+            group_warm_bounds((group_t *)child);
+        }
+        else if (child->type == SHAPE_INSTANCE)
+        {
+            shape_t *mesh = ((instance_t *)child)->mesh;
+            if (mesh != NULL && mesh->type == SHAPE_GROUP)
+            {
+                group_warm_bounds((group_t *)mesh);
+            }
+        }
+    }
+
+    bounding_box_t box = bounds_of_group(g);
+    if (!g->world_bounds_cached)
+    {
+        g->world_bounds        = bounds_transform(box, g->transform);
+        g->world_bounds_cached = true;
+    }
+    if (g->grid != NULL && g->grid->stale)
+    {
+        group_build_grid(g);
+    }
+}
+
+// Replaces any grid g has with one over its current children. On failure
+// g keeps testing every child.
+bool group_build_grid(group_t *g)
+{
+    if (g == NULL)
+    {
+        return false;
+    }
+
+    grid_t *grid = grid_build(g);
+    if (grid == NULL)
+    {
+        printf("Error: Failed to allocate a grid for a group\n");
+        group_clear_grid(g);
+        return false;
+    }
+
+    grid_free(g->grid);
+    g->grid = grid;
+    return true;
+}
+
+void group_clear_grid(group_t *g)
+{
+    if (g == NULL)
+    {
+        return;
+    }
+
+    grid_free(g->grid);
+    g->grid = NULL;
+}
+
+// Surface area heuristic: every child costs a bounds test, and a child's
+// own cost is weighted by the chance that a ray through this group also
+// passes through the child's bounds.
+double group_sah_cost(const group_t *g)
+{
+    if (g == NULL)
+    {
+        return 0.0;
+    }
+
+    double area = bounds_surface_area(bounds_of_group(g));
+    double cost = 0.0;
+
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        const shape_t *child = g->children[i];
+        if (child == NULL)
+        {
+            continue;
+        }
+
+        double child_area =
+            bounds_surface_area(bounds_parent_space_bounds_of(child));
+        double probability = 1.0;
+        if (isfinite(area) && isfinite(child_area) && area > 0)
+        {
+            probability = fmin(1.0, child_area / area);
+        }
+
+        double child_cost = child->type == SHAPE_GROUP
+                                ? group_sah_cost((const group_t *)child)
+                                : BVH_INTERSECTION_COST;
+        cost += BVH_TRAVERSAL_COST + probability * child_cost;
+    }
+
+    return cost;
+}
+
+// Moves the primitives of every group that divide() created back into g and
+// frees those groups; groups built by the caller are kept as leaves, and
+// triangles cut by spatial splits are taken out of their pieces.
+static void group_collect_leaves(group_t *g, shape_list_t *leaves)
+{
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        shape_t *child = g->children[i];
+        if (child == NULL)
+        {
+            continue;
+        }
+
+        if (child->type == SHAPE_GROUP && ((group_t *)child)->is_bvh_node)
+        {
+            group_t *node = (group_t *)child;
+            group_collect_leaves(node, leaves);
+            free(node->children);
+            free(node);
+        }
+        else if (child->type == SHAPE_CLIPPED)
+        {
+            clipped_t *piece = (clipped_t *)child;
+            if (piece->owns_target)
+            {
+                shape_list_add(leaves, piece->target);
+            }
+            free(piece);
+        }
+        else
+        {
+            shape_list_add(leaves, child);
+        }
+    }
+    g->child_count = 0;
+}
+
+bool group_refit_or_rebuild(group_t *g)
+{
+    if (g == NULL)
+    {
+        return false;
+    }
+
+    // The pieces of a spatial split keep the boxes they were cut to, so
+    // such a tree cannot be refitted and is always rebuilt.
+    if (g->builder != BVH_BUILD_SBVH)
+    {
+        group_refit(g);
+
+        if (g->build_cost <= 0.0 ||
+            group_sah_cost(g) <= g->build_cost * BVH_REBUILD_COST_RATIO)
+        {
+            return false;
+        }
+    }
+
+    shape_list_t leaves = shape_list_create();
+    group_collect_leaves(g, &leaves);
+    for (unsigned i = 0; i < leaves.count; i++)
+    {
+        group_add_child(g, leaves.shapes[i]);
+    }
+    shape_list_free(&leaves);
+
+    bvh_build((shape_t *)g, g->build_threshold, g->builder);
+    return true;
+}
+
 void group_add_child(group_t *g, shape_t *s)
 {
     if (s == NULL || !group_ensure_capacity(g))
@@ -101,93 +346,94 @@ bool group_includes(const group_t *g, const shape_t *s)
     return false;
 }
 
-intersections_t group_local_intersect(const group_t *g, ray_t r)
+void group_local_intersect(const group_t *g, ray_t r, intersections_t *xs)
 {
-    if (g == NULL)
+    if (g == NULL || xs == NULL)
     {
-        return empty_intersections();
+        return;
     }
 
-    intersections_t result;
-    result.count = 0;
+    STATS_ADD(STAT_NODE_VISITS, 1);
 
     if (g->child_count > 0)
     {
+        STATS_ADD(STAT_BOUNDS_TESTS, 1);
         bounding_box_t group_bounds = bounds_of_group(g);
         if (!bounds_intersects(group_bounds, r))
         {
-            return result;
+            return;
         }
     }
 
-    for (unsigned i = 0; i < g->child_count; i++)
+    if (g->grid != NULL && !g->grid->stale)
     {
-
-        intersections_t child_xs = shape_intersect(g->children[i], r);
-
-        for (int j = 0; j < child_xs.count; j++)
-        {
-            if (result.count < MAX_INTERSECTIONS)
-            {
-                result.intersections[result.count] = child_xs.intersections[j];
-                result.count++;
-            }
-            else
-            {
-                static int overflow_warned = 0;
-                if (!overflow_warned)
-                {
-                    printf("WARNING: MAX_INTERSECTIONS overflow in "
-                           "group_local_intersect\n");
-                    overflow_warned = 1;
-                }
-            }
-        }
+        grid_intersect(g->grid, r, xs);
+        return;
     }
 
-    if (result.count > 1)
+    for (unsigned i = 0; i < g->child_count; i++)
     {
-        intersections_sort(&result);
+        shape_intersect(g->children[i], r, xs);
     }
-
-    return result;
 }
 
-intersections_t group_intersect(const group_t *g, ray_t r)
+// Children append to xs directly and only the outermost call sorts, so
+// nested groups neither copy nor re-sort each other's hits.
+void group_intersect(const group_t *g, ray_t r, intersections_t *xs)
 {
-    return group_local_intersect(g, r);
+    group_local_intersect(g, r, xs);
+    intersections_sort(xs);
 }
 
-void group_free(group_t *g)
+// Frees the children of g, its child array and its grid, but not g itself,
+// which may live inside a world's object array.
+void group_free_children(group_t *g)
 {
     if (g == NULL)
     {
         return;
     }
 
-    if (g->children != NULL)
+    group_clear_grid(g);
+    if (g->children == NULL)
     {
-        for (unsigned i = 0; i < g->child_count; i++)
+        return;
+    }
+
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        if (g->children[i] != NULL)
         {
-            if (g->children[i] != NULL)
-            {
-                shape_t *child = g->children[i];
-                child->parent  = NULL;
+            shape_t *child = g->children[i];
+            child->parent  = NULL;
 
-                if (child->type == SHAPE_GROUP)
-                {
-                    group_free((group_t *)child);
-                }
-                else
-                {
-                    free(child);
-                }
+            if (child->type == SHAPE_GROUP)
+            {
+                group_free((group_t *)child);
+            }
+            else if (child->type == SHAPE_CLIPPED)
+            {
+                clipped_free((clipped_t *)child);
+            }
+            else
+            {
+                free(child);
             }
         }
-        free(g->children);
-        g->children = NULL;
+    }
+    free(g->children);
+    g->children = NULL;
+}
+
+void group_free(group_t *g)
+{
+    if (g == NULL)
+    {
+        return;
     }
 
+    group_free_children(g);
+
     g->child_count       = 0;
     g->children_capacity = 0;
 
@@ -327,6 +573,8 @@ void make_subgroup(group_t *parent_group, shape_list_t *children)
         return;
     }
 
+    subgroup->is_bvh_node = true;
+
     for (unsigned i = 0; i < children->count; i++)
     {
         if (children->shapes[i] != NULL)
@@ -354,6 +602,14 @@ void divide(shape_t *shape, unsigned threshold)
     }
 
     divide_recursive(shape, threshold, 10);
+
+    if (shape->type == SHAPE_GROUP)
+    {
+        group_t *g         = (group_t *)shape;
+        g->build_threshold = threshold;
+        g->build_cost      = group_sah_cost(g);
+        g->builder         = BVH_BUILD_MIDPOINT;
+    }
 }
 
 void divide_recursive(shape_t *shape, unsigned threshold, unsigned max_depth)
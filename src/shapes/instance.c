@@ -0,0 +1,53 @@
+#include "../../include/bounds.h"
+#include "../../include/shapes.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+instance_t instance(shape_t *mesh)
+{
+    instance_t i;
+    i.type                         = SHAPE_INSTANCE;
+    i.transform                    = IDENTITY;
+    i.inverse_transform            = IDENTITY;
+    i.transposed_inverse_transform = IDENTITY;
+    i.material                     = material();
+    i.parent                       = NULL;
+
+    i.mesh              = mesh;
+    i.material_override = false;
+
+    i.world_bounds        = bounds_parent_space_bounds_of(mesh);
+    i.world_bounds_cached = true;
+
+    return i;
+}
+
+void instance_set_material(instance_t *i, material_t m)
+{
+    if (i == NULL)
+    {
+        return;
+    }
+
+    i->material          = m;
+    i->material_override = true;
+}
+
+void instance_intersect(const instance_t *i, ray_t r, intersections_t *xs)
+{
+    if (i == NULL || i->mesh == NULL || xs == NULL)
+    {
+        return;
+    }
+
+    // The ray is already in the instance's space, so the shared mesh is
+    // traversed exactly as if it were placed there.
+    int first = xs->count;
+    shape_intersect(i->mesh, r, xs);
+
+    for (int j = first; j < xs->count; j++)
+    {
+        xs->intersections[j].instance = (void *)i;
+    }
+}
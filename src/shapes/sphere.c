@@ -1,4 +1,5 @@
 #include "../../include/shapes.h"
+#include "../../include/simd.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,45 +11,47 @@ sphere_t sphere(void)
     return s;
 }
 
-intersections_t sphere_intersect(const sphere_t *s, const ray_t r)
+SIMD_KERNEL void sphere_intersect_impl(const sphere_t *s, const ray_t r,
+                                       intersections_t *xs)
 {
-    if (s == NULL)
+    if (s == NULL || xs == NULL)
     {
-        return empty_intersections();
+        return;
     }
 
     tuple_t sphere_to_ray = tuple_subtract(r.origin, point(0, 0, 0));
 
-    double a = tuple_dot(r.direction, r.direction);
+    real_t a = tuple_dot(r.direction, r.direction);
 
-    double b = 2.0 * tuple_dot(r.direction, sphere_to_ray);
-    double c = tuple_dot(sphere_to_ray, sphere_to_ray) - 1.0;
+    real_t b = 2 * tuple_dot(r.direction, sphere_to_ray);
+    real_t c = tuple_dot(sphere_to_ray, sphere_to_ray) - 1;
 
-    if (fabs(a) < EPSILON)
+    if (real_fabs(a) < EPSILON)
     {
-        return empty_intersections();
+        return;
     }
 
-    double discriminant = b * b - 4.0 * a * c;
+    real_t discriminant = b * b - 4 * a * c;
 
-    if (discriminant < 0.0)
+    if (discriminant < 0)
     {
-        return empty_intersections();
+        return;
     }
 
-    double sqrt_d = sqrt(discriminant);
-    double inv_2a = 0.5 / a;
+    real_t sqrt_d = real_sqrt(discriminant);
+    real_t inv_2a = 1 / (2 * a);
 
-    double t1 = (-b - sqrt_d) * inv_2a;
-    double t2 = (-b + sqrt_d) * inv_2a;
+    real_t t1 = (-b - sqrt_d) * inv_2a;
+    real_t t2 = (-b + sqrt_d) * inv_2a;
 
-    intersections_t result;
-    result.count            = 2;
-    result.intersections[0] = intersection(t1, (void *)s);
-    result.intersections[1] = intersection(t2, (void *)s);
-    return result;
+    intersections_add(xs, intersection(t1, (void *)s));
+    intersections_add(xs, intersection(t2, (void *)s));
 }
 
+SIMD_DISPATCH_VOID(sphere_intersect,
+                   (const sphere_t *s, const ray_t r, intersections_t *xs),
+                   (s, r, xs))
+
 void sphere_set_transform(sphere_t *s, matrix_t m)
 {
     if (s == NULL)
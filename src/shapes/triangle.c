@@ -1,5 +1,6 @@
 #include "../../include/bounds.h"
 #include "../../include/shapes.h"
+#include "../../include/simd.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -30,6 +31,30 @@ triangle_t triangle(tuple_t p1, tuple_t p2, tuple_t p3)
     return t;
 }
 
+// Moves the vertices of a triangle or smooth triangle in place. Groups that
+// contain it keep their old bounds until group_refit() is called, so a whole
+// deformed mesh can be refitted once after all of its vertices are updated.
+void triangle_set_points(triangle_t *t, tuple_t p1, tuple_t p2, tuple_t p3)
+{
+    if (t == NULL)
+    {
+        return;
+    }
+
+    t->p1 = p1;
+    t->p2 = p2;
+    t->p3 = p3;
+
+    t->e1 = tuple_subtract(p2, p1);
+    t->e2 = tuple_subtract(p3, p1);
+
+    t->normal = tuple_normalize(tuple_cross(t->e2, t->e1));
+
+    t->world_bounds        = bounds_transform(bounds_of_triangle(*t),
+                                              t->transform);
+    t->world_bounds_cached = true;
+}
+
 smooth_triangle_t smooth_triangle(tuple_t p1, tuple_t p2, tuple_t p3,
                                   tuple_t n1, tuple_t n2, tuple_t n3)
 {
@@ -61,75 +86,134 @@ smooth_triangle_t smooth_triangle(tuple_t p1, tuple_t p2, tuple_t p3,
     return t;
 }
 
-intersections_t triangle_intersect(const triangle_t *t, ray_t r)
+// Coordinates of v relative to the ray origin, rotated so the ray's
+// dominant axis becomes z. Swapping x and y when that axis points backwards
+// keeps the winding of the projected triangle.
+SIMD_KERNEL tuple_t triangle_permute(tuple_t v, int kz, bool flip)
 {
-    if (t == NULL)
+    tuple_t p;
+    switch (kz)
     {
-        return empty_intersections();
+    case 0:
+        p = (tuple_t){v.y, v.z, v.x, 0};
+        break;
+    case 1:
+        p = (tuple_t){v.z, v.x, v.y, 0};
+        break;
+    default:
+        p = (tuple_t){v.x, v.y, v.z, 0};
+        break;
     }
 
-    tuple_t dir_cross_e2 = tuple_cross(r.direction, t->e2);
-    double det           = tuple_dot(t->e1, dir_cross_e2);
+    if (flip)
+    {
+        real_t temp = p.x;
+        p.x         = p.y;
+        p.y         = temp;
+    }
+    return p;
+}
 
-    if (fabs(det) < EPSILON)
+// Watertight ray-triangle test (Woop, Benthin and Wald 2013). The triangle
+// is sheared into the ray's space so the ray becomes the z axis; the edge
+// functions U, V and W then depend only on vertex coordinates, and a shared
+// edge evaluates to the same value for both triangles that use it, so rays
+// cannot slip between them. Points exactly on an edge count as inside.
+SIMD_KERNEL bool triangle_hit(tuple_t p1, tuple_t p2, tuple_t p3, ray_t r,
+                              real_t *distance, real_t *u, real_t *v)
+{
+    real_t ax = real_fabs(r.direction.x);
+    real_t ay = real_fabs(r.direction.y);
+    real_t az = real_fabs(r.direction.z);
+    int kz    = ax > ay ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+
+    tuple_t d = triangle_permute(r.direction, kz, false);
+    bool flip = d.z < 0;
+    if (flip)
     {
-        return empty_intersections();
+        d = triangle_permute(r.direction, kz, true);
     }
 
-    double f             = 1.0 / det;
-    tuple_t p1_to_origin = tuple_subtract(r.origin, t->p1);
-    double u             = f * tuple_dot(p1_to_origin, dir_cross_e2);
+    real_t sx = d.x / d.z;
+    real_t sy = d.y / d.z;
+    real_t sz = 1 / d.z;
+
+    tuple_t a = triangle_permute(tuple_subtract(p1, r.origin), kz, flip);
+    tuple_t b = triangle_permute(tuple_subtract(p2, r.origin), kz, flip);
+    tuple_t c = triangle_permute(tuple_subtract(p3, r.origin), kz, flip);
+
+    real_t a_x = a.x - sx * a.z, a_y = a.y - sy * a.z;
+    real_t b_x = b.x - sx * b.z, b_y = b.y - sy * b.z;
+    real_t c_x = c.x - sx * c.z, c_y = c.y - sy * c.z;
+
+    double eu = c_x * b_y - c_y * b_x;
+    double ev = a_x * c_y - a_y * c_x;
+    double ew = b_x * a_y - b_y * a_x;
 
-    if (u < 0 || u > 1)
+#ifdef RT_SINGLE_PRECISION
+    // A zero edge function in float may be rounding; settle it in double.
+    if (fpclassify(eu) == FP_ZERO || fpclassify(ev) == FP_ZERO ||
+        fpclassify(ew) == FP_ZERO)
     {
-        return empty_intersections();
+        eu = (double)c_x * b_y - (double)c_y * b_x;
+        ev = (double)a_x * c_y - (double)a_y * c_x;
+        ew = (double)b_x * a_y - (double)b_y * a_x;
     }
+#endif
 
-    tuple_t origin_cross_e1 = tuple_cross(p1_to_origin, t->e1);
-    double v                = f * tuple_dot(r.direction, origin_cross_e1);
+    if ((eu < 0 || ev < 0 || ew < 0) && (eu > 0 || ev > 0 || ew > 0))
+    {
+        return false;
+    }
 
-    if (v < 0 || (u + v) > 1)
+    double det = eu + ev + ew;
+    if (fpclassify(det) == FP_ZERO)
     {
-        return empty_intersections();
+        return false;
     }
 
-    double ray_t = f * tuple_dot(t->e2, origin_cross_e1);
+    double tz = eu * (sz * a.z) + ev * (sz * b.z) + ew * (sz * c.z);
 
-    intersections_t result;
-    result.count            = 1;
-    result.intersections[0] = intersection_with_uv(ray_t, (void *)t, u, v);
-    return result;
+    *distance = tz / det;
+    *u        = ev / det;
+    *v        = ew / det;
+    return true;
 }
 
-intersections_t smooth_triangle_intersect(const smooth_triangle_t *t, ray_t r)
+SIMD_KERNEL void triangle_intersect_impl(const triangle_t *t, ray_t r,
+                                         intersections_t *xs)
 {
-    if (t == NULL)
+    if (t == NULL || xs == NULL)
     {
-        return empty_intersections();
+        return;
     }
-    tuple_t dir_cross_e2 = tuple_cross(r.direction, t->e2);
-    double det           = tuple_dot(t->e1, dir_cross_e2);
-    if (fabs(det) < EPSILON)
+
+    real_t distance, u, v;
+    if (triangle_hit(t->p1, t->p2, t->p3, r, &distance, &u, &v))
     {
-        return empty_intersections();
+        intersections_add(xs, intersection_with_uv(distance, (void *)t, u, v));
     }
-    double f             = 1.0 / det;
-    tuple_t p1_to_origin = tuple_subtract(r.origin, t->p1);
-    double u             = f * tuple_dot(p1_to_origin, dir_cross_e2);
-    if (u < 0 || u > 1)
+}
+
+SIMD_DISPATCH_VOID(triangle_intersect,
+                   (const triangle_t *t, ray_t r, intersections_t *xs),
+                   (t, r, xs))
+
+SIMD_KERNEL void smooth_triangle_intersect_impl(const smooth_triangle_t *t,
+                                                ray_t r, intersections_t *xs)
+{
+    if (t == NULL || xs == NULL)
     {
-        return empty_intersections();
+        return;
     }
-    tuple_t origin_cross_e1 = tuple_cross(p1_to_origin, t->e1);
-    double v                = f * tuple_dot(r.direction, origin_cross_e1);
-    if (v < 0 || (u + v) > 1)
+
+    real_t distance, u, v;
+    if (triangle_hit(t->p1, t->p2, t->p3, r, &distance, &u, &v))
     {
-        return empty_intersections();
+        intersections_add(xs, intersection_with_uv(distance, (void *)t, u, v));
     }
-    double ray_t = f * tuple_dot(t->e2, origin_cross_e1);
+}
 
-    intersections_t result;
-    result.count            = 1;
-    result.intersections[0] = intersection_with_uv(ray_t, (void *)t, u, v);
-    return result;
-}
\ No newline at end of file
+SIMD_DISPATCH_VOID(smooth_triangle_intersect,
+                   (const smooth_triangle_t *t, ray_t r, intersections_t *xs),
+                   (t, r, xs))
@@ -0,0 +1,75 @@
+// simd.c
+
+#include "../include/simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+simd_isa_t simd_active_isa = SIMD_ISA_GENERIC;
+
+static const char *const simd_isa_names[SIMD_ISA_COUNT] = {
+    "generic", "sse4.2", "avx2", "avx512"};
+
+const char *simd_isa_name(simd_isa_t isa)
+{
+    return isa < SIMD_ISA_COUNT ? simd_isa_names[isa] : "unknown";
+}
+
+simd_isa_t simd_detect_isa(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512vl") &&
+        __builtin_cpu_supports("avx512dq"))
+    {
+        return SIMD_ISA_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+        __builtin_cpu_supports("bmi2"))
+    {
+        return SIMD_ISA_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+    {
+        return SIMD_ISA_SSE42;
+    }
+#endif
+    return SIMD_ISA_GENERIC;
+}
+
+bool simd_set_isa(simd_isa_t isa)
+{
+    if (isa >= SIMD_ISA_COUNT || isa > simd_detect_isa())
+    {
+        return false;
+    }
+    simd_active_isa = isa;
+    return true;
+}
+
+__attribute__((constructor)) static void simd_init(void)
+{
+    simd_active_isa = simd_detect_isa();
+
+    const char *requested = getenv("RT_ISA");
+    if (requested == NULL)
+    {
+        return;
+    }
+
+    for (int isa = 0; isa < SIMD_ISA_COUNT; isa++)
+    {
+        if (strcmp(requested, simd_isa_names[isa]) == 0)
+        {
+            if (!simd_set_isa((simd_isa_t)isa))
+            {
+                fprintf(stderr, "RT_ISA=%s is not supported here, using %s\n",
+                        requested, simd_isa_name(simd_active_isa));
+            }
+            return;
+        }
+    }
+    fprintf(stderr, "Unknown RT_ISA=%s, using %s\n", requested,
+            simd_isa_name(simd_active_isa));
+}
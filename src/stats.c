@@ -0,0 +1,178 @@
+#include "../include/stats.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *stat_names[STAT_COUNT] = {
+    "camera_rays", "shadow_rays",     "scene_rays",  "bounds_tests",
+    "node_visits", "primitive_tests", "hit_buffer_growths"};
+
+#ifdef RT_STATS
+
+static stats_slot_t stats_slots[STATS_MAX_THREADS];
+static atomic_bool stats_slot_taken[STATS_MAX_THREADS];
+static atomic_bool stats_overflowed;
+
+// Threads that find every slot taken count into their own slot, which is
+// never collected, rather than racing another thread on a shared one.
+static _Thread_local stats_slot_t stats_uncounted;
+
+static pthread_key_t stats_release_key;
+static pthread_once_t stats_release_once = PTHREAD_ONCE_INIT;
+
+_Thread_local stats_slot_t *stats_thread_slot = NULL;
+
+// Hands an exiting thread's slot to the next thread that claims one; its
+// counts stay in the slot until the next reset.
+static void stats_release_slot(void *slot)
+{
+    atomic_store(&stats_slot_taken[(stats_slot_t *)slot - stats_slots],
+                 false);
+}
+
+static void stats_create_release_key(void)
+{
+    pthread_key_create(&stats_release_key, stats_release_slot);
+}
+
+stats_slot_t *stats_claim_slot(void)
+{
+    pthread_once(&stats_release_once, stats_create_release_key);
+
+    for (unsigned i = 0; i < STATS_MAX_THREADS; i++)
+    {
+        bool expected = false;
+        if (!atomic_load(&stats_slot_taken[i]) &&
+            atomic_compare_exchange_strong(&stats_slot_taken[i], &expected,
+                                           true))
+        {
+            pthread_setspecific(stats_release_key, &stats_slots[i]);
+            return &stats_slots[i];
+        }
+    }
+
+    if (!atomic_exchange(&stats_overflowed, true))
+    {
+        fprintf(stderr, "More than %d threads are counting statistics; "
+                        "the rest are not counted\n",
+                STATS_MAX_THREADS);
+    }
+    return &stats_uncounted;
+}
+
+bool stats_enabled(void)
+{
+    return true;
+}
+
+void stats_reset(void)
+{
+    memset(stats_slots, 0, sizeof(stats_slots));
+}
+
+stats_t stats_collect(void)
+{
+    stats_t total;
+    memset(&total, 0, sizeof(total));
+
+    for (unsigned i = 0; i < STATS_MAX_THREADS; i++)
+    {
+        for (int s = 0; s < STAT_COUNT; s++)
+        {
+            total.counts[s] += stats_slots[i].counts[s];
+        }
+    }
+
+    return total;
+}
+
+void stats_begin_render(void)
+{
+    stats_reset();
+}
+
+void stats_end_render(void)
+{
+    stats_t total = stats_collect();
+    stats_print(&total, stdout);
+
+    const char *path = getenv("RT_STATS_JSON");
+    if (path == NULL || path[0] == '\0')
+    {
+        return;
+    }
+
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        printf("Failed to open %s for render statistics\n", path);
+        return;
+    }
+    stats_write_json(&total, file);
+    fclose(file);
+}
+
+#else
+
+bool stats_enabled(void)
+{
+    return false;
+}
+
+void stats_reset(void)
+{
+}
+
+stats_t stats_collect(void)
+{
+    stats_t total;
+    memset(&total, 0, sizeof(total));
+    return total;
+}
+
+void stats_begin_render(void)
+{
+}
+
+void stats_end_render(void)
+{
+}
+
+#endif
+
+const char *stats_name(stat_t stat)
+{
+    return stat < STAT_COUNT ? stat_names[stat] : "unknown";
+}
+
+void stats_print(const stats_t *s, FILE *file)
+{
+    if (s == NULL || file == NULL)
+    {
+        return;
+    }
+
+    fprintf(file, "Render statistics:\n");
+    for (int i = 0; i < STAT_COUNT; i++)
+    {
+        fprintf(file, "  %-19s %" PRIu64 "\n", stat_names[i], s->counts[i]);
+    }
+}
+
+void stats_write_json(const stats_t *s, FILE *file)
+{
+    if (s == NULL || file == NULL)
+    {
+        return;
+    }
+
+    fprintf(file, "{");
+    for (int i = 0; i < STAT_COUNT; i++)
+    {
+        fprintf(file, "%s\"%s\": %" PRIu64, i > 0 ? ", " : "", stat_names[i],
+                s->counts[i]);
+    }
+    fprintf(file, "}\n");
+}
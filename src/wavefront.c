@@ -0,0 +1,388 @@
+// wavefront.c
+
+#include "../include/wavefront.h"
+#include "../include/bounds.h"
+#include "../include/bvh.h"
+#include "../include/hot_path.h"
+#include "../include/stats.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WAVEFRONT_TILE_PIXELS (WAVEFRONT_TILE_SIZE * WAVEFRONT_TILE_SIZE)
+
+typedef struct
+{
+    wavefront_ray_t *rays;
+    wavefront_ray_t *next;
+    wavefront_ray_t *temp;
+    wavefront_hit_t *hits;
+    wavefront_hit_t *hits_temp;
+    tuple_t *pixels;
+    size_t capacity;
+} wavefront_stream_t;
+
+// Like the scratch hit lists, streams live as long as their thread.
+static _Thread_local wavefront_stream_t streams;
+
+uint32_t wavefront_sort_key(const ray_t *r, bounding_box_t origins)
+{
+    double cell[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        double min    = bvh_axis(origins.min, axis);
+        double extent = bvh_axis(origins.max, axis) - min;
+        cell[axis]    = extent > 0.0 ? (bvh_axis(r->origin, axis) - min) /
+                                        extent
+                                     : 0.0;
+    }
+
+    uint32_t morton =
+        (uint32_t)(bvh_morton_code(cell[0], cell[1], cell[2], 30) >> 3);
+    uint32_t octant = (uint32_t)(r->direction.x < 0) << 2 |
+                      (uint32_t)(r->direction.y < 0) << 1 |
+                      (uint32_t)(r->direction.z < 0);
+    return morton << 3 | octant;
+}
+
+uint32_t wavefront_material_key(const intersection_t *hit)
+{
+    const shape_t *shape = intersection_material_shape(hit);
+    const material_t *m  = &shape->material;
+    uint32_t kind        = m->has_pattern ? 1 + (uint32_t)m->pattern.type : 0;
+
+    // Equal shapes hash alike, so their hits stay together; a collision
+    // only merges two batches.
+    uint64_t address = (uintptr_t)shape >> 4;
+    uint32_t hash    = (uint32_t)((address * 0x9E3779B97F4A7C15ULL) >> 36);
+    return kind << 28 | hash;
+}
+
+// A stable LSD radix sort of items of the given size by the 32-bit key at
+// key_offset bytes into each; temp must hold count items.
+static void wavefront_radix_sort(void *items, void *temp, size_t count,
+                                 size_t size, size_t key_offset)
+{
+    if (items == NULL || temp == NULL || count < 2)
+    {
+        return;
+    }
+
+    unsigned char *src = items;
+    unsigned char *dst = temp;
+    for (unsigned shift = 0; shift < 32; shift += 8)
+    {
+        size_t offsets[256] = {0};
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t key;
+            memcpy(&key, src + i * size + key_offset, sizeof(key));
+            offsets[key >> shift & 0xff]++;
+        }
+
+        // A digit every item shares would only copy the items across.
+        size_t total = 0;
+        bool shared  = false;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            size_t n        = offsets[digit];
+            shared          = shared || n == count;
+            offsets[digit]  = total;
+            total          += n;
+        }
+        if (shared)
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t key;
+            memcpy(&key, src + i * size + key_offset, sizeof(key));
+            memcpy(dst + offsets[key >> shift & 0xff]++ * size, src + i * size,
+                   size);
+        }
+
+        unsigned char *swap = src;
+        src                 = dst;
+        dst                 = swap;
+    }
+
+    if (src != items)
+    {
+        memcpy(items, src, count * size);
+    }
+}
+
+void wavefront_sort(wavefront_ray_t *rays, wavefront_ray_t *temp,
+                    size_t count)
+{
+    wavefront_radix_sort(rays, temp, count, sizeof(wavefront_ray_t),
+                         offsetof(wavefront_ray_t, key));
+}
+
+// Grows the calling thread's streams to hold capacity rays; the first
+// call also allocates the tile's pixel accumulators.
+static bool wavefront_ensure(size_t capacity)
+{
+    wavefront_stream_t *s = &streams;
+    if (capacity <= s->capacity && s->pixels != NULL)
+    {
+        return true;
+    }
+
+    if (capacity < 2 * s->capacity)
+    {
+        capacity = 2 * s->capacity;
+    }
+
+    hot_path_amortized_begin();
+    bool grown                 = true;
+    wavefront_ray_t **lists[3] = {&s->rays, &s->next, &s->temp};
+    for (int i = 0; i < 3 && grown; i++)
+    {
+        wavefront_ray_t *list =
+            realloc(*lists[i], capacity * sizeof(wavefront_ray_t));
+        grown = list != NULL;
+        if (grown)
+        {
+            *lists[i] = list;
+        }
+    }
+
+    wavefront_hit_t **hit_lists[2] = {&s->hits, &s->hits_temp};
+    for (int i = 0; i < 2 && grown; i++)
+    {
+        wavefront_hit_t *list =
+            realloc(*hit_lists[i], capacity * sizeof(wavefront_hit_t));
+        grown = list != NULL;
+        if (grown)
+        {
+            *hit_lists[i] = list;
+        }
+    }
+
+    if (grown)
+    {
+        s->capacity = capacity;
+    }
+    if (s->pixels == NULL)
+    {
+        s->pixels = malloc(WAVEFRONT_TILE_PIXELS * sizeof(tuple_t));
+    }
+    hot_path_amortized_end();
+
+    if (!grown || s->pixels == NULL)
+    {
+        fprintf(stderr, "Error: Failed to grow ray stream to %zu\n",
+                capacity);
+        return false;
+    }
+    return true;
+}
+
+void wavefront_reserve(void)
+{
+    wavefront_ensure(2 * WAVEFRONT_TILE_PIXELS);
+}
+
+static void wavefront_sort_stream(wavefront_stream_t *s, size_t count)
+{
+    bounding_box_t origins = bounding_box_empty();
+    for (size_t i = 0; i < count; i++)
+    {
+        bounds_add_point(&origins, s->rays[i].ray.origin);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        s->rays[i].key = wavefront_sort_key(&s->rays[i].ray, origins);
+    }
+    wavefront_sort(s->rays, s->temp, count);
+}
+
+// Records each ray's hit, resolving the refractive indices while its hit
+// list is at hand, and returns the number of hits sorted by material.
+static size_t wavefront_trace(const world_t *w, wavefront_stream_t *s,
+                              size_t count)
+{
+    size_t hits = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        intersections_t *xs = intersections_scratch(0);
+        STATS_ADD(STAT_SCENE_RAYS, 1);
+        world_intersect(w, &s->rays[i].ray, xs);
+
+        intersection_t *hit = intersections_hit(xs);
+        if (hit == NULL)
+        {
+            continue;
+        }
+
+        wavefront_hit_t *record = &s->hits[hits++];
+        record->hit             = *hit;
+        record->n1              = 1.0;
+        record->n2              = 1.0;
+        record->ray             = (unsigned)i;
+        record->key             = wavefront_material_key(hit);
+        if (intersection_material_shape(hit)->material.transparency > 0)
+        {
+            intersections_refractive_indices(hit, xs, &record->n1,
+                                             &record->n2);
+        }
+    }
+
+    wavefront_radix_sort(s->hits, s->hits_temp, hits, sizeof(wavefront_hit_t),
+                         offsetof(wavefront_hit_t, key));
+    return hits;
+}
+
+static void wavefront_emit(wavefront_stream_t *s, size_t *count,
+                           const wavefront_ray_t *parent, ray_t r,
+                           double weight)
+{
+    wavefront_ray_t *next = &s->next[(*count)++];
+    next->ray             = r;
+    next->weight          = parent->weight * weight;
+    next->pixel           = parent->pixel;
+    next->remaining       = parent->remaining - 1;
+}
+
+// Adds each hit's direct light to its pixel and returns the number of
+// reflected and refracted rays written to the next stream, weighted as
+// world_shade_hit weights their colours.
+static size_t wavefront_shade(const world_t *w, wavefront_stream_t *s,
+                              size_t hits, render_region_t tile)
+{
+    size_t next_count = 0;
+    for (size_t i = 0; i < hits; i++)
+    {
+        const wavefront_hit_t *record = &s->hits[i];
+        const wavefront_ray_t *input  = &s->rays[record->ray];
+
+        computations_t c =
+            intersections_prepare_computations(&record->hit, &input->ray,
+                                               NULL);
+        c.n1 = record->n1;
+        c.n2 = record->n2;
+
+        lights_select_pixel(tile.x + input->pixel % tile.width,
+                            tile.y + input->pixel / tile.width);
+        tuple_t *pixel = &s->pixels[input->pixel];
+        *pixel = tuple_add(*pixel, tuple_scale(world_direct_light(w, &c),
+                                               input->weight));
+
+        material_t m       = ((shape_t *)c.object)->material;
+        double reflectance = 1.0;
+        double refractance = 1.0;
+        if (m.reflective > 0 && m.transparency > 0)
+        {
+            reflectance = intersections_shlick(&c);
+            refractance = 1 - reflectance;
+        }
+
+        ray_t r;
+        if (world_reflected_ray(&c, input->remaining, &r))
+        {
+            wavefront_emit(s, &next_count, input, r,
+                           m.reflective * reflectance);
+        }
+        if (world_refracted_ray(&c, input->remaining, &r))
+        {
+            wavefront_emit(s, &next_count, input, r,
+                           m.transparency * refractance);
+        }
+    }
+    return next_count;
+}
+
+static bool wavefront_render_tile(const camera_t *c, const world_t *w,
+                                  render_region_t tile, canvas_t *dst,
+                                  unsigned dst_x, unsigned dst_y)
+{
+    size_t count = (size_t)tile.width * tile.height;
+    if (!wavefront_ensure(count))
+    {
+        return false;
+    }
+
+    wavefront_stream_t *s = &streams;
+    for (unsigned i = 0; i < count; i++)
+    {
+        wavefront_ray_t *primary = &s->rays[i];
+        primary->ray             = camera_ray_for_pixel(
+            c, tile.x + i % tile.width, tile.y + i / tile.width);
+        primary->weight    = 1.0;
+        primary->pixel     = i;
+        primary->remaining = MAX_RECURSION;
+        s->pixels[i]       = color(0, 0, 0);
+    }
+
+    // Primary rays share the camera's origin and are already coherent in
+    // scanline order, so only secondary bounces are sorted.
+    for (unsigned bounce = 0; count > 0; bounce++)
+    {
+        if (bounce > 0)
+        {
+            wavefront_sort_stream(s, count);
+        }
+        size_t hits = wavefront_trace(w, s, count);
+
+        // Each hit spawns at most a reflected and a refracted ray.
+        if (!wavefront_ensure(2 * hits))
+        {
+            return false;
+        }
+        count = wavefront_shade(w, s, hits, tile);
+
+        wavefront_ray_t *swap = s->rays;
+        s->rays               = s->next;
+        s->next               = swap;
+    }
+
+    for (unsigned i = 0; i < tile.width * tile.height; i++)
+    {
+        canvas_write_pixel(dst, dst_x + i % tile.width,
+                           dst_y + i / tile.width, s->pixels[i]);
+    }
+    return true;
+}
+
+bool wavefront_render(const camera_t *c, const world_t *w, render_region_t r,
+                      canvas_t *dst, unsigned dst_x, unsigned dst_y)
+{
+    if (c == NULL || w == NULL || dst == NULL)
+    {
+        return false;
+    }
+
+    unsigned size    = WAVEFRONT_TILE_SIZE;
+    unsigned columns = (r.width + size - 1) / size;
+    unsigned rows    = (r.height + size - 1) / size;
+    bool ok          = true;
+
+    hot_path_begin();
+
+#pragma omp parallel for schedule(dynamic, 1) reduction(&& : ok)
+    for (unsigned t = 0; t < columns * rows; t++)
+    {
+        unsigned x           = t % columns * size;
+        unsigned y           = t / columns * size;
+        render_region_t tile = {r.x + x, r.y + y, size, size};
+        if (tile.width > r.width - x)
+        {
+            tile.width = r.width - x;
+        }
+        if (tile.height > r.height - y)
+        {
+            tile.height = r.height - y;
+        }
+
+        ok = wavefront_render_tile(c, w, tile, dst, dst_x + x, dst_y + y) &&
+             ok;
+    }
+
+    hot_path_end();
+
+    return ok;
+}
@@ -2,6 +2,7 @@
 
 #include "../include/world.h"
 #include "../include/dynamic_array.h"
+#include "../include/stats.h"
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -60,26 +61,7 @@ void world_free(world_t *w)
             {
                 if (w->objects[i].shape.type == SHAPE_GROUP)
                 {
-                    group_t *g = &w->objects[i].group;
-                    if (g->children != NULL)
-                    {
-                        for (unsigned j = 0; j < g->child_count; j++)
-                        {
-                            if (g->children[j] != NULL)
-                            {
-                                if (g->children[j]->type == SHAPE_GROUP)
-                                {
-                                    group_free((group_t *)g->children[j]);
-                                }
-                                else
-                                {
-                                    free(g->children[j]);
-                                }
-                            }
-                        }
-                        free(g->children);
-                        g->children = NULL;
-                    }
+                    group_free_children(&w->objects[i].group);
                 }
             }
 
@@ -91,6 +73,11 @@ void world_free(world_t *w)
 
         if (w->lights)
         {
+            for (unsigned i = 0; i < w->light_count; i++)
+            {
+                lights_free_samples(&w->lights[i]);
+                sequence_free(&w->lights[i].jitter_by);
+            }
             free(w->lights);
             w->lights        = NULL;
             w->light_count   = 0;
@@ -99,6 +86,47 @@ void world_free(world_t *w)
     }
 }
 
+void world_warm_bounds(world_t *w)
+{
+    if (w == NULL)
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < w->object_count; i++)
+    {
+        object_t *o = &w->objects[i];
+        if (o->shape.type == SHAPE_GROUP)
+        {
+            group_warm_bounds(&o->group);
+        }
+        else if (o->shape.type == SHAPE_INSTANCE && o->instance.mesh != NULL &&
+                 o->instance.mesh->type == SHAPE_GROUP)
+        {
+            group_warm_bounds((group_t *)o->instance.mesh);
+        }
+    }
+}
+
+void world_prepare_lights(world_t *w)
+{
+    if (w == NULL)
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < w->light_count; i++)
+    {
+        lights_prepare_samples(&w->lights[i]);
+    }
+}
+
+void world_prepare(world_t *w)
+{
+    world_warm_bounds(w);
+    world_prepare_lights(w);
+}
+
 static bool world_ensure_capacity(world_t *w)
 {
     if (!w || !w->objects)
@@ -163,6 +191,11 @@ void world_add_smooth_triangle(world_t *w, smooth_triangle_t t)
 
 void world_add_group(world_t *w, group_t *g)
 {
+    if (g == NULL)
+    {
+        return;
+    }
+
     if (!world_ensure_capacity(w))
     {
         group_free(g);
@@ -183,6 +216,16 @@ void world_add_group(world_t *w, group_t *g)
     free(g);
 }
 
+void world_add_instance(world_t *w, instance_t i)
+{
+    if (!world_ensure_capacity(w))
+    {
+        return;
+    }
+    w->objects[w->object_count].instance = i;
+    w->object_count++;
+}
+
 void world_add_light(world_t *w, light_t light)
 {
     if (!w || !w->lights)
@@ -204,6 +247,14 @@ void world_add_light(world_t *w, light_t light)
         w->light_capacity = new_capacity;
     }
 
+    // The world owns the sample tables and jitter values of its own lights
+    // only; the caller keeps and frees its own jitter_by.
+    light.jitter_by    = sequence_copy(&light.jitter_by);
+    light.sample_x     = NULL;
+    light.sample_y     = NULL;
+    light.sample_z     = NULL;
+    light.sample_count = 0;
+
     w->lights[w->light_count] = light;
     w->light_count++;
 }
@@ -245,41 +296,14 @@ void world_intersect(const world_t *w, const ray_t *r, intersections_t *out)
         case SHAPE_GROUP:
             shape = (shape_t *)&w->objects[i].group;
             break;
+        case SHAPE_INSTANCE:
+            shape = (shape_t *)&w->objects[i].instance;
+            break;
         default:
             shape = &w->objects[i].shape;
             break;
         }
-        intersections_t xs = shape_intersect(shape, *r);
-
-        if (xs.count > 0)
-        {
-            int space_left = MAX_INTERSECTIONS - out->count;
-            int to_copy    = 0;
-
-            if (space_left > 0)
-            {
-                to_copy = (xs.count <= space_left) ? xs.count : space_left;
-                memcpy(&out->intersections[out->count], xs.intersections,
-                       (size_t)to_copy * sizeof(intersection_t));
-                out->count += to_copy;
-            }
-
-            if (out->count == MAX_INTERSECTIONS)
-            {
-                intersections_sort(out);
-
-                for (int j = to_copy; j < xs.count; j++)
-                {
-                    if (xs.intersections[j].t <
-                        out->intersections[MAX_INTERSECTIONS - 1].t)
-                    {
-                        out->intersections[MAX_INTERSECTIONS - 1] =
-                            xs.intersections[j];
-                        intersections_sort(out);
-                    }
-                }
-            }
-        }
+        shape_intersect(shape, *r, out);
     }
 
     if (out->count > 1)
@@ -288,8 +312,7 @@ void world_intersect(const world_t *w, const ray_t *r, intersections_t *out)
     }
 }
 
-tuple_t world_shade_hit(const world_t *w, const computations_t *c,
-                        const unsigned remaining)
+tuple_t world_direct_light(const world_t *w, const computations_t *c)
 {
     if (w == NULL || c == NULL)
     {
@@ -312,6 +335,20 @@ tuple_t world_shade_hit(const world_t *w, const computations_t *c,
         surface = tuple_add(surface, light_contribution);
     }
 
+    return surface;
+}
+
+tuple_t world_shade_hit(const world_t *w, const computations_t *c,
+                        const unsigned remaining)
+{
+    if (w == NULL || c == NULL)
+    {
+        return color(0, 0, 0);
+    }
+
+    shape_t *o      = (shape_t *)c->object;
+    tuple_t surface = world_direct_light(w, c);
+
     tuple_t reflected = world_reflected_color(w, c, remaining);
     tuple_t refracted = world_refracted_color(w, c, remaining);
 
@@ -336,14 +373,17 @@ tuple_t world_color_at(const world_t *w, const ray_t *r,
         return color(0, 0, 0);
     }
 
-    intersections_t xs;
-    world_intersect(w, r, &xs);
-    if (intersections_hit(&xs) == NULL)
+    // Reflected and refracted rays use a lower level's list, so xs stays
+    // valid while the hit is shaded.
+    intersections_t *xs = intersections_scratch(remaining);
+    STATS_ADD(STAT_SCENE_RAYS, 1);
+    world_intersect(w, r, xs);
+    if (intersections_hit(xs) == NULL)
     {
         return color(0, 0, 0);
     }
-    intersection_t hit   = *intersections_hit(&xs);
-    computations_t comps = intersections_prepare_computations(&hit, r, &xs);
+    intersection_t hit   = *intersections_hit(xs);
+    computations_t comps = intersections_prepare_computations(&hit, r, xs);
     return world_shade_hit(w, &comps, remaining);
 }
 
@@ -367,16 +407,16 @@ bool world_is_shadowed(const world_t *w, const tuple_t light_position,
     tuple_t offset_point = tuple_add(p, tuple_scale(direction, EPSILON));
     ray_t r              = ray(offset_point, direction);
 
-    intersections_t xs;
+    intersections_t *xs = intersections_scratch(INTERSECTIONS_SHADOW_SCRATCH);
 
-    world_intersect(w, &r, &xs);
+    STATS_ADD(STAT_SHADOW_RAYS, 1);
+    world_intersect(w, &r, xs);
 
-    intersection_t *h = intersections_hit(&xs);
+    intersection_t *h = intersections_hit(xs);
 
     if (h != NULL && h->t < distance)
     {
-        shape_t *hit_shape = (shape_t *)h->object;
-        return hit_shape->material.casts_shadow;
+        return intersection_material_shape(h)->material.casts_shadow;
     }
 
     return false;
@@ -392,23 +432,42 @@ tuple_t world_reflected_color(const world_t *w, const computations_t *c,
 
     shape_t *o = (shape_t *)c->object;
 
-    if (remaining == 0 || o->material.reflective < MIN_RAY_CONTRIBUTION)
+    ray_t reflect_ray;
+    if (!world_reflected_ray(c, remaining, &reflect_ray))
     {
         return color(0, 0, 0);
     }
 
-    ray_t reflect_ray = ray(c->over_point, c->reflectv);
-    tuple_t color     = world_color_at(w, &reflect_ray, remaining - 1);
+    tuple_t color = world_color_at(w, &reflect_ray, remaining - 1);
 
     return tuple_scale(color, o->material.reflective);
 }
 
-tuple_t world_refracted_color(const world_t *w, const computations_t *c,
-                              const unsigned remaining)
+bool world_reflected_ray(const computations_t *c, const unsigned remaining,
+                         ray_t *out)
 {
-    if (w == NULL || c == NULL)
+    if (c == NULL || out == NULL)
     {
-        return color(0, 0, 0);
+        return false;
+    }
+
+    shape_t *o = (shape_t *)c->object;
+
+    if (remaining == 0 || o->material.reflective < MIN_RAY_CONTRIBUTION)
+    {
+        return false;
+    }
+
+    *out = ray(c->over_point, c->reflectv);
+    return true;
+}
+
+bool world_refracted_ray(const computations_t *c, const unsigned remaining,
+                         ray_t *out)
+{
+    if (c == NULL || out == NULL)
+    {
+        return false;
     }
 
     shape_t *o = (shape_t *)c->object;
@@ -420,7 +479,7 @@ tuple_t world_refracted_color(const world_t *w, const computations_t *c,
     if (remaining == 0 || o->material.transparency < MIN_RAY_CONTRIBUTION ||
         sin2_t > 1)
     {
-        return color(0, 0, 0);
+        return false;
     }
 
     double cos_t = sqrt(1.0 - sin2_t);
@@ -428,7 +487,25 @@ tuple_t world_refracted_color(const world_t *w, const computations_t *c,
         tuple_subtract(tuple_scale(c->normalv, n_ratio * cos_i - cos_t),
                        tuple_scale(c->eyev, n_ratio));
 
-    ray_t refract_ray = ray(c->under_point, direction);
+    *out = ray(c->under_point, direction);
+    return true;
+}
+
+tuple_t world_refracted_color(const world_t *w, const computations_t *c,
+                              const unsigned remaining)
+{
+    if (w == NULL || c == NULL)
+    {
+        return color(0, 0, 0);
+    }
+
+    shape_t *o = (shape_t *)c->object;
+
+    ray_t refract_ray;
+    if (!world_refracted_ray(c, remaining, &refract_ray))
+    {
+        return color(0, 0, 0);
+    }
 
     return tuple_scale(world_color_at(w, &refract_ray, remaining - 1),
                        o->material.transparency);
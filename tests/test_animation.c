@@ -0,0 +1,107 @@
+// test_animation.c
+
+#include "../include/animation.h"
+#include "../include/bounds.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+void test_animation(void)
+{
+    { // Camera keyframes are interpolated between keys and held outside them
+        animation_t a = animation(camera(11, 11, M_PI_2));
+        animation_add_camera_key(&a, 1.0, point(0, 0, -10), point(0, 0, 0),
+                                 vector(0, 1, 0));
+        animation_add_camera_key(&a, 0.0, point(0, 0, -5), point(0, 0, 0),
+                                 vector(0, 1, 0));
+        assert(equal(a.camera_keys[0].time, 0.0));
+
+        animation_apply(&a, 0.5);
+        assert(matrix_equal(a.camera.transform,
+                            transform_view(point(0, 0, -7.5), point(0, 0, 0),
+                                           vector(0, 1, 0))));
+
+        animation_apply(&a, 2.0);
+        assert(matrix_equal(a.camera.transform,
+                            transform_view(point(0, 0, -10), point(0, 0, 0),
+                                           vector(0, 1, 0))));
+        animation_free(&a);
+    }
+
+    { // Only objects whose transform changed are updated
+        world_t w     = world_default();
+        animation_t a = animation(camera(11, 11, M_PI_2));
+        shape_t *s    = &w.objects[0].shape;
+
+        animation_add_object_key(&a, s, 0.0, point(0, 0, 0), vector(0, 0, 0),
+                                 vector(1, 1, 1));
+        animation_add_object_key(&a, s, 1.0, point(4, 0, 0),
+                                 vector(0, M_PI, 0), vector(1, 1, 1));
+        animation_add_object_key(&a, s, 2.0, point(4, 0, 0),
+                                 vector(0, M_PI, 0), vector(1, 1, 1));
+
+        assert(animation_apply(&a, 0.5) == 1);
+        assert(matrix_equal(s->transform,
+                            matrix_mul(transform_translation(2, 0, 0),
+                                       transform_rotation_y(M_PI_2))));
+        assert(equal(s->world_bounds.min.x, 1));
+
+        assert(animation_apply(&a, 1.0) == 1);
+        assert(animation_apply(&a, 1.5) == 0);
+
+        animation_free(&a);
+        world_free(&w);
+    }
+
+    { // Moving a child of a group refreshes the group's bounds when warmed
+        world_t w    = world();
+        group_t *g   = group();
+        sphere_t *s1 = malloc(sizeof(sphere_t));
+        *s1          = sphere();
+        group_add_child(g, (shape_t *)s1);
+        world_add_group(&w, g);
+
+        group_t *root = &w.objects[0].group;
+        shape_t *s    = root->children[0];
+        assert(equal(bounds_of_group(root).max.x, 1));
+
+        animation_t a = animation(camera(11, 11, M_PI_2));
+        animation_add_object_key(&a, s, 0.0, point(3, 0, 0), vector(0, 0, 0),
+                                 vector(1, 1, 1));
+        animation_apply(&a, 0.0);
+        assert(!root->bounds_cached);
+
+        world_warm_bounds(&w);
+        assert(equal(bounds_of_group(root).max.x, 4));
+        assert(equal(root->world_bounds.max.x, 4));
+
+        animation_free(&a);
+        world_free(&w);
+    }
+
+    { // Rendering a sequence writes one image per frame
+        world_t w     = world_default();
+        animation_t a = animation(camera(5, 5, M_PI_2));
+        animation_add_camera_key(&a, 0.0, point(0, 0, -5), point(0, 0, 0),
+                                 vector(0, 1, 0));
+        animation_add_camera_key(&a, 1.0, point(5, 0, 0), point(0, 0, 0),
+                                 vector(0, 1, 0));
+
+        assert(animation_render(&a, &w, 2, 1.0, "test_animation_"));
+
+        FILE *frame = fopen("test_animation_0001.ppm", "r");
+        assert(frame != NULL);
+        fclose(frame);
+        remove("test_animation_0000.ppm");
+        remove("test_animation_0001.ppm");
+
+        animation_free(&a);
+        world_free(&w);
+    }
+}
+
+int main(void)
+{
+    test_animation();
+    return 0;
+}
@@ -7,8 +7,8 @@ void test_bounds(void)
 {
     { // Creating an empty bounding box
         bounding_box_t box = bounding_box_empty();
-        assert(tuple_equal(box.min, point(DBL_MAX, DBL_MAX, DBL_MAX)));
-        assert(tuple_equal(box.max, point(-DBL_MAX, -DBL_MAX, -DBL_MAX)));
+        assert(tuple_equal(box.min, point(REAL_MAX, REAL_MAX, REAL_MAX)));
+        assert(tuple_equal(box.max, point(-REAL_MAX, -REAL_MAX, -REAL_MAX)));
     }
 
     { // Creating a bounding box with volume
@@ -37,8 +37,8 @@ void test_bounds(void)
     { // A plane has a bounding box
         plane_t shape      = plane();
         bounding_box_t box = bounds_of(&shape);
-        assert(tuple_equal(box.min, point(-DBL_MAX, 0, -DBL_MAX)));
-        assert(tuple_equal(box.max, point(DBL_MAX, 0, DBL_MAX)));
+        assert(tuple_equal(box.min, point(-REAL_MAX, 0, -REAL_MAX)));
+        assert(tuple_equal(box.max, point(REAL_MAX, 0, REAL_MAX)));
     }
 
     { // A cube has a bounding box
@@ -255,8 +255,8 @@ void test_bounds(void)
     { // An unbounded cylinder has a bounding box
         cylinder_t shape   = cylinder();
         bounding_box_t box = bounds_of(&shape);
-        assert(tuple_equal(box.min, point(-1, -DBL_MAX, -1)));
-        assert(tuple_equal(box.max, point(1, DBL_MAX, 1)));
+        assert(tuple_equal(box.min, point(-1, -REAL_MAX, -1)));
+        assert(tuple_equal(box.max, point(1, REAL_MAX, 1)));
     }
 
     { // A bounded cylinder has a bounding box
@@ -271,8 +271,8 @@ void test_bounds(void)
     { // An unbounded cone has a bounding box
         cone_t shape       = cone();
         bounding_box_t box = bounds_of(&shape);
-        assert(tuple_equal(box.min, point(-DBL_MAX, -DBL_MAX, -DBL_MAX)));
-        assert(tuple_equal(box.max, point(DBL_MAX, DBL_MAX, DBL_MAX)));
+        assert(tuple_equal(box.min, point(-REAL_MAX, -REAL_MAX, -REAL_MAX)));
+        assert(tuple_equal(box.max, point(REAL_MAX, REAL_MAX, REAL_MAX)));
     }
 
     { // A bounded cone has a bounding box
@@ -0,0 +1,409 @@
+// test_bvh.c
+
+#include "../include/bounds.h"
+#include "../include/bvh.h"
+#include "../include/transformations.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A 12x12 sheet of small spheres in the z = 0 plane.
+static group_t *sphere_sheet(sphere_t **spheres)
+{
+    group_t *g = group();
+    for (int i = 0; i < 144; i++)
+    {
+        spheres[i]  = malloc(sizeof(sphere_t));
+        *spheres[i] = sphere();
+        shape_set_transform((shape_t *)spheres[i],
+                            matrix_mul(transform_translation(
+                                           (i % 12) * 2.5, (i / 12) * 2.5, 0),
+                                       transform_scaling(0.5, 0.5, 0.5)));
+        group_add_child(g, (shape_t *)spheres[i]);
+    }
+    return g;
+}
+
+// 64 long, thin triangles lying diagonally across a square, so the boxes
+// of neighbouring triangles overlap almost entirely.
+static group_t *sliver_mesh(void)
+{
+    group_t *g = group();
+    for (int i = 0; i < 64; i++)
+    {
+        triangle_t *t = malloc(sizeof(triangle_t));
+        *t = triangle(point(i * 0.25, 0, 0), point(i * 0.25 + 16, 16, 1),
+                      point(i * 0.25 + 16.1, 16, 1));
+        group_add_child(g, (shape_t *)t);
+    }
+    return g;
+}
+
+// Counts the primitives under g, with the pieces of a cut triangle
+// counting once, and the references to them in pieces.
+static unsigned count_shapes(const group_t *g, unsigned *pieces)
+{
+    unsigned count = 0;
+    for (unsigned i = 0; i < g->child_count; i++)
+    {
+        const shape_t *child = g->children[i];
+        assert(child->parent == g);
+        if (child->type == SHAPE_GROUP)
+        {
+            const group_t *node = (const group_t *)child;
+            assert(node->is_bvh_node);
+            assert(bounds_box_contains_box(bounds_of_group(g),
+                                           bounds_of_group(node)));
+            count += count_shapes(node, pieces);
+        }
+        else if (child->type == SHAPE_CLIPPED)
+        {
+            const clipped_t *piece = (const clipped_t *)child;
+            assert(!piece->owns_target || piece->target->parent == piece);
+            count += piece->owns_target;
+            (*pieces)++;
+        }
+        else
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+static unsigned count_primitives(const group_t *g)
+{
+    unsigned pieces = 0;
+    return count_shapes(g, &pieces);
+}
+
+void test_bvh(void)
+{
+    { // Morton codes interleave the axes with x in the highest bit
+        assert(bvh_morton_code(0, 0, 0, 30) == 0);
+        assert(bvh_morton_code(1, 1, 1, 30) == (1u << 30) - 1);
+        assert(bvh_morton_code(1, 1, 1, 63) == (1ull << 63) - 1);
+        assert(bvh_morton_code(0.5, 0, 0, 30) == 1u << 29);
+        assert(bvh_morton_code(0, 0.5, 0, 30) == 1u << 28);
+        assert(bvh_morton_code(0, 0, 0.5, 63) == 1ull << 60);
+        assert(bvh_morton_code(0.25, 0, 0, 30) <
+               bvh_morton_code(0.5, 0, 0, 30));
+    }
+
+    { // The radix sort orders keys and carries their values along
+        uint64_t keys[1000];
+        uint32_t values[1000];
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            keys[i]   = ((uint64_t)i * 7919u % 1000u) << 40 | i % 3;
+            values[i] = i;
+        }
+
+        assert(bvh_radix_sort(keys, values, 1000, 63));
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            if (i > 0)
+            {
+                assert(keys[i - 1] <= keys[i]);
+            }
+            assert(keys[i] == (((uint64_t)values[i] * 7919u % 1000u) << 40 |
+                               values[i] % 3));
+        }
+    }
+
+    { // Builder names round-trip
+        for (int i = 0; i < BVH_BUILDER_COUNT; i++)
+        {
+            bvh_builder_t builder;
+            assert(bvh_builder_parse(bvh_builder_name((bvh_builder_t)i),
+                                     &builder));
+            assert(builder == (bvh_builder_t)i);
+        }
+
+        bvh_builder_t builder;
+        assert(!bvh_builder_parse("octree", &builder));
+    }
+
+    { // Every builder keeps all children and finds the same hits
+        for (int b = 0; b < BVH_BUILDER_COUNT; b++)
+        {
+            sphere_t *spheres[144];
+            group_t *flat  = sphere_sheet(spheres);
+            group_t *built = sphere_sheet(spheres);
+
+            assert(bvh_build((shape_t *)built, 4, (bvh_builder_t)b));
+            assert(built->builder == (bvh_builder_t)b);
+            assert(built->build_threshold == 4);
+            assert(built->build_cost < group_sah_cost(flat));
+            assert(count_primitives(built) == 144);
+
+            intersections_t expected = empty_intersections();
+            intersections_t xs       = empty_intersections();
+            for (int y = 0; y < 20; y++)
+            {
+                for (int x = 0; x < 20; x++)
+                {
+                    ray_t r =
+                        ray(point(x * 1.57 - 1, y * 1.57 - 1, -5),
+                            vector(0.01 * (x - 10), 0.01 * (y - 10), 1));
+                    expected.count = 0;
+                    xs.count       = 0;
+                    group_intersect(flat, r, &expected);
+                    group_intersect(built, r, &xs);
+
+                    assert(xs.count == expected.count);
+                    for (int i = 0; i < xs.count; i++)
+                    {
+                        assert(equal(xs.intersections[i].t,
+                                     expected.intersections[i].t));
+                    }
+                }
+            }
+
+            intersections_free(&expected);
+            intersections_free(&xs);
+            group_free(flat);
+            group_free(built);
+        }
+    }
+
+    { // Unbounded children stay in the root of a linear BVH
+        sphere_t *spheres[144];
+        group_t *g     = sphere_sheet(spheres);
+        plane_t *floor = malloc(sizeof(plane_t));
+        *floor         = plane();
+        shape_set_transform((shape_t *)floor,
+                            matrix_mul(transform_translation(0, 0, 5),
+                                       transform_rotation_x(M_PI / 2)));
+        group_add_child(g, (shape_t *)floor);
+        divide_lbvh((shape_t *)g, 1, 30);
+
+        assert(g->child_count == 3);
+        assert(g->children[0] == (shape_t *)floor);
+        assert(count_primitives(g) == 145);
+        group_free(g);
+    }
+
+    { // Children on the same spot still get a balanced tree
+        group_t *g = group();
+        for (int i = 0; i < 64; i++)
+        {
+            sphere_t *s = malloc(sizeof(sphere_t));
+            *s          = sphere();
+            group_add_child(g, (shape_t *)s);
+        }
+
+        divide_lbvh((shape_t *)g, 2, 63);
+
+        const group_t *node = g;
+        unsigned depth      = 0;
+        while (node->child_count > 0 &&
+               node->children[0]->type == SHAPE_GROUP)
+        {
+            node = (const group_t *)node->children[0];
+            depth++;
+        }
+        assert(depth == 5);
+        assert(count_primitives(g) == 64);
+        group_free(g);
+    }
+
+    { // The SAH builder finds a cheaper tree than the midpoint split
+        sphere_t *spheres[144];
+        group_t *midpoint = sphere_sheet(spheres);
+        group_t *sah      = sphere_sheet(spheres);
+        divide((shape_t *)midpoint, 4);
+        divide_sah((shape_t *)sah, 4);
+
+        assert(sah->build_cost < midpoint->build_cost);
+        group_free(midpoint);
+        group_free(sah);
+    }
+
+    { // Ranges large enough to be binned by several tasks build correctly
+        group_t *flat  = group();
+        group_t *built = group();
+        unsigned seed  = 1;
+        for (int i = 0; i < 2 * SAH_PARALLEL_BIN_MIN; i++)
+        {
+            seed       = seed * 1103515245u + 12345u;
+            double x   = (seed >> 8) % 1000 * 0.1;
+            seed       = seed * 1103515245u + 12345u;
+            double y   = (seed >> 8) % 1000 * 0.1;
+            matrix_t t = matrix_mul(transform_translation(x, y, i % 7),
+                                    transform_scaling(0.05, 0.05, 0.05));
+            sphere_t *a = malloc(sizeof(sphere_t));
+            sphere_t *b = malloc(sizeof(sphere_t));
+            *a          = sphere();
+            *b          = sphere();
+            shape_set_transform((shape_t *)a, t);
+            shape_set_transform((shape_t *)b, t);
+            group_add_child(flat, (shape_t *)a);
+            group_add_child(built, (shape_t *)b);
+        }
+
+        divide_sah((shape_t *)built, 4);
+        assert(count_primitives(built) == 2 * SAH_PARALLEL_BIN_MIN);
+
+        intersections_t expected = empty_intersections();
+        intersections_t xs       = empty_intersections();
+        for (int i = 0; i < 100; i++)
+        {
+            // Aimed at the centre of one of the spheres.
+            const matrix_t *t = &flat->children[i * 97]->transform;
+            ray_t r = ray(point(t->m[3], t->m[7], -5), vector(0, 0, 1));
+            expected.count = 0;
+            xs.count       = 0;
+            group_intersect(flat, r, &expected);
+            group_intersect(built, r, &xs);
+            assert(expected.count >= 2);
+            assert(xs.count == expected.count);
+        }
+
+        intersections_free(&expected);
+        intersections_free(&xs);
+        group_free(flat);
+        group_free(built);
+    }
+
+    { // Spatial splits cut long thin triangles within the duplication budget
+        group_t *flat = sliver_mesh();
+        group_t *sah  = sliver_mesh();
+        group_t *sbvh = sliver_mesh();
+        divide_sah((shape_t *)sah, 4);
+        divide_sbvh((shape_t *)sbvh, 4);
+
+        unsigned pieces = 0;
+        assert(sbvh->builder == BVH_BUILD_SBVH);
+        assert(count_shapes(sbvh, &pieces) == 64);
+        assert(pieces > 0);
+        assert(pieces <= 2 * (unsigned)(64 * SBVH_MAX_DUPLICATION));
+        assert(bvh_overlap(sbvh) < bvh_overlap(sah));
+
+        // Each triangle is hit once, however many pieces it was cut into.
+        intersections_t expected = empty_intersections();
+        intersections_t xs       = empty_intersections();
+        for (int y = 0; y < 40; y++)
+        {
+            for (int x = 0; x < 80; x++)
+            {
+                ray_t r = ray(point(x * 0.41, y * 0.41, -5),
+                              vector(0.001 * (x - 40), 0.001 * y, 1));
+                expected.count = 0;
+                xs.count       = 0;
+                group_intersect(flat, r, &expected);
+                group_intersect(sbvh, r, &xs);
+
+                assert(xs.count == expected.count);
+                for (int i = 0; i < xs.count; i++)
+                {
+                    assert(equal(xs.intersections[i].t,
+                                 expected.intersections[i].t));
+                }
+            }
+        }
+
+        intersections_free(&expected);
+        intersections_free(&xs);
+        group_free(flat);
+        group_free(sah);
+        group_free(sbvh);
+    }
+
+    { // A spatial split tree is rebuilt from its original triangles
+        group_t *g = sliver_mesh();
+        divide_sbvh((shape_t *)g, 4);
+
+        assert(group_refit_or_rebuild(g));
+        assert(g->builder == BVH_BUILD_SBVH);
+        assert(count_primitives(g) == 64);
+        group_free(g);
+    }
+
+    { // Analysis counts nodes, leaves and straddlers of a hierarchy
+        group_t *g    = group();
+        group_t *node = group();
+        sphere_t *s[3];
+        for (int i = 0; i < 3; i++)
+        {
+            s[i]  = malloc(sizeof(sphere_t));
+            *s[i] = sphere();
+            shape_set_transform((shape_t *)s[i],
+                                transform_translation(i * 3, 0, 0));
+        }
+        group_add_child(node, (shape_t *)s[0]);
+        group_add_child(node, (shape_t *)s[1]);
+        group_add_child(g, (shape_t *)node);
+        group_add_child(g, (shape_t *)s[2]);
+        group_warm_bounds(g);
+
+        bvh_quality_t q = bvh_analyze(g);
+        assert(q.nodes == 2);
+        assert(q.leaves == 1);
+        assert(q.primitives == 3);
+        assert(q.straddlers == 1);
+        assert(q.max_depth == 1);
+        assert(q.min_leaf_size == 2 && q.max_leaf_size == 2);
+        assert(q.leaf_sizes[2] == 1);
+        assert(q.invalid_bounds == 0);
+        assert(equal(q.sah_cost, group_sah_cost(g)));
+
+        // Moving a child without refitting leaves stale bounds behind.
+        s[0]->transform = transform_translation(-10, 0, 0);
+        q               = bvh_analyze(g);
+        assert(q.invalid_bounds == 1);
+        group_free(g);
+    }
+
+    { // Every leaf of a built tree is in the leaf size histogram
+        for (int b = 0; b < BVH_BUILDER_COUNT; b++)
+        {
+            sphere_t *spheres[144];
+            group_t *g = sphere_sheet(spheres);
+            bvh_build((shape_t *)g, 4, (bvh_builder_t)b);
+            group_warm_bounds(g);
+
+            bvh_quality_t q = bvh_analyze(g);
+            unsigned leaves = 0, in_leaves = 0;
+            for (unsigned i = 0; i < BVH_LEAF_HISTOGRAM_BINS; i++)
+            {
+                leaves += q.leaf_sizes[i];
+                in_leaves += i * q.leaf_sizes[i];
+            }
+            assert(leaves == q.leaves);
+            assert(in_leaves + q.straddlers == 144);
+            assert(q.primitives == 144);
+            assert(q.max_leaf_size < 4);
+            assert(q.invalid_bounds == 0);
+            assert(equal(q.sah_cost, g->build_cost));
+            group_free(g);
+        }
+    }
+
+    { // A group rebuilt after refitting uses the builder it was built with
+        sphere_t *spheres[144];
+        group_t *g = sphere_sheet(spheres);
+        assert(bvh_build((shape_t *)g, 4, BVH_BUILD_LBVH63));
+
+        // Swapping every other sphere between the two halves of the sheet
+        // stretches every node across it.
+        for (int i = 0; i < 72; i += 2)
+        {
+            matrix_t t = spheres[i]->transform;
+            shape_set_transform((shape_t *)spheres[i],
+                                spheres[i + 72]->transform);
+            shape_set_transform((shape_t *)spheres[i + 72], t);
+        }
+
+        assert(group_refit_or_rebuild(g));
+        assert(g->builder == BVH_BUILD_LBVH63);
+        assert(count_primitives(g) == 144);
+        group_free(g);
+    }
+}
+
+int main(void)
+{
+    test_bvh();
+    return 0;
+}
@@ -71,6 +71,165 @@ void test_camera(void)
         canvas_free(image);
         world_free(&w);
     }
+
+    { // A sample at the pixel centre matches the pixel ray
+        camera_t c = camera(201, 101, M_PI_2);
+        ray_t r1   = camera_ray_for_pixel(&c, 0, 0);
+        ray_t r2   = camera_ray_for_sample(&c, 0.5, 0.5);
+
+        assert(c.aa_max_samples == 1);
+        assert(tuple_equal(r1.origin, r2.origin));
+        assert(tuple_equal(r1.direction, r2.direction));
+    }
+
+    { // Sample counts too small to split a pixel are raised to the minimum
+        world_t w  = world_default();
+        camera_t c = camera(11, 11, M_PI_2);
+        camera_set_transform(&c, transform_view(point(0, 0, -5),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+
+        camera_set_antialiasing(&c, 0, 0.05);
+        assert(c.aa_max_samples == 1);
+        camera_set_antialiasing(&c, AA_MIN_SAMPLES, 0.05);
+        canvas_t *minimum = camera_render(&c, &w);
+
+        camera_set_antialiasing(&c, 4, 0.05);
+        assert(c.aa_max_samples == AA_MIN_SAMPLES);
+        canvas_t *image = camera_render(&c, &w);
+
+        for (unsigned y = 0; y < c.vsize; y++)
+        {
+            for (unsigned x = 0; x < c.hsize; x++)
+            {
+                assert(tuple_equal(canvas_pixel_at(image, x, y),
+                                   canvas_pixel_at(minimum, x, y)));
+            }
+        }
+
+        canvas_free(minimum);
+        canvas_free(image);
+        world_free(&w);
+    }
+
+    { // Adaptive anti-aliasing blends pixels on a silhouette
+        world_t w  = world_default();
+        camera_t c = camera(11, 11, M_PI_2);
+        camera_set_transform(&c, transform_view(point(0, 0, -5),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+        canvas_t *plain = camera_render(&c, &w);
+
+        camera_set_antialiasing(&c, 64, 0.05);
+        canvas_t *smooth = camera_render(&c, &w);
+
+        tuple_t edge_plain  = canvas_pixel_at(plain, 4, 5);
+        tuple_t edge_smooth = canvas_pixel_at(smooth, 4, 5);
+        assert(edge_smooth.y > 0);
+        assert(edge_smooth.y < edge_plain.y);
+        assert(tuple_equal(canvas_pixel_at(smooth, 0, 0), color(0, 0, 0)));
+
+        canvas_free(plain);
+        canvas_free(smooth);
+        world_free(&w);
+    }
+
+    { // Rendering a region matches the same pixels of a full render
+        world_t w  = world_default();
+        camera_t c = camera(11, 11, M_PI_2);
+        camera_set_transform(&c, transform_view(point(0, 0, -5),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+        canvas_t *full = camera_render(&c, &w);
+
+        render_region_t region = {4, 3, 4, 20};
+        canvas_t *crop         = camera_render_region(&c, &w, region);
+        assert(crop->width == 4);
+        assert(crop->height == 8);
+        assert(tuple_equal(canvas_pixel_at(crop, 1, 2),
+                           canvas_pixel_at(full, 5, 5)));
+
+        canvas_t *target = canvas(11, 11);
+        assert(camera_render_into(&c, &w, region, target));
+        assert(tuple_equal(canvas_pixel_at(target, 5, 5),
+                           canvas_pixel_at(full, 5, 5)));
+        assert(tuple_equal(canvas_pixel_at(target, 3, 5), color(0, 0, 0)));
+
+        render_region_t outside = {11, 0, 2, 2};
+        assert(camera_render_region(&c, &w, outside) == NULL);
+
+        canvas_free(full);
+        canvas_free(crop);
+        canvas_free(target);
+        world_free(&w);
+    }
+
+    { // Progressive rendering converges to the same image as a full render
+        world_t w  = world_default();
+        camera_t c = camera(11, 11, M_PI_2);
+        camera_set_transform(&c, transform_view(point(0, 0, -5),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+        canvas_t *expected = camera_render(&c, &w);
+        canvas_t *image =
+            camera_render_progressive(&c, &w, "test_progressive_preview.ppm");
+
+        for (unsigned y = 0; y < c.vsize; y++)
+        {
+            for (unsigned x = 0; x < c.hsize; x++)
+            {
+                assert(tuple_equal(canvas_pixel_at(image, x, y),
+                                   canvas_pixel_at(expected, x, y)));
+            }
+        }
+
+        FILE *preview = fopen("test_progressive_preview.ppm", "r");
+        assert(preview != NULL);
+        fclose(preview);
+        remove("test_progressive_preview.ppm");
+
+        canvas_free(expected);
+        canvas_free(image);
+        world_free(&w);
+    }
+
+    { // Anti-aliased and wavefront progressive renders match full renders
+        world_t w  = world_default();
+        camera_t c = camera(11, 11, M_PI_2);
+        camera_set_transform(&c, transform_view(point(0, 0, -5),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+
+        for (int mode = 0; mode < 2; mode++)
+        {
+            if (mode == 0)
+            {
+                camera_set_antialiasing(&c, 16, 0.05);
+            }
+            else
+            {
+                camera_set_antialiasing(&c, 1, 0.05);
+                camera_set_wavefront(&c, true);
+            }
+
+            canvas_t *expected = camera_render(&c, &w);
+            canvas_t *image    = camera_render_progressive(&c, &w, NULL);
+
+            for (unsigned y = 0; y < c.vsize; y++)
+            {
+                for (unsigned x = 0; x < c.hsize; x++)
+                {
+                    assert(tuple_equal(canvas_pixel_at(image, x, y),
+                                       canvas_pixel_at(expected, x, y)));
+                }
+            }
+
+            canvas_free(expected);
+            canvas_free(image);
+        }
+
+        world_free(&w);
+    }
 }
 
 int main(void)
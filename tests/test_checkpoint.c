@@ -0,0 +1,188 @@
+// test_checkpoint.c
+
+#include "../include/checkpoint.h"
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECKPOINT_PATH "test_checkpoint.bin"
+
+static camera_t checkpoint_camera(void)
+{
+    camera_t c = camera(40, 40, M_PI_2);
+    camera_set_transform(&c, transform_view(point(0, 0, -5), point(0, 0, 0),
+                                            vector(0, 1, 0)));
+    return c;
+}
+
+// Overwrites the first pixel of the first tile recorded in the checkpoint
+// with red and returns that tile's index.
+static uint32_t checkpoint_mark_first_tile(void)
+{
+    FILE *file = fopen(CHECKPOINT_PATH, "r+b");
+    assert(file != NULL);
+    uint32_t tile;
+    assert(fseek(file, sizeof(checkpoint_header_t), SEEK_SET) == 0);
+    assert(fread(&tile, sizeof(tile), 1, file) == 1);
+    float red[3] = {1, 0, 0};
+    assert(fseek(file, 0, SEEK_CUR) == 0);
+    assert(fwrite(red, sizeof(red), 1, file) == 1);
+    fclose(file);
+    return tile;
+}
+
+void test_checkpoint(void)
+{
+    { // A checkpointed render matches a plain render
+        world_t w          = world_default();
+        camera_t c         = checkpoint_camera();
+        canvas_t *expected = camera_render(&c, &w);
+        canvas_t *image    = checkpoint_render(&c, &w, CHECKPOINT_PATH, false);
+
+        for (unsigned y = 0; y < c.vsize; y++)
+        {
+            for (unsigned x = 0; x < c.hsize; x++)
+            {
+                assert(tuple_equal(canvas_pixel_at(image, x, y),
+                                   canvas_pixel_at(expected, x, y)));
+            }
+        }
+
+        canvas_free(expected);
+        canvas_free(image);
+        world_free(&w);
+    }
+
+    { // Resuming restores finished tiles instead of rendering them again
+        world_t w  = world_default();
+        camera_t c = checkpoint_camera();
+
+        // Mark the first pixel of the first recorded tile and append a torn
+        // record, as if the job had been killed mid-write.
+        uint32_t tile = checkpoint_mark_first_tile();
+        float red[3]  = {1, 0, 0};
+        FILE *file    = fopen(CHECKPOINT_PATH, "ab");
+        assert(file != NULL);
+        assert(fwrite(&tile, sizeof(tile), 1, file) == 1);
+        assert(fwrite(red, sizeof(red), 1, file) == 1);
+        fclose(file);
+
+        unsigned tiles_x = (c.hsize + CHECKPOINT_TILE_SIZE - 1) /
+                           CHECKPOINT_TILE_SIZE;
+        unsigned x = (tile % tiles_x) * CHECKPOINT_TILE_SIZE;
+        unsigned y = (tile / tiles_x) * CHECKPOINT_TILE_SIZE;
+
+        canvas_t *image = checkpoint_render(&c, &w, CHECKPOINT_PATH, true);
+        assert(tuple_equal(canvas_pixel_at(image, x, y), color(1, 0, 0)));
+        canvas_free(image);
+
+        // A different camera no longer matches the checkpoint header.
+        camera_set_transform(&c, transform_view(point(0, 0, -6),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+        image = checkpoint_render(&c, &w, CHECKPOINT_PATH, true);
+        assert(!tuple_equal(canvas_pixel_at(image, x, y), color(1, 0, 0)));
+        canvas_free(image);
+
+        world_free(&w);
+        remove(CHECKPOINT_PATH);
+    }
+
+    { // The scene hash changes when the scene does
+        world_t w     = world_default();
+        uint64_t hash = checkpoint_scene_hash(&w);
+        assert(hash == checkpoint_scene_hash(&w));
+
+        w.objects[0].shape.material.reflective = 0.5;
+        assert(hash != checkpoint_scene_hash(&w));
+        world_free(&w);
+    }
+
+    { // The scene hash covers an area light's jitter patterns
+        world_t w = world();
+        world_add_light(&w, lights_area_light(point(-1, 1, -1), vector(2, 0, 0),
+                                              4, vector(0, 2, 0), 4,
+                                              color(1, 1, 1)));
+        lights_set_stratified_jitter(&w.lights[0], 4, 1);
+        uint64_t hash = checkpoint_scene_hash(&w);
+
+        lights_set_stratified_jitter(&w.lights[0], 4, 2);
+        assert(hash != checkpoint_scene_hash(&w));
+        lights_set_stratified_jitter(&w.lights[0], 8, 1);
+        assert(hash != checkpoint_scene_hash(&w));
+
+        lights_set_stratified_jitter(&w.lights[0], 4, 1);
+        assert(hash == checkpoint_scene_hash(&w));
+        world_free(&w);
+    }
+
+    { // The scene hash covers the shapes inside groups
+        triangle_t *t = malloc(sizeof(triangle_t));
+        *t = triangle(point(0, 1, 0), point(-1, 0, 0), point(1, 0, 0));
+        cone_t *k = malloc(sizeof(cone_t));
+        *k        = cone();
+
+        world_t w  = world();
+        group_t *g = group();
+        group_add_child(g, (shape_t *)t);
+        group_add_child(g, (shape_t *)k);
+        world_add_group(&w, g);
+
+        group_t *root   = &w.objects[0].group;
+        triangle_t *tri = (triangle_t *)root->children[0];
+        cone_t *child   = (cone_t *)root->children[1];
+        uint64_t hash   = checkpoint_scene_hash(&w);
+
+        child->maximum = 1;
+        assert(hash != checkpoint_scene_hash(&w));
+        child->maximum = DBL_MAX;
+        assert(hash == checkpoint_scene_hash(&w));
+
+        child->material.diffuse = 0.2;
+        assert(hash != checkpoint_scene_hash(&w));
+        child->material = material();
+
+        triangle_set_points(tri, point(0, 2, 0), point(-1, 0, 0),
+                            point(1, 0, 0));
+        assert(hash != checkpoint_scene_hash(&w));
+        world_free(&w);
+    }
+
+    { // Editing a vertex inside a group invalidates the checkpoint
+        triangle_t *t = malloc(sizeof(triangle_t));
+        *t = triangle(point(0, 3, 3), point(-1, 2, 3), point(1, 2, 3));
+
+        world_t w  = world_default();
+        camera_t c = checkpoint_camera();
+        group_t *g = group();
+        group_add_child(g, (shape_t *)t);
+        world_add_group(&w, g);
+
+        canvas_free(checkpoint_render(&c, &w, CHECKPOINT_PATH, false));
+        uint32_t tile = checkpoint_mark_first_tile();
+
+        unsigned tiles_x = (c.hsize + CHECKPOINT_TILE_SIZE - 1) /
+                           CHECKPOINT_TILE_SIZE;
+        unsigned x = (tile % tiles_x) * CHECKPOINT_TILE_SIZE;
+        unsigned y = (tile / tiles_x) * CHECKPOINT_TILE_SIZE;
+
+        group_t *root = &w.objects[w.object_count - 1].group;
+        triangle_set_points((triangle_t *)root->children[0], point(0, 4, 3),
+                            point(-1, 2, 3), point(1, 2, 3));
+
+        canvas_t *image = checkpoint_render(&c, &w, CHECKPOINT_PATH, true);
+        assert(!tuple_equal(canvas_pixel_at(image, x, y), color(1, 0, 0)));
+        canvas_free(image);
+
+        world_free(&w);
+        remove(CHECKPOINT_PATH);
+    }
+}
+
+int main(void)
+{
+    test_checkpoint();
+    return 0;
+}
@@ -12,43 +12,55 @@ void test_cones(void)
         cone_t shape       = cone();
         tuple_t direction  = tuple_normalize(vector(0, 0, 1));
         ray_t r            = ray(point(0, 0, -5), direction);
-        intersections_t xs = shape_intersect((shape_t *)&shape, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&shape, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 5.0));
         assert(equal(xs.intersections[1].t, 5.0));
+
+        intersections_free(&xs);
     }
 
     { // Intersecting a cone with a ray (2)
         cone_t shape       = cone();
         tuple_t direction  = tuple_normalize(vector(1, 1, 1));
         ray_t r            = ray(point(0, 0, -5), direction);
-        intersections_t xs = shape_intersect((shape_t *)&shape, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&shape, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 8.66025));
         assert(equal(xs.intersections[1].t, 8.66025));
+
+        intersections_free(&xs);
     }
 
     { // Intersecting a cone with a ray (3)
         cone_t shape       = cone();
         tuple_t direction  = tuple_normalize(vector(-0.5, -1, 1));
         ray_t r            = ray(point(1, 1, -5), direction);
-        intersections_t xs = shape_intersect((shape_t *)&shape, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&shape, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 4.55006));
         assert(equal(xs.intersections[1].t, 49.44994));
+
+        intersections_free(&xs);
     }
 
     { // Intersecting a cone with a ray parallel to one of its halves
         cone_t shape       = cone();
         tuple_t direction  = tuple_normalize(vector(0, 1, 1));
         ray_t r            = ray(point(0, 0, -1), direction);
-        intersections_t xs = shape_intersect((shape_t *)&shape, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&shape, r, &xs);
 
         assert(xs.count == 1);
         assert(equal(xs.intersections[0].t, 0.35355));
+
+        intersections_free(&xs);
     }
 
     { // Intersecting a cone's end caps (1)
@@ -58,9 +70,12 @@ void test_cones(void)
         shape.closed       = true;
         tuple_t direction  = tuple_normalize(vector(0, 1, 0));
         ray_t r            = ray(point(0, 0, -5), direction);
-        intersections_t xs = shape_intersect((shape_t *)&shape, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&shape, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // Intersecting a cone's end caps (2)
@@ -70,9 +85,12 @@ void test_cones(void)
         shape.closed       = true;
         tuple_t direction  = tuple_normalize(vector(0, 1, 1));
         ray_t r            = ray(point(0, 0, -0.25), direction);
-        intersections_t xs = shape_intersect((shape_t *)&shape, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&shape, r, &xs);
 
         assert(xs.count == 2);
+
+        intersections_free(&xs);
     }
 
     { // Intersecting a cone's end caps (3)
@@ -82,9 +100,12 @@ void test_cones(void)
         shape.closed       = true;
         tuple_t direction  = tuple_normalize(vector(0, 1, 0));
         ray_t r            = ray(point(0, 0, -0.25), direction);
-        intersections_t xs = shape_intersect((shape_t *)&shape, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&shape, r, &xs);
 
         assert(xs.count == 4);
+
+        intersections_free(&xs);
     }
 
     printf("test_cones passed!\n");
@@ -9,95 +9,125 @@ void test_cubes(void)
     { // A ray intersects a cube from the +x direction
         cube_t c           = cube();
         ray_t r            = ray(point(5, 0.5, 0), vector(-1, 0, 0));
-        intersections_t xs = shape_intersect(&c, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&c, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 4.0));
         assert(equal(xs.intersections[1].t, 6.0));
+
+        intersections_free(&xs);
     }
 
     { // A ray intersects a cube from the -x direction
         cube_t c           = cube();
         ray_t r            = ray(point(-5, 0.5, 0), vector(1, 0, 0));
-        intersections_t xs = shape_intersect(&c, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&c, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 4.0));
         assert(equal(xs.intersections[1].t, 6.0));
+
+        intersections_free(&xs);
     }
 
     { // A ray intersects a cube from the +y direction
         cube_t c           = cube();
         ray_t r            = ray(point(0.5, 5, 0), vector(0, -1, 0));
-        intersections_t xs = shape_intersect(&c, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&c, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 4.0));
         assert(equal(xs.intersections[1].t, 6.0));
+
+        intersections_free(&xs);
     }
 
     { // A ray intersects a cube from the -y direction
         cube_t c           = cube();
         ray_t r            = ray(point(0.5, -5, 0), vector(0, 1, 0));
-        intersections_t xs = shape_intersect(&c, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&c, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 4.0));
         assert(equal(xs.intersections[1].t, 6.0));
+
+        intersections_free(&xs);
     }
 
     { // A ray intersects a cube from the +z direction
         cube_t c           = cube();
         ray_t r            = ray(point(0.5, 0, 5), vector(0, 0, -1));
-        intersections_t xs = shape_intersect(&c, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&c, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 4.0));
         assert(equal(xs.intersections[1].t, 6.0));
+
+        intersections_free(&xs);
     }
 
     { // A ray intersects a cube from the -z direction
         cube_t c           = cube();
         ray_t r            = ray(point(0.5, 0, -5), vector(0, 0, 1));
-        intersections_t xs = shape_intersect(&c, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&c, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 4.0));
         assert(equal(xs.intersections[1].t, 6.0));
+
+        intersections_free(&xs);
     }
 
     { // A ray intersects a cube from the inside
         cube_t c           = cube();
         ray_t r            = ray(point(0, 0.5, 0), vector(0, 0, 1));
-        intersections_t xs = shape_intersect(&c, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&c, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, -1.0));
         assert(equal(xs.intersections[1].t, 1.0));
+
+        intersections_free(&xs);
     }
 
     { // A ray misses a cube (parallel to x faces)
         cube_t c = cube();
         ray_t r  = ray(point(-2, 0, 0), vector(0.2673, 0.5345, 0.8018));
-        intersections_t xs = shape_intersect(&c, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&c, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // A ray misses a cube (parallel to y faces)
         cube_t c = cube();
         ray_t r  = ray(point(0, -2, 0), vector(0.8018, 0.2673, 0.5345));
-        intersections_t xs = shape_intersect(&c, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&c, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // A ray misses a cube (parallel to z faces)
         cube_t c = cube();
         ray_t r  = ray(point(0, 0, -2), vector(0.5345, 0.8018, 0.2673));
-        intersections_t xs = shape_intersect(&c, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&c, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // The normal on the surface of a cube (positive x)
@@ -25,60 +25,78 @@ void test_cylinders(void)
         cylinder_t cyl     = cylinder();
         tuple_t direction  = tuple_normalize(vector(0, 1, 0));
         ray_t r            = ray(point(1, 0, 0), direction);
-        intersections_t xs = shape_intersect((shape_t *)&cyl, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&cyl, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // A ray misses a cylinder (ray inside, parallel to y-axis)
         cylinder_t cyl     = cylinder();
         tuple_t direction  = tuple_normalize(vector(0, 1, 0));
         ray_t r            = ray(point(0, 0, 0), direction);
-        intersections_t xs = shape_intersect((shape_t *)&cyl, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&cyl, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // A ray misses a cylinder (ray outside, askew)
         cylinder_t cyl     = cylinder();
         tuple_t direction  = tuple_normalize(vector(1, 1, 1));
         ray_t r            = ray(point(0, 0, -5), direction);
-        intersections_t xs = shape_intersect((shape_t *)&cyl, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&cyl, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // A ray strikes a cylinder (tangent, single point)
         cylinder_t cyl     = cylinder();
         tuple_t direction  = tuple_normalize(vector(0, 0, 1));
         ray_t r            = ray(point(1, 0, -5), direction);
-        intersections_t xs = shape_intersect((shape_t *)&cyl, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&cyl, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 5.0));
         assert(equal(xs.intersections[1].t, 5.0));
+
+        intersections_free(&xs);
     }
 
     { // A ray strikes a cylinder (perpendicular through middle)
         cylinder_t cyl     = cylinder();
         tuple_t direction  = tuple_normalize(vector(0, 0, 1));
         ray_t r            = ray(point(0, 0, -5), direction);
-        intersections_t xs = shape_intersect((shape_t *)&cyl, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&cyl, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 4.0));
         assert(equal(xs.intersections[1].t, 6.0));
+
+        intersections_free(&xs);
     }
 
     { // A ray strikes a cylinder (at an angle)
         cylinder_t cyl     = cylinder();
         tuple_t direction  = tuple_normalize(vector(0.1, 1, 1));
         ray_t r            = ray(point(0.5, 0, -5), direction);
-        intersections_t xs = shape_intersect((shape_t *)&cyl, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&cyl, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 6.80798));
         assert(equal(xs.intersections[1].t, 7.08872));
+
+        intersections_free(&xs);
     }
 
     { // Normal vector on a cylinder at +x
@@ -116,9 +134,12 @@ void test_cylinders(void)
         cyl.closed     = true;
         tuple_t direction  = tuple_normalize(vector(0, -1, 0));
         ray_t r            = ray(point(0, 3, 0), direction);
-        intersections_t xs = shape_intersect((shape_t *)&cyl, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&cyl, r, &xs);
 
         assert(xs.count == 2);
+
+        intersections_free(&xs);
     }
 
     { // Intersecting the caps of a closed cylinder (2)
@@ -128,9 +149,12 @@ void test_cylinders(void)
         cyl.closed     = true;
         tuple_t direction  = tuple_normalize(vector(0, -1, 2));
         ray_t r            = ray(point(0, 3, -2), direction);
-        intersections_t xs = shape_intersect((shape_t *)&cyl, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&cyl, r, &xs);
 
         assert(xs.count == 2);
+
+        intersections_free(&xs);
     }
 
     { // Intersecting the caps of a closed cylinder (3)
@@ -140,9 +164,12 @@ void test_cylinders(void)
         cyl.closed     = true;
         tuple_t direction  = tuple_normalize(vector(0, -1, 1));
         ray_t r            = ray(point(0, 4, -2), direction);
-        intersections_t xs = shape_intersect((shape_t *)&cyl, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&cyl, r, &xs);
 
         assert(xs.count == 2);
+
+        intersections_free(&xs);
     }
 
     { // Intersecting the caps of a closed cylinder (4)
@@ -152,9 +179,12 @@ void test_cylinders(void)
         cyl.closed     = true;
         tuple_t direction  = tuple_normalize(vector(0, 1, 2));
         ray_t r            = ray(point(0, 0, -2), direction);
-        intersections_t xs = shape_intersect((shape_t *)&cyl, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&cyl, r, &xs);
 
         assert(xs.count == 2);
+
+        intersections_free(&xs);
     }
 
     { // Intersecting the caps of a closed cylinder (5)
@@ -164,9 +194,12 @@ void test_cylinders(void)
         cyl.closed     = true;
         tuple_t direction  = tuple_normalize(vector(0, 1, 1));
         ray_t r            = ray(point(0, -1, -2), direction);
-        intersections_t xs = shape_intersect((shape_t *)&cyl, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&cyl, r, &xs);
 
         assert(xs.count == 2);
+
+        intersections_free(&xs);
     }
 
     { // Normal vector on cylinder's end caps (bottom center)
@@ -0,0 +1,86 @@
+// test_distributed.c
+
+#include "../include/distributed.h"
+#include <assert.h>
+#include <math.h>
+
+static camera_t distributed_camera(void)
+{
+    camera_t c = camera(45, 30, M_PI_2);
+    camera_set_transform(&c, transform_view(point(0, 0, -5), point(0, 0, 0),
+                                            vector(0, 1, 0)));
+    return c;
+}
+
+static void assert_same_image(const canvas_t *a, const canvas_t *b)
+{
+    assert(a != NULL && b != NULL);
+    assert(a->width == b->width && a->height == b->height);
+    for (unsigned y = 0; y < a->height; y++)
+    {
+        for (unsigned x = 0; x < a->width; x++)
+        {
+            assert(tuple_equal(canvas_pixel_at(a, x, y),
+                               canvas_pixel_at(b, x, y)));
+        }
+    }
+}
+
+void test_distributed(void)
+{
+    { // Worker processes render the same image as a local render
+        world_t w          = world_default();
+        camera_t c         = distributed_camera();
+        canvas_t *expected = camera_render(&c, &w);
+
+        distributed_options_t options = distributed_options(3);
+        options.tile_size             = 8;
+        canvas_t *image               = distributed_render(&c, &w, &options);
+
+        assert_same_image(image, expected);
+
+        canvas_free(expected);
+        canvas_free(image);
+        world_free(&w);
+    }
+
+    { // Tiles from crashed workers are retried on replacement workers
+        // Every tile crashes its worker on all but the last allowed attempt.
+        world_t w          = world_default();
+        camera_t c         = distributed_camera();
+        canvas_t *expected = camera_render(&c, &w);
+
+        distributed_options_t options = distributed_options(2);
+        options.tile_size             = 16;
+        options.max_attempts          = 4;
+        distributed_set_crash_attempts(3);
+        canvas_t *image = distributed_render(&c, &w, &options);
+        distributed_set_crash_attempts(0);
+
+        assert_same_image(image, expected);
+
+        canvas_free(expected);
+        canvas_free(image);
+        world_free(&w);
+    }
+
+    { // Rendering fails once a tile exhausts its attempts
+        world_t w  = world_default();
+        camera_t c = distributed_camera();
+
+        distributed_options_t options = distributed_options(1);
+        options.max_attempts          = 1;
+        options.tile_size             = 16;
+
+        distributed_set_crash_attempts(1);
+        assert(distributed_render(&c, &w, &options) == NULL);
+        distributed_set_crash_attempts(0);
+        world_free(&w);
+    }
+}
+
+int main(void)
+{
+    test_distributed();
+    return 0;
+}
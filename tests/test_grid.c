@@ -0,0 +1,152 @@
+// test_grid.c
+
+#include "../include/bounds.h"
+#include "../include/grid.h"
+#include "../include/transformations.h"
+#include <assert.h>
+#include <stdlib.h>
+
+// n x n x n small spheres, 2.5 apart, plus a few larger ones spanning many
+// cells.
+static group_t *sphere_block(unsigned n)
+{
+    group_t *g = group();
+    for (unsigned i = 0; i < n * n * n + 3; i++)
+    {
+        sphere_t *s = malloc(sizeof(sphere_t));
+        *s          = sphere();
+        matrix_t t =
+            i < n * n * n
+                ? matrix_mul(transform_translation(i % n * 2.5,
+                                                   i / n % n * 2.5,
+                                                   i / (n * n) * 2.5),
+                             transform_scaling(0.5, 0.5, 0.5))
+                : matrix_mul(transform_translation(i % 3 * 4.0, 5, 5),
+                             transform_scaling(3, 3, 3));
+        shape_set_transform((shape_t *)s, t);
+        group_add_child(g, (shape_t *)s);
+    }
+    return g;
+}
+
+// Every ray finds the same distances through both groups.
+static void assert_same_hits(const group_t *flat, const group_t *gridded)
+{
+    intersections_t expected = empty_intersections();
+    intersections_t xs       = empty_intersections();
+    unsigned seed            = 7;
+    for (int i = 0; i < 2000; i++)
+    {
+        double v[6];
+        for (int k = 0; k < 6; k++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            v[k] = (seed >> 8) % 10000 / 10000.0;
+        }
+
+        // Half start inside the grid, half outside it.
+        tuple_t origin =
+            i % 2 == 0 ? point(v[0] * 12, v[1] * 12, v[2] * 12)
+                       : point(v[0] * 60 - 20, v[1] * 60 - 20, -30);
+        tuple_t direction = i % 4 == 1 ? vector(0, 0, 1)
+                                       : vector(v[3] - 0.5, v[4] - 0.5,
+                                                v[5] - 0.5 + (i % 2));
+        ray_t r = ray(origin, direction);
+
+        expected.count = 0;
+        xs.count       = 0;
+        group_intersect(flat, r, &expected);
+        group_intersect(gridded, r, &xs);
+
+        assert(xs.count == expected.count);
+        for (int k = 0; k < xs.count; k++)
+        {
+            assert(equal(xs.intersections[k].t, expected.intersections[k].t));
+        }
+    }
+    intersections_free(&expected);
+    intersections_free(&xs);
+}
+
+void test_grid(void)
+{
+    { // A grid covers its children's bounds with cells sized to the count
+        group_t *g = sphere_block(4);
+        assert(group_build_grid(g));
+
+        const grid_t *grid = g->grid;
+        assert(bounds_box_contains_box(grid->box, bounds_of_group(g)));
+        assert(bounds_box_contains_box(bounds_of_group(g), grid->box));
+        for (int axis = 0; axis < 3; axis++)
+        {
+            assert(grid->resolution[axis] >= 1);
+            assert(grid->resolution[axis] <= GRID_MAX_RESOLUTION);
+        }
+        assert(grid->unbounded_count == 0);
+        assert(!grid->stale);
+        group_free(g);
+    }
+
+    { // Rays through a grid find the same hits as testing every child
+        group_t *flat    = sphere_block(5);
+        group_t *gridded = sphere_block(5);
+        assert(group_build_grid(gridded));
+
+        assert_same_hits(flat, gridded);
+        group_free(flat);
+        group_free(gridded);
+    }
+
+    { // Unbounded children are tested by every ray
+        group_t *g     = sphere_block(2);
+        plane_t *floor = malloc(sizeof(plane_t));
+        *floor         = plane();
+        group_add_child(g, (shape_t *)floor);
+        assert(group_build_grid(g));
+        assert(g->grid->unbounded_count == 1);
+
+        intersections_t xs = empty_intersections();
+        group_intersect(g, ray(point(100, 10, 100), vector(0, -1, 0)), &xs);
+        assert(xs.count == 1);
+        assert(xs.intersections[0].object == floor);
+        intersections_free(&xs);
+        group_free(g);
+    }
+
+    { // A grid whose children moved is rebuilt when bounds are warmed
+        group_t *flat    = sphere_block(3);
+        group_t *gridded = sphere_block(3);
+        assert(group_build_grid(gridded));
+
+        shape_t *moved = gridded->children[0];
+        shape_set_transform(moved, transform_translation(20, 20, 20));
+        shape_set_transform(flat->children[0],
+                            transform_translation(20, 20, 20));
+        assert(gridded->grid->stale);
+
+        // A stale grid is bypassed, so hits stay right before the rebuild.
+        assert_same_hits(flat, gridded);
+
+        group_warm_bounds(gridded);
+        assert(!gridded->grid->stale);
+        assert(bounds_box_contains_point(gridded->grid->box,
+                                         point(20, 20, 20)));
+        assert_same_hits(flat, gridded);
+        group_free(flat);
+        group_free(gridded);
+    }
+
+    { // Clearing the grid returns the group to testing every child
+        group_t *g = sphere_block(2);
+        assert(group_build_grid(g));
+        group_clear_grid(g);
+        assert(g->grid == NULL);
+        group_free(g);
+    }
+}
+
+int main(void)
+{
+    test_grid();
+    return 0;
+}
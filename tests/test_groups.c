@@ -1,5 +1,6 @@
 // test_groups.c
 
+#include "../include/bounds.h"
 #include "../include/shapes.h"
 #include "../include/transformations.h"
 #include <assert.h>
@@ -39,8 +40,10 @@ void test_groups(void)
     { // Intersecting a ray with an empty group
         group_t *g         = group();
         ray_t r            = ray(point(0, 0, 0), vector(0, 0, 1));
-        intersections_t xs = group_intersect(g, r);
+        intersections_t xs = empty_intersections();
+        group_intersect(g, r, &xs);
         assert(xs.count == 0);
+        intersections_free(&xs);
         group_free(g);
     }
 
@@ -63,7 +66,8 @@ void test_groups(void)
         group_add_child(g, (shape_t *)s3);
 
         ray_t r            = ray(point(0, 0, -5), vector(0, 0, 1));
-        intersections_t xs = group_intersect(g, r);
+        intersections_t xs = empty_intersections();
+        group_intersect(g, r, &xs);
 
         assert(xs.count == 4);
         assert(xs.intersections[0].object == s2);
@@ -71,6 +75,7 @@ void test_groups(void)
         assert(xs.intersections[2].object == s1);
         assert(xs.intersections[3].object == s1);
 
+        intersections_free(&xs);
         group_free(g);
     }
 
@@ -85,10 +90,12 @@ void test_groups(void)
         group_add_child(g, (shape_t *)s);
 
         ray_t r            = ray(point(10, 0, -10), vector(0, 0, 1));
-        intersections_t xs = shape_intersect((shape_t *)g, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)g, r, &xs);
 
         assert(xs.count == 2);
 
+        intersections_free(&xs);
         group_free(g);
     }
 
@@ -167,11 +174,13 @@ void test_groups(void)
         group_add_child(shape, (shape_t *)child);
         ray_t r = ray(point(0, 0, -5), vector(0, 1, 0));
 
-        intersections_t xs = shape_intersect((shape_t *)shape, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)shape, r, &xs);
         (void)xs;
 
         assert(child->has_saved_ray == false);
 
+        intersections_free(&xs);
         group_free(shape);
     }
 
@@ -183,11 +192,13 @@ void test_groups(void)
         group_add_child(shape, (shape_t *)child);
         ray_t r = ray(point(0, 0, -5), vector(0, 0, 1));
 
-        intersections_t xs = shape_intersect((shape_t *)shape, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)shape, r, &xs);
         (void)xs;
 
         assert(child->has_saved_ray == true);
 
+        intersections_free(&xs);
         group_free(shape);
     }
 
@@ -345,6 +356,128 @@ void test_groups(void)
 
         group_free(g);
     }
+    { // Transforming a child marks its parent groups dirty until warmed
+        sphere_t *s = malloc(sizeof(sphere_t));
+        *s          = sphere();
+
+        group_t *inner = group();
+        group_add_child(inner, (shape_t *)s);
+        group_t *g = group();
+        group_add_child(g, (shape_t *)inner);
+
+        bounding_box_t before = bounds_of_group(g);
+        assert(tuple_equal(before.max, point(1, 1, 1)));
+
+        shape_set_transform((shape_t *)s, transform_translation(5, 0, 0));
+
+        assert(!inner->bounds_cached && !g->bounds_cached);
+        assert(!inner->world_bounds_cached);
+
+        group_warm_bounds(g);
+        assert(inner->bounds_cached && g->bounds_cached);
+        bounding_box_t after = bounds_of_group(g);
+        assert(tuple_equal(after.min, point(4, -1, -1)));
+        assert(tuple_equal(after.max, point(6, 1, 1)));
+        assert(tuple_equal(inner->world_bounds.max, point(6, 1, 1)));
+
+        group_free(g);
+    }
+
+    { // Refitting a group after moving triangle vertices
+        triangle_t *t = malloc(sizeof(triangle_t));
+        *t = triangle(point(0, 1, 0), point(-1, 0, 0), point(1, 0, 0));
+
+        group_t *g = group();
+        group_add_child(g, (shape_t *)t);
+        bounds_of_group(g);
+
+        triangle_set_points(t, point(0, 3, 0), point(-1, 0, 0),
+                            point(1, 0, 2));
+        group_refit(g);
+
+        bounding_box_t box = bounds_of_group(g);
+        assert(tuple_equal(box.min, point(-1, 0, 0)));
+        assert(tuple_equal(box.max, point(1, 3, 2)));
+        assert(tuple_equal(t->e1, vector(-1, -3, 0)));
+
+        ray_t r            = ray(point(0, 2, -5), vector(0, 0, 1));
+        intersections_t xs = empty_intersections();
+        group_intersect(g, r, &xs);
+        assert(xs.count == 1);
+
+        intersections_free(&xs);
+        group_free(g);
+    }
+
+    { // A refitted BVH is rebuilt once moved children degrade it
+        sphere_t *spheres[16];
+        group_t *g = group();
+        for (int i = 0; i < 16; i++)
+        {
+            spheres[i]  = malloc(sizeof(sphere_t));
+            *spheres[i] = sphere();
+            shape_set_transform((shape_t *)spheres[i],
+                                transform_translation(i * 3, 0, 0));
+            group_add_child(g, (shape_t *)spheres[i]);
+        }
+
+        divide((shape_t *)g, 2);
+        double built = g->build_cost;
+        assert(built > 0);
+
+        shape_set_transform((shape_t *)spheres[0],
+                            transform_translation(0.5, 0, 0));
+        assert(!group_refit_or_rebuild(g));
+
+        // Swapping every other sphere between the two halves of the row
+        // stretches every node of the tree across the whole row.
+        for (int i = 0; i < 8; i += 2)
+        {
+            shape_set_transform((shape_t *)spheres[i],
+                                transform_translation((i + 8) * 3, 0, 0));
+            shape_set_transform((shape_t *)spheres[i + 8],
+                                transform_translation(i * 3, 0, 0));
+        }
+        assert(group_sah_cost(g) > built * BVH_REBUILD_COST_RATIO);
+        assert(group_refit_or_rebuild(g));
+        assert(group_sah_cost(g) <= built * BVH_REBUILD_COST_RATIO);
+
+        ray_t r            = ray(point(9, 0, -5), vector(0, 0, 1));
+        intersections_t xs = empty_intersections();
+        group_intersect(g, r, &xs);
+        assert(xs.count == 2);
+        assert(xs.intersections[0].object == spheres[3]);
+
+        intersections_free(&xs);
+        group_free(g);
+    }
+
+    { // A ray through more children than a list starts with keeps every hit
+        group_t *g       = group();
+        shape_t *nearest = NULL;
+        for (int i = INTERSECTIONS_INITIAL_CAPACITY; i >= 0; i--)
+        {
+            sphere_t *s = malloc(sizeof(sphere_t));
+            *s          = sphere();
+            shape_set_transform(s, transform_translation(0, 0, i * 3));
+            group_add_child(g, s);
+            nearest = s;
+        }
+
+        ray_t r            = ray(point(0, 0, -5), vector(0, 0, 1));
+        intersections_t xs = empty_intersections();
+        group_intersect(g, r, &xs);
+        assert(xs.count == 2 * (INTERSECTIONS_INITIAL_CAPACITY + 1));
+        assert(equal(xs.intersections[0].t, 4));
+        assert(xs.intersections[0].object == nearest);
+        for (int i = 1; i < xs.count; i++)
+        {
+            assert(xs.intersections[i - 1].t <= xs.intersections[i].t);
+        }
+
+        intersections_free(&xs);
+        group_free(g);
+    }
 }
 
 int main(void)
@@ -0,0 +1,96 @@
+// test_hot_path.c
+
+#include "../include/camera.h"
+#include "../include/hot_path.h"
+#include "../include/transformations.h"
+#include "../include/world.h"
+#include <assert.h>
+#include <omp.h>
+#include <stdlib.h>
+
+// Glass and solid spheres in a divided group, plus an instance of it, so a
+// render crosses nested BVH nodes, instancing, refraction and shadows.
+static world_t hot_path_world(group_t **mesh)
+{
+    world_t w = world();
+    world_add_light(&w, lights_point_light(point(-10, 10, -10), WHITE));
+    world_add_shape(&w, plane());
+
+    *mesh = group();
+    for (int i = 0; i < 12; i++)
+    {
+        sphere_t *s = malloc(sizeof(sphere_t));
+        *s          = i % 3 == 0 ? glass_sphere() : sphere();
+        shape_set_transform(
+            s, matrix_mul(transform_translation(i % 4 - 1.5, 0.5, i / 4),
+                          transform_scaling(0.4, 0.4, 0.4)));
+        group_add_child(*mesh, s);
+    }
+    divide((shape_t *)*mesh, 2);
+
+    instance_t copy = instance((shape_t *)*mesh);
+    shape_set_transform((shape_t *)&copy, transform_translation(0, 1.2, 1));
+    world_add_instance(&w, copy);
+
+    return w;
+}
+
+void test_hot_path(void)
+{
+    { // Warming the bounds fills every group's cache before a render
+        group_t *mesh = NULL;
+        world_t w     = hot_path_world(&mesh);
+        group_t *node = mesh;
+        while (node->child_count > 0 &&
+               node->children[0]->type == SHAPE_GROUP)
+        {
+            node = (group_t *)node->children[0];
+        }
+        group_invalidate_bounds_cache(node);
+        assert(!node->bounds_cached && !mesh->bounds_cached);
+
+        world_warm_bounds(&w);
+        assert(node->bounds_cached && mesh->bounds_cached);
+
+        world_free(&w);
+        group_free(mesh);
+    }
+
+    { // Rendering on several threads neither allocates nor changes results
+        group_t *mesh = NULL;
+        world_t w     = hot_path_world(&mesh);
+        camera_t c    = camera(48, 32, M_PI_3);
+        camera_set_transform(&c, transform_view(point(0, 3, -5),
+                                                point(0, 0.5, 1),
+                                                vector(0, 1, 0)));
+
+        omp_set_num_threads(1);
+        canvas_t *expected = camera_render(&c, &w);
+        assert(hot_path_allocations() == 0);
+
+        omp_set_num_threads(4);
+        canvas_t *image = camera_render(&c, &w);
+        assert(hot_path_allocations() == 0);
+
+        camera_set_antialiasing(&c, 8, 0.05);
+        canvas_t *smooth = camera_render(&c, &w);
+        assert(hot_path_allocations() == 0);
+
+        for (unsigned i = 0; i < c.hsize * c.vsize; i++)
+        {
+            assert(tuple_equal(image->pixels[i], expected->pixels[i]));
+        }
+
+        canvas_free(smooth);
+        canvas_free(image);
+        canvas_free(expected);
+        world_free(&w);
+        group_free(mesh);
+    }
+}
+
+int main(void)
+{
+    test_hot_path();
+    return 0;
+}
@@ -0,0 +1,150 @@
+// test_instances.c
+
+#include "../include/shapes.h"
+#include "../include/transformations.h"
+#include "../include/world.h"
+#include <assert.h>
+#include <stdlib.h>
+
+static group_t *sphere_mesh(void)
+{
+    group_t *mesh = group();
+    sphere_t *s   = malloc(sizeof(sphere_t));
+    *s            = sphere();
+    group_add_child(mesh, (shape_t *)s);
+    return mesh;
+}
+
+void test_instances(void)
+{
+    { // Creating an instance leaves the shared mesh untouched
+        group_t *mesh = sphere_mesh();
+        instance_t a  = instance((shape_t *)mesh);
+        instance_t b  = instance((shape_t *)mesh);
+        shape_set_transform((shape_t *)&b, transform_translation(5, 0, 0));
+
+        assert(a.type == SHAPE_INSTANCE);
+        assert(a.mesh == (shape_t *)mesh && b.mesh == (shape_t *)mesh);
+        assert(mesh->parent == NULL);
+        assert(tuple_equal(b.world_bounds.min, point(4, -1, -1)));
+        assert(tuple_equal(b.world_bounds.max, point(6, 1, 1)));
+
+        group_free(mesh);
+    }
+
+    { // Intersecting a ray with an instance records the instance
+        group_t *mesh = sphere_mesh();
+        instance_t i  = instance((shape_t *)mesh);
+        shape_set_transform((shape_t *)&i, transform_translation(5, 0, 0));
+
+        ray_t r            = ray(point(5, 0, -5), vector(0, 0, 1));
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&i, r, &xs);
+        assert(xs.count == 2);
+        assert(equal(xs.intersections[0].t, 4));
+        assert(equal(xs.intersections[1].t, 6));
+        assert(xs.intersections[0].object == mesh->children[0]);
+        assert(xs.intersections[0].instance == &i);
+
+        r        = ray(point(0, 0, -5), vector(0, 0, 1));
+        xs.count = 0;
+        shape_intersect((shape_t *)&i, r, &xs);
+        assert(xs.count == 0);
+
+        intersections_free(&xs);
+        group_free(mesh);
+    }
+
+    { // The normal on an instance is in the instance's space
+        group_t *mesh = sphere_mesh();
+        instance_t i  = instance((shape_t *)mesh);
+        shape_set_transform((shape_t *)&i,
+                            matrix_mul(transform_translation(5, 0, 0),
+                                       transform_scaling(1, 2, 1)));
+
+        ray_t r            = ray(point(5, 10, 0), vector(0, -1, 0));
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)&i, r, &xs);
+        assert(xs.count == 2);
+
+        computations_t comps =
+            intersections_prepare_computations(&xs.intersections[0], &r, &xs);
+        assert(tuple_equal(comps.point, point(5, 2, 0)));
+        assert(tuple_equal(comps.normalv, vector(0, 1, 0)));
+        assert(comps.object == mesh->children[0]);
+
+        intersections_free(&xs);
+        group_free(mesh);
+    }
+
+    { // Refractive indices tell apart instances hit at the same distance
+        group_t *mesh = sphere_mesh();
+        shape_t *s    = mesh->children[0];
+
+        instance_t a = instance((shape_t *)mesh);
+        instance_t b = instance((shape_t *)mesh);
+        material_t m = material();
+        m.refractive_index = 1.5;
+        instance_set_material(&a, m);
+        m.refractive_index = 2.0;
+        instance_set_material(&b, m);
+
+        intersection_t ia = intersection(1.0, s);
+        intersection_t ib = intersection(1.0, s);
+        ia.instance       = &a;
+        ib.instance       = &b;
+        intersections_t xs = intersections(2, ia, ib);
+
+        double n1, n2;
+        intersections_refractive_indices(&xs.intersections[1], &xs, &n1, &n2);
+        assert(equal(n1, 1.5));
+        assert(equal(n2, 2.0));
+
+        intersections_free(&xs);
+        group_free(mesh);
+    }
+
+    { // An instance can override the material of its mesh
+        group_t *mesh = sphere_mesh();
+
+        material_t m = material();
+        m.color      = color(0.2, 0.4, 0.9);
+        m.ambient    = 1.0;
+        m.diffuse    = 0.0;
+        m.specular   = 0.0;
+        instance_t a = instance((shape_t *)mesh);
+        instance_t b = instance((shape_t *)mesh);
+        shape_set_transform((shape_t *)&b, transform_translation(0, 0, 10));
+        instance_set_material(&b, m);
+
+        world_t w = world();
+        world_add_light(&w,
+                        lights_point_light(point(-10, 10, -10), WHITE));
+        world_add_instance(&w, a);
+        world_add_instance(&w, b);
+
+        ray_t r   = ray(point(0, 0, 20), vector(0, 0, -1));
+        tuple_t c = world_color_at(&w, &r, MAX_RECURSION);
+        assert(tuple_equal(c, color(0.2, 0.4, 0.9)));
+
+        // Without an override the mesh's own material is used.
+        world_t plain = world();
+        world_add_light(&plain,
+                        lights_point_light(point(-10, 10, -10), WHITE));
+        world_add_shape(&plain, sphere());
+
+        r = ray(point(0, 0, -5), vector(0, 0, 1));
+        c = world_color_at(&w, &r, MAX_RECURSION);
+        assert(tuple_equal(c, world_color_at(&plain, &r, MAX_RECURSION)));
+
+        world_free(&plain);
+        world_free(&w);
+        group_free(mesh);
+    }
+}
+
+int main(void)
+{
+    test_instances();
+    return 0;
+}
@@ -20,13 +20,16 @@ void test_intersections(void)
         ray_t r    = ray(point(0, 0, -5), vector(0, 0, 1));
         sphere_t s = sphere();
 
-        intersections_t xs = sphere_intersect(&s, r);
+        intersections_t xs = empty_intersections();
+        sphere_intersect(&s, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 4.0));
         assert(equal(xs.intersections[1].t, 6.0));
         assert(xs.intersections[0].object == &s);
         assert(xs.intersections[1].object == &s);
+
+        intersections_free(&xs);
     }
 
     { // Aggregating intersections
@@ -39,6 +42,8 @@ void test_intersections(void)
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 1.0));
         assert(equal(xs.intersections[1].t, 2.0));
+
+        intersections_free(&xs);
     }
 
     { // The hit, when all intersections have positive t
@@ -51,6 +56,8 @@ void test_intersections(void)
 
         assert(equal(i->t, xs.intersections[1].t));
         assert(i->object == xs.intersections[1].object);
+
+        intersections_free(&xs);
     }
 
     { // The hit, when some intersections have negative t
@@ -63,6 +70,8 @@ void test_intersections(void)
 
         assert(equal(i->t, xs.intersections[0].t));
         assert(i->object == xs.intersections[0].object);
+
+        intersections_free(&xs);
     }
 
     { // The hit, when all intersections have negative t
@@ -74,6 +83,8 @@ void test_intersections(void)
         intersection_t *i = intersections_hit(&xs);
 
         assert(i == NULL);
+
+        intersections_free(&xs);
     }
 
     { // The hit is always the lowest non-negative intersection
@@ -88,6 +99,8 @@ void test_intersections(void)
 
         assert(equal(i->t, xs.intersections[3].t));
         assert(i->object == xs.intersections[3].object);
+
+        intersections_free(&xs);
     }
 
     { // Precomputing the state of an intersection
@@ -145,6 +158,35 @@ void test_intersections(void)
             tuple_equal(comps.reflectv, vector(0, sqrt(2) / 2, sqrt(2) / 2)));
     }
 
+    { // Containers past the tracked limit take the innermost tracked index
+        enum
+        {
+            NESTED = MAX_REFRACTION_CONTAINERS + 8
+        };
+        sphere_t spheres[NESTED];
+        intersections_t xs = empty_intersections();
+        for (int i = 0; i < NESTED; i++)
+        {
+            spheres[i]                           = glass_sphere();
+            spheres[i].material.refractive_index = 1.0 + (i + 1) * 0.01;
+            intersections_add(&xs, intersection(i + 1.0, &spheres[i]));
+        }
+
+        double n1, n2;
+        int last = MAX_REFRACTION_CONTAINERS - 1;
+        intersections_refractive_indices(&xs.intersections[last], &xs, &n1,
+                                         &n2);
+        assert(equal(n1, spheres[last - 1].material.refractive_index));
+        assert(equal(n2, spheres[last].material.refractive_index));
+
+        intersections_refractive_indices(&xs.intersections[NESTED - 1], &xs,
+                                         &n1, &n2);
+        assert(equal(n1, spheres[last].material.refractive_index));
+        assert(equal(n2, spheres[last].material.refractive_index));
+
+        intersections_free(&xs);
+    }
+
     { // Finding n1 and n2 at various intersections
 
         sphere_t A = glass_sphere();
@@ -201,6 +243,35 @@ void test_intersections(void)
             intersections_prepare_computations(&xs.intersections[5], &r, &xs);
         assert(equal(comps.n1, 1.5));
         assert(equal(comps.n2, 1.0));
+
+        intersections_free(&xs);
+    }
+
+    { // n1 and n2 are left at 1.0 for an opaque hit inside glass
+        sphere_t A = glass_sphere();
+        sphere_set_transform(&A, transform_scaling(2, 2, 2));
+
+        sphere_t B = sphere();
+
+        ray_t r = ray(point(0, 0, -4), vector(0, 0, 1));
+
+        intersection_t i1  = intersection(2.0, &A);
+        intersection_t i2  = intersection(3.0, &B);
+        intersection_t i3  = intersection(5.0, &B);
+        intersection_t i4  = intersection(6.0, &A);
+        intersections_t xs = intersections(4, i1, i2, i3, i4);
+
+        computations_t comps =
+            intersections_prepare_computations(&xs.intersections[1], &r, &xs);
+        assert(equal(comps.n1, 1.0));
+        assert(equal(comps.n2, 1.0));
+
+        double n1, n2;
+        intersections_refractive_indices(&xs.intersections[1], &xs, &n1, &n2);
+        assert(equal(n1, 1.5));
+        assert(equal(n2, 1.0));
+
+        intersections_free(&xs);
     }
 
     { // The under point is offset below the surface
@@ -212,6 +283,8 @@ void test_intersections(void)
         computations_t comps = intersections_prepare_computations(&i, &r, &xs);
         assert(comps.under_point.z > EPSILON / 2);
         assert(comps.point.z < comps.under_point.z);
+
+        intersections_free(&xs);
     }
 
     { // The Schlick approximation under total internal reflection
@@ -224,6 +297,8 @@ void test_intersections(void)
             intersections_prepare_computations(&xs.intersections[1], &r, &xs);
         double reflectance = intersections_shlick(&comps);
         assert(equal(reflectance, 1.0));
+
+        intersections_free(&xs);
     }
 
     { // The Schlick approximation with a perpendicular viewing angle
@@ -236,6 +311,8 @@ void test_intersections(void)
             intersections_prepare_computations(&xs.intersections[1], &r, &xs);
         double reflectance = intersections_shlick(&comps);
         assert(equal(reflectance, 0.04));
+
+        intersections_free(&xs);
     }
 
     { // An intersection can encapsulate u and v
@@ -246,6 +323,62 @@ void test_intersections(void)
         assert(equal(i.u, 0.2));
         assert(equal(i.v, 0.4));
     }
+
+    { // Sorting a list too long for insertion sort
+        sphere_t s         = sphere();
+        intersections_t xs = empty_intersections();
+        for (int i = 0; i < 50; i++)
+        {
+            intersections_add(&xs, intersection((i * 37) % 50 - 10.0, &s));
+        }
+
+        intersections_sort(&xs);
+
+        for (int i = 0; i < xs.count; i++)
+        {
+            assert(equal(xs.intersections[i].t, i - 10.0));
+        }
+
+        intersections_free(&xs);
+    }
+
+    { // A list grows past its initial capacity and keeps every entry
+        sphere_t s         = sphere();
+        intersections_t xs = empty_intersections();
+        int n              = 2 * INTERSECTIONS_INITIAL_CAPACITY + 1;
+        for (int i = 0; i < n; i++)
+        {
+            intersections_add(&xs, intersection(i, &s));
+        }
+
+        assert(xs.count == n);
+        assert(xs.capacity >= n);
+        for (int i = 0; i < n; i++)
+        {
+            assert(equal(xs.intersections[i].t, i));
+        }
+
+        intersections_free(&xs);
+        assert(xs.count == 0 && xs.capacity == 0 && !xs.intersections);
+    }
+
+    { // Each recursion level has its own scratch list, cleared on request
+        sphere_t s = sphere();
+        intersections_scratch_reserve();
+
+        intersections_t *top    = intersections_scratch(MAX_RECURSION);
+        intersections_t *next   = intersections_scratch(MAX_RECURSION - 1);
+        intersections_t *shadow =
+            intersections_scratch(INTERSECTIONS_SHADOW_SCRATCH);
+        assert(top != next && top != shadow && next != shadow);
+        assert(top->capacity >= INTERSECTIONS_INITIAL_CAPACITY);
+
+        intersections_add(top, intersection(1, &s));
+        assert(intersections_scratch(MAX_RECURSION - 1)->count == 0);
+        assert(top->count == 1);
+        assert(intersections_scratch(MAX_RECURSION) == top);
+        assert(top->count == 0);
+    }
 }
 
 int main(void)
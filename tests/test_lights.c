@@ -141,6 +141,7 @@ void test_lights(void)
 
         tuple_t pt5 = lights_point_on_light(&light, 3, 1);
         assert(tuple_equal(pt5, point(1.65, 0, 0.85)));
+        sequence_free(&light.jitter_by);
     }
 
     { // The area light with jittered samples
@@ -157,25 +158,118 @@ void test_lights(void)
         double intensity1 = lights_intensity_at(&light, pt1, &w);
         assert(equal(intensity1, 0.0));
 
+        sequence_free(&light.jitter_by);
         light.jitter_by   = sequence_from_array(jitter_values, 5);
         tuple_t pt2       = point(1, -1, 2);
         double intensity2 = lights_intensity_at(&light, pt2, &w);
         assert(equal(intensity2, 0.5));
 
+        sequence_free(&light.jitter_by);
         light.jitter_by   = sequence_from_array(jitter_values, 5);
         tuple_t pt3       = point(1.5, 0, 2);
         double intensity3 = lights_intensity_at(&light, pt3, &w);
         assert(equal(intensity3, 0.75));
 
+        sequence_free(&light.jitter_by);
         light.jitter_by   = sequence_from_array(jitter_values, 5);
         tuple_t pt4       = point(1.25, 1.25, 3);
         double intensity4 = lights_intensity_at(&light, pt4, &w);
         assert(equal(intensity4, 0.75));
 
+        sequence_free(&light.jitter_by);
         light.jitter_by   = sequence_from_array(jitter_values, 5);
         tuple_t pt5       = point(0, 0, -2);
         double intensity5 = lights_intensity_at(&light, pt5, &w);
         assert(equal(intensity5, 1.0));
+        sequence_free(&light.jitter_by);
+        world_free(&w);
+    }
+
+    { // A sample table holds every position on the light, u fastest
+        tuple_t corner = point(0, 0, 0);
+        light_t light  = lights_area_light(corner, vector(2, 0, 0), 4,
+                                           vector(0, 0, 1), 2, color(1, 1, 1));
+        assert(light.sample_x == NULL);
+        assert(lights_prepare_samples(&light));
+        assert(light.sample_x != NULL);
+
+        for (int v = 0; v < light.vsteps; v++)
+        {
+            for (int u = 0; u < light.usteps; u++)
+            {
+                int i        = v * light.usteps + u;
+                tuple_t want = lights_point_on_light(&light, u, v);
+                assert(equal(light.sample_x[i], want.x));
+                assert(equal(light.sample_y[i], want.y));
+                assert(equal(light.sample_z[i], want.z));
+            }
+        }
+
+        lights_free_samples(&light);
+        assert(light.sample_x == NULL && light.sample_z == NULL);
+    }
+
+    { // Stratified jitter keeps one sample per cell and differs per pixel
+        light_t light = lights_area_light(point(0, 0, 0), vector(2, 0, 0), 4,
+                                          vector(0, 0, 1), 2, color(1, 1, 1));
+        light_t bulb  = lights_point_light(point(0, 0, 0), color(1, 1, 1));
+        assert(!lights_set_stratified_jitter(&bulb, 4, 1));
+        assert(lights_set_stratified_jitter(&light, 16, 1));
+
+        for (unsigned px = 0; px < 8; px++)
+        {
+            lights_select_pixel(px, 0);
+            for (int v = 0; v < light.vsteps; v++)
+            {
+                for (int u = 0; u < light.usteps; u++)
+                {
+                    tuple_t p = lights_point_on_light(&light, u, v);
+                    assert(p.x >= u * 0.5 && p.x < (u + 1) * 0.5);
+                    assert(p.z >= v * 0.5 && p.z < (v + 1) * 0.5);
+                }
+            }
+        }
+
+        lights_select_pixel(0, 0);
+        int first     = lights_sample_offset(&light);
+        tuple_t where = lights_point_on_light(&light, 0, 0);
+        lights_select_pixel(1, 0);
+        assert(lights_sample_offset(&light) != first);
+        assert(lights_sample_offset(&light) % light.samples == 0);
+        assert(!tuple_equal(lights_point_on_light(&light, 0, 0), where));
+    }
+
+    { // Shadow rays through a sample table see the pixel's own pattern
+        world_t w      = world_default();
+        tuple_t corner = point(-0.5, -0.5, -5);
+        light_t light  = lights_area_light(corner, vector(1, 0, 0), 3,
+                                           vector(0, 1, 0), 3, color(1, 1, 1));
+        assert(lights_set_stratified_jitter(&light, 8, 5));
+        tuple_t points[4] = {point(1, -1, 2), point(1.5, 0, 2),
+                             point(1.25, 1.25, 3), point(0, 0, -2)};
+
+        double expected[6][4];
+        for (unsigned px = 0; px < 6; px++)
+        {
+            lights_select_pixel(px, 2);
+            for (int i = 0; i < 4; i++)
+            {
+                expected[px][i] = lights_intensity_at(&light, points[i], &w);
+            }
+        }
+
+        assert(lights_prepare_samples(&light));
+        for (unsigned px = 0; px < 6; px++)
+        {
+            lights_select_pixel(px, 2);
+            for (int i = 0; i < 4; i++)
+            {
+                assert(equal(lights_intensity_at(&light, points[i], &w),
+                             expected[px][i]));
+            }
+        }
+
+        lights_free_samples(&light);
         world_free(&w);
     }
 }
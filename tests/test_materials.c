@@ -195,6 +195,38 @@ void test_materials(void)
                                             eyev, normalv, 1.0);
         assert(tuple_equal(result, color(0.6232, 0.6232, 0.6232)));
     }
+
+    { // The polynomial pow() follows the C library's over the shininess range
+        for (int i = 1; i <= 100; i++)
+        {
+            double x = i / 100.0;
+            for (double y = 1; y <= 400; y *= 1.7)
+            {
+                double expected = pow(x, y);
+                assert(fabs(materials_pow(x, y) - expected) <=
+                       1e-7 * expected + 1e-300);
+            }
+        }
+        assert(equal(materials_pow(0, 10), 0));
+    }
+
+    { // Lighting from an area light's sample table matches sampling it
+        tuple_t corner  = point(-0.5, -0.5, -5);
+        light_t light   = lights_area_light(corner, vector(1, 0, 0), 3,
+                                            vector(0, 1, 0), 3, color(1, 1, 1));
+        sphere_t shape  = sphere();
+        tuple_t pt      = point(0, 0.2, -0.98);
+        tuple_t eyev    = tuple_normalize(tuple_subtract(point(0, 0, -5), pt));
+        tuple_t normalv = vector(pt.x, pt.y, pt.z);
+
+        tuple_t expected = materials_lighting(&shape.material, &shape, &light,
+                                              pt, eyev, normalv, 1.0);
+        assert(lights_prepare_samples(&light));
+        tuple_t result = materials_lighting(&shape.material, &shape, &light,
+                                            pt, eyev, normalv, 1.0);
+        assert(tuple_equal(result, expected));
+        lights_free_samples(&light);
+    }
 }
 
 int main(void)
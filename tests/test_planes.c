@@ -23,38 +23,50 @@ void test_planes(void)
         plane_t p = plane();
         ray_t r   = ray(point(0, 10, 0), vector(0, 0, 1));
 
-        intersections_t xs = plane_intersect(&p, r);
+        intersections_t xs = empty_intersections();
+        plane_intersect(&p, r, &xs);
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // Intersect with a coplanar ray
         plane_t p = plane();
         ray_t r   = ray(point(0, 0, 0), vector(0, 0, 1));
 
-        intersections_t xs = plane_intersect(&p, r);
+        intersections_t xs = empty_intersections();
+        plane_intersect(&p, r, &xs);
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // A ray intersecting a plane from above
         plane_t p = plane();
         ray_t r   = ray(point(0, 1, 0), vector(0, -1, 0));
 
-        intersections_t xs = plane_intersect(&p, r);
+        intersections_t xs = empty_intersections();
+        plane_intersect(&p, r, &xs);
 
         assert(xs.count == 1);
         assert(equal(xs.intersections[0].t, 1.0));
         assert(xs.intersections[0].object == &p);
+
+        intersections_free(&xs);
     }
 
     { // A ray intersecting a plane from below
         plane_t p = plane();
         ray_t r   = ray(point(0, -1, 0), vector(0, 1, 0));
 
-        intersections_t xs = plane_intersect(&p, r);
+        intersections_t xs = empty_intersections();
+        plane_intersect(&p, r, &xs);
 
         assert(xs.count == 1);
         assert(equal(xs.intersections[0].t, 1.0));
         assert(xs.intersections[0].object == &p);
+
+        intersections_free(&xs);
     }
 }
 
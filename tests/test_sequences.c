@@ -3,6 +3,7 @@
 #include "../include/sequences.h"
 #include "../include/tuples.h"
 #include <assert.h>
+#include <math.h>
 #include <stdio.h>
 
 void test_sequences(void)
@@ -17,6 +18,7 @@ void test_sequences(void)
         assert(equal(sequence_next(&gen), 0.5));
         assert(equal(sequence_next(&gen), 1.0));
         assert(equal(sequence_next(&gen), 0.1));
+        sequence_free(&gen);
     }
 
     { // Creating a sequence from an array
@@ -27,6 +29,54 @@ void test_sequences(void)
         assert(equal(sequence_next(&seq), 0.7));
         assert(equal(sequence_next(&seq), 0.9));
         assert(equal(sequence_next(&seq), 0.3));
+        sequence_free(&seq);
+    }
+
+    { // Sequences keep every value added, however many there are
+        sequence_t seq = sequence_new();
+        for (int i = 0; i < 1000; i++)
+        {
+            sequence_add(&seq, i / 1000.0);
+        }
+        assert(seq.count == 1000);
+        assert(equal(sequence_at(&seq, 999), 0.999));
+        assert(equal(sequence_at(&seq, 1000), 0.0));
+
+        sequence_t copy = sequence_copy(&seq);
+        sequence_free(&seq);
+        assert(seq.values == NULL && seq.count == 0);
+        assert(copy.count == 1000);
+        assert(equal(sequence_at(&copy, 500), 0.5));
+        sequence_free(&copy);
+    }
+
+    { // Hashed jitter is repeatable, in range and depends on the seed
+        double sum = 0.0;
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            double value = sequence_hash(7, i);
+            assert(value >= 0.0 && value < 1.0);
+            assert(equal(value, sequence_hash(7, i)));
+            sum += value;
+        }
+        assert(fabs(sum / 1000 - 0.5) < 0.05);
+        assert(!equal(sequence_hash(7, 0), sequence_hash(8, 0)));
+    }
+
+    { // Neighbouring pixels get well separated dither values
+        for (unsigned y = 0; y < 16; y++)
+        {
+            for (unsigned x = 0; x < 16; x++)
+            {
+                double value = sequence_pixel_dither(x, y);
+                assert(value >= 0.0 && value < 1.0);
+
+                double right = fabs(value - sequence_pixel_dither(x + 1, y));
+                double below = fabs(value - sequence_pixel_dither(x, y + 1));
+                assert(fmin(right, 1.0 - right) > 0.2);
+                assert(fmin(below, 1.0 - below) > 0.2);
+            }
+        }
     }
 }
 
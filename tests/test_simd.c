@@ -0,0 +1,108 @@
+// test_simd.c
+
+#include "../include/bounds.h"
+#include "../include/canvas.h"
+#include "../include/materials.h"
+#include "../include/shapes.h"
+#include "../include/simd.h"
+#include "../include/transformations.h"
+#include <assert.h>
+#include <string.h>
+
+void test_simd(void)
+{
+    { // Detection never selects an instruction set the CPU lacks
+        simd_isa_t best = simd_detect_isa();
+        assert(best < SIMD_ISA_COUNT);
+        assert(simd_active_isa <= best);
+        assert(!simd_set_isa(SIMD_ISA_COUNT));
+        assert(strcmp(simd_isa_name(SIMD_ISA_GENERIC), "generic") == 0);
+    }
+
+    { // Every supported variant computes the same results
+        simd_isa_t best = simd_detect_isa();
+
+        matrix_t a = matrix_mul(transform_translation(1, 2, 3),
+                                transform_rotation_y(0.7));
+        matrix_t b = transform_scaling(2, -1, 0.5);
+
+        sphere_t s   = sphere();
+        triangle_t t = triangle(point(0, 1, 0), point(-1, 0, 0),
+                                point(1, 0, 0));
+        ray_t r      = ray(point(0.1, 0.2, -5), vector(0, 0, 1));
+        bounding_box_t box =
+            bounding_box(point(-1, -1, -1), point(1, 1, 1));
+        tuple_t pixels[3] = {color(0, 0.5, 1), color(-1, 2, 0.25),
+                             color(0.001, 0.999, 0.4)};
+
+        simd_set_isa(SIMD_ISA_GENERIC);
+        matrix_t expected_m      = matrix_mul(a, b);
+        intersections_t sphere_x = empty_intersections();
+        intersections_t tri_x    = empty_intersections();
+        sphere_intersect(&s, r, &sphere_x);
+        triangle_intersect(&t, r, &tri_x);
+        bool expected_hit = bounds_intersects(box, r);
+        unsigned char expected_rgb[9];
+        assert(canvas_quantize(pixels, 3, expected_rgb) == 9);
+        assert(expected_rgb[1] == 128 && expected_rgb[3] == 0);
+        assert(expected_rgb[4] == 255);
+
+        double sample_x[5]       = {-1, 0, 1, 2, 0.5};
+        double sample_y[5]       = {3, 4, 2, -1, 5};
+        double sample_z[5]       = {-5, -4, -6, -5, -3};
+        tuple_t eyev             = tuple_normalize(vector(0.1, 0.3, -1));
+        tuple_t normalv          = tuple_normalize(vector(0, 1, -1));
+        double expected_pow      = materials_pow(0.8, 200);
+        double expected_diffuse  = 0;
+        double expected_specular = 0;
+        materials_phong_samples(sample_x, sample_y, sample_z, 5,
+                                point(0, 0, 0), eyev, normalv, 50,
+                                &expected_diffuse, &expected_specular);
+        assert(expected_diffuse > 0 && expected_specular > 0);
+
+        for (int isa = SIMD_ISA_SSE42; isa <= (int)best; isa++)
+        {
+            assert(simd_set_isa((simd_isa_t)isa));
+
+            assert(matrix_equal(matrix_mul(a, b), expected_m));
+
+            intersections_t xs = empty_intersections();
+            sphere_intersect(&s, r, &xs);
+            assert(xs.count == sphere_x.count);
+            assert(equal(xs.intersections[0].t, sphere_x.intersections[0].t));
+
+            xs.count = 0;
+            triangle_intersect(&t, r, &xs);
+            assert(xs.count == tri_x.count);
+            assert(equal(xs.intersections[0].t, tri_x.intersections[0].t));
+            assert(equal(xs.intersections[0].u, tri_x.intersections[0].u));
+
+            assert(bounds_intersects(box, r) == expected_hit);
+
+            unsigned char rgb[9];
+            canvas_quantize(pixels, 3, rgb);
+            assert(memcmp(rgb, expected_rgb, sizeof(rgb)) == 0);
+
+            assert(equal(materials_pow(0.8, 200), expected_pow));
+            double diffuse = 0, specular = 0;
+            materials_phong_samples(sample_x, sample_y, sample_z, 5,
+                                    point(0, 0, 0), eyev, normalv, 50,
+                                    &diffuse, &specular);
+            assert(equal(diffuse, expected_diffuse));
+            assert(equal(specular, expected_specular));
+
+            intersections_free(&xs);
+        }
+
+        simd_set_isa(best);
+
+        intersections_free(&sphere_x);
+        intersections_free(&tri_x);
+    }
+}
+
+int main(void)
+{
+    test_simd();
+    return 0;
+}
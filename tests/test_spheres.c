@@ -13,11 +13,14 @@ void test_spheres(void)
         ray_t r           = ray(origin, direction);
 
         sphere_t s         = sphere();
-        intersections_t xs = sphere_intersect(&s, r);
+        intersections_t xs = empty_intersections();
+        sphere_intersect(&s, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 4.0));
         assert(equal(xs.intersections[1].t, 6.0));
+
+        intersections_free(&xs);
     }
 
     { // A ray intersects a sphere at a tangent
@@ -26,11 +29,14 @@ void test_spheres(void)
         ray_t r           = ray(origin, direction);
 
         sphere_t s         = sphere();
-        intersections_t xs = sphere_intersect(&s, r);
+        intersections_t xs = empty_intersections();
+        sphere_intersect(&s, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 5.0));
         assert(equal(xs.intersections[1].t, 5.0));
+
+        intersections_free(&xs);
     }
 
     { // A ray misses a sphere
@@ -39,9 +45,12 @@ void test_spheres(void)
         ray_t r           = ray(origin, direction);
 
         sphere_t s         = sphere();
-        intersections_t xs = sphere_intersect(&s, r);
+        intersections_t xs = empty_intersections();
+        sphere_intersect(&s, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // A ray originates inside a sphere
@@ -50,11 +59,14 @@ void test_spheres(void)
         ray_t r           = ray(origin, direction);
 
         sphere_t s         = sphere();
-        intersections_t xs = sphere_intersect(&s, r);
+        intersections_t xs = empty_intersections();
+        sphere_intersect(&s, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, -1.0));
         assert(equal(xs.intersections[1].t, 1.0));
+
+        intersections_free(&xs);
     }
 
     { // A sphere is behind a ray
@@ -63,11 +75,14 @@ void test_spheres(void)
         ray_t r           = ray(origin, direction);
 
         sphere_t s         = sphere();
-        intersections_t xs = sphere_intersect(&s, r);
+        intersections_t xs = empty_intersections();
+        sphere_intersect(&s, r, &xs);
 
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, -6.0));
         assert(equal(xs.intersections[1].t, -4.0));
+
+        intersections_free(&xs);
     }
 
     { // A sphere's default transformation
@@ -87,10 +102,13 @@ void test_spheres(void)
         sphere_t s = sphere();
         shape_set_transform(&s, transform_scaling(2, 2, 2));
 
-        intersections_t xs = shape_intersect(&s, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&s, r, &xs);
         assert(xs.count == 2);
         assert(equal(xs.intersections[0].t, 3.0));
         assert(equal(xs.intersections[1].t, 7.0));
+
+        intersections_free(&xs);
     }
 
     { // Intersecting a translated sphere with a ray
@@ -98,8 +116,11 @@ void test_spheres(void)
         sphere_t s = sphere();
         sphere_set_transform(&s, transform_translation(5, 0, 0));
 
-        intersections_t xs = shape_intersect(&s, r);
+        intersections_t xs = empty_intersections();
+        shape_intersect(&s, r, &xs);
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // Computing the normal on a sphere
@@ -0,0 +1,178 @@
+// test_stats.c
+
+#include "../include/camera.h"
+#include "../include/checkpoint.h"
+#include "../include/stats.h"
+#include "../include/transformations.h"
+#include "../include/world.h"
+#include <assert.h>
+#include <omp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Counts one camera ray and returns the slot it was counted in.
+static void *stats_count_camera_ray(void *arg)
+{
+    (void)arg;
+    STATS_ADD(STAT_CAMERA_RAYS, 1);
+#ifdef RT_STATS
+    return stats_thread_slot;
+#else
+    return NULL;
+#endif
+}
+
+void test_stats(void)
+{
+    { // Statistics are written as a flat JSON object
+        stats_t s;
+        memset(&s, 0, sizeof(s));
+        s.counts[STAT_CAMERA_RAYS]        = 12;
+        s.counts[STAT_HIT_BUFFER_GROWTHS] = 3;
+
+        char buffer[512] = {0};
+        FILE *file       = fmemopen(buffer, sizeof(buffer) - 1, "w");
+        stats_write_json(&s, file);
+        fclose(file);
+
+        assert(strcmp(buffer, "{\"camera_rays\": 12, \"shadow_rays\": 0, "
+                              "\"scene_rays\": 0, \"bounds_tests\": 0, "
+                              "\"node_visits\": 0, \"primitive_tests\": 0, "
+                              "\"hit_buffer_growths\": 3}\n") == 0);
+        assert(strcmp(stats_name(STAT_NODE_VISITS), "node_visits") == 0);
+    }
+
+    { // Counts from every thread are summed
+        stats_reset();
+
+#pragma omp parallel for num_threads(4)
+        for (int i = 0; i < 1000; i++)
+        {
+            STATS_ADD(STAT_PRIMITIVE_TESTS, 2);
+        }
+
+        stats_t s = stats_collect();
+        assert(s.counts[STAT_PRIMITIVE_TESTS] ==
+               (stats_enabled() ? 2000u : 0u));
+    }
+
+    { // Exited threads hand their slots on, so every thread is counted
+        stats_reset();
+
+        unsigned threads = STATS_MAX_THREADS + 44;
+        void *first_slot = NULL;
+        for (unsigned i = 0; i < threads; i++)
+        {
+            pthread_t thread;
+            void *slot;
+            assert(pthread_create(&thread, NULL, stats_count_camera_ray,
+                                  NULL) == 0);
+            assert(pthread_join(thread, &slot) == 0);
+            if (i == 0)
+            {
+                first_slot = slot;
+            }
+            assert(slot == first_slot);
+        }
+
+        stats_t s = stats_collect();
+        assert(s.counts[STAT_CAMERA_RAYS] == (stats_enabled() ? threads : 0u));
+    }
+
+    { // A render counts its camera, scene and shadow rays
+        world_t w  = world_default();
+        camera_t c = camera(11, 11, M_PI_2);
+        camera_set_transform(&c, transform_view(point(0, 0, -5),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+
+        canvas_t *image = camera_render(&c, &w);
+        stats_t s       = stats_collect();
+
+        if (stats_enabled())
+        {
+            assert(s.counts[STAT_CAMERA_RAYS] == 121);
+            // Nothing in the default world reflects or refracts, so the
+            // only scene rays are the camera rays; shadow rays are apart.
+            assert(s.counts[STAT_SCENE_RAYS] == s.counts[STAT_CAMERA_RAYS]);
+            assert(s.counts[STAT_SHADOW_RAYS] > 0);
+            assert(s.counts[STAT_PRIMITIVE_TESTS] > 0);
+            assert(s.counts[STAT_BOUNDS_TESTS] >=
+                   s.counts[STAT_PRIMITIVE_TESTS]);
+        }
+        else
+        {
+            for (int i = 0; i < STAT_COUNT; i++)
+            {
+                assert(s.counts[i] == 0);
+            }
+        }
+
+        canvas_free(image);
+        world_free(&w);
+    }
+
+    { // Anti-aliasing traces each shared corner and edge midpoint once
+        world_t w  = world_default();
+        camera_t c = camera(11, 11, M_PI_2);
+        camera_set_transform(&c, transform_view(point(0, 0, -5),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+        // Every pixel splits exactly once: 12 * 12 corners, 11 * 11
+        // centres and 2 * 11 * 12 edge midpoints.
+        camera_set_antialiasing(&c, 9, -1.0);
+
+        canvas_t *image = camera_render(&c, &w);
+        stats_t s       = stats_collect();
+        assert(s.counts[STAT_CAMERA_RAYS] == (stats_enabled() ? 529u : 0u));
+
+        canvas_free(image);
+        world_free(&w);
+    }
+
+    { // A group's bounds are tested once per ray
+        sphere_t *s1 = malloc(sizeof(sphere_t));
+        *s1          = sphere();
+        group_t *g   = group();
+        group_add_child(g, (shape_t *)s1);
+        group_warm_bounds(g);
+
+        stats_reset();
+        ray_t r            = ray(point(0, 0, -5), vector(0, 0, 1));
+        intersections_t xs = empty_intersections();
+        shape_intersect((shape_t *)g, r, &xs);
+        stats_t s = stats_collect();
+
+        assert(xs.count == 2);
+        assert(s.counts[STAT_BOUNDS_TESTS] == (stats_enabled() ? 2u : 0u));
+        assert(s.counts[STAT_NODE_VISITS] == (stats_enabled() ? 1u : 0u));
+
+        intersections_free(&xs);
+        group_free(g);
+    }
+
+    { // A checkpointed render counts its rays like a plain one
+        world_t w  = world_default();
+        camera_t c = camera(11, 11, M_PI_2);
+        camera_set_transform(&c, transform_view(point(0, 0, -5),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+
+        canvas_t *image = checkpoint_render(&c, &w, "test_stats.ckpt", false);
+        stats_t s       = stats_collect();
+        assert(image != NULL);
+        assert(s.counts[STAT_CAMERA_RAYS] == (stats_enabled() ? 121u : 0u));
+
+        remove("test_stats.ckpt");
+        canvas_free(image);
+        world_free(&w);
+    }
+}
+
+int main(void)
+{
+    test_stats();
+    return 0;
+}
@@ -37,46 +37,61 @@ void test_triangles(void)
         triangle_t t =
             triangle(point(0, 1, 0), point(-1, 0, 0), point(1, 0, 0));
         ray_t r            = ray(point(0, -1, -2), vector(0, 1, 0));
-        intersections_t xs = triangle_intersect(&t, r);
+        intersections_t xs = empty_intersections();
+        triangle_intersect(&t, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // A ray misses the p1-p3 edge
         triangle_t t =
             triangle(point(0, 1, 0), point(-1, 0, 0), point(1, 0, 0));
         ray_t r            = ray(point(1, 1, -2), vector(0, 0, 1));
-        intersections_t xs = triangle_intersect(&t, r);
+        intersections_t xs = empty_intersections();
+        triangle_intersect(&t, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // A ray misses the p1-p2 edge
         triangle_t t =
             triangle(point(0, 1, 0), point(-1, 0, 0), point(1, 0, 0));
         ray_t r            = ray(point(-1, 1, -2), vector(0, 0, 1));
-        intersections_t xs = triangle_intersect(&t, r);
+        intersections_t xs = empty_intersections();
+        triangle_intersect(&t, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // A ray misses the p2-p3 edge
         triangle_t t =
             triangle(point(0, 1, 0), point(-1, 0, 0), point(1, 0, 0));
         ray_t r            = ray(point(0, -1, -2), vector(0, 0, 1));
-        intersections_t xs = triangle_intersect(&t, r);
+        intersections_t xs = empty_intersections();
+        triangle_intersect(&t, r, &xs);
 
         assert(xs.count == 0);
+
+        intersections_free(&xs);
     }
 
     { // A ray strikes a triangle
         triangle_t t =
             triangle(point(0, 1, 0), point(-1, 0, 0), point(1, 0, 0));
         ray_t r            = ray(point(0, 0.5, -2), vector(0, 0, 1));
-        intersections_t xs = triangle_intersect(&t, r);
+        intersections_t xs = empty_intersections();
+        triangle_intersect(&t, r, &xs);
 
         assert(xs.count == 1);
         assert(equal(xs.intersections[0].t, 2.0));
+
+        intersections_free(&xs);
     }
 
     { // Constructing a smooth triangle
@@ -106,10 +121,13 @@ void test_triangles(void)
         smooth_triangle_t tri = smooth_triangle(p1, p2, p3, n1, n2, n3);
 
         ray_t r            = ray(point(-0.2, 0.3, -2), vector(0, 0, 1));
-        intersections_t xs = smooth_triangle_intersect(&tri, r);
+        intersections_t xs = empty_intersections();
+        smooth_triangle_intersect(&tri, r, &xs);
 
         assert(equal(xs.intersections[0].u, 0.45));
         assert(equal(xs.intersections[0].v, 0.25));
+
+        intersections_free(&xs);
     }
 
     { // A smooth triangle uses u/v to interpolate the normal
@@ -142,6 +160,62 @@ void test_triangles(void)
         computations_t comps = intersections_prepare_computations(&i, &r, &xs);
 
         assert(tuple_equal(comps.normalv, vector(-0.5547, 0.83205, 0)));
+
+        intersections_free(&xs);
+    }
+
+    { // A ray through an edge shared by two triangles hits at least one
+        triangle_t left =
+            triangle(point(0, 1, 0), point(-1, -1, 0), point(0, -1, 0));
+        triangle_t right =
+            triangle(point(0, 1, 0), point(0, -1, 0), point(1, -1, 0));
+
+        intersections_t xs = empty_intersections();
+        for (int i = 0; i <= 100; i++)
+        {
+            ray_t r  = ray(point(0, -1 + i * 0.02, -2), vector(0, 0, 1));
+            xs.count = 0;
+            triangle_intersect(&left, r, &xs);
+            triangle_intersect(&right, r, &xs);
+            assert(xs.count >= 1);
+        }
+
+        // Same for an oblique ray whose dominant axis is not z.
+        ray_t r  = ray(point(-3, 0.1, -1), vector(3, 0, 1));
+        xs.count = 0;
+        triangle_intersect(&left, r, &xs);
+        triangle_intersect(&right, r, &xs);
+        assert(xs.count >= 1);
+
+        intersections_free(&xs);
+    }
+
+    { // A thin triangle is not rejected
+        triangle_t t = triangle(point(0, 0, 0), point(0.001, 0, 0),
+                                point(0, 0.00005, 0));
+        ray_t r            = ray(point(0.0002, 0.00001, -5), vector(0, 0, 1));
+        intersections_t xs = empty_intersections();
+        triangle_intersect(&t, r, &xs);
+
+        assert(xs.count == 1);
+        assert(equal(xs.intersections[0].t, 5.0));
+
+        intersections_free(&xs);
+    }
+
+    { // A ray hitting the back of a triangle reports the same point
+        triangle_t t =
+            triangle(point(0, 1, 0), point(-1, 0, 0), point(1, 0, 0));
+        ray_t r            = ray(point(-0.2, 0.3, 2), vector(0, 0, -1));
+        intersections_t xs = empty_intersections();
+        triangle_intersect(&t, r, &xs);
+
+        assert(xs.count == 1);
+        assert(equal(xs.intersections[0].t, 2.0));
+        assert(equal(xs.intersections[0].u, 0.45));
+        assert(equal(xs.intersections[0].v, 0.25));
+
+        intersections_free(&xs);
     }
 }
 
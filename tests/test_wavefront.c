@@ -0,0 +1,178 @@
+// test_wavefront.c
+
+#include "../include/bounds.h"
+#include "../include/transformations.h"
+#include "../include/wavefront.h"
+#include <assert.h>
+#include <math.h>
+
+// A checkered mirror floor under a glass sphere and a mirror sphere, so
+// most pixels trace several bounces over differently shaded materials.
+static world_t glass_and_mirrors(void)
+{
+    world_t w = world();
+    world_add_light(&w, lights_point_light(point(-10, 10, -10), color(1, 1, 1)));
+
+    plane_t floor              = plane();
+    floor.material.reflective  = 0.5;
+    floor.material.pattern     = patterns_checker(color(0.9, 0.8, 0.7),
+                                                  color(0.2, 0.3, 0.2));
+    floor.material.has_pattern = true;
+    shape_set_transform((shape_t *)&floor, transform_translation(0, -1, 0));
+    world_add_shape(&w, floor);
+
+    sphere_t glass                  = sphere();
+    glass.material.color            = color(0.1, 0.1, 0.2);
+    glass.material.transparency     = 0.9;
+    glass.material.reflective       = 0.9;
+    glass.material.refractive_index = 1.5;
+    world_add_shape(&w, glass);
+
+    sphere_t mirror            = sphere();
+    mirror.material.reflective = 1.0;
+    shape_set_transform((shape_t *)&mirror,
+                        matrix_mul(transform_translation(1.5, -0.5, 1),
+                                   transform_scaling(0.5, 0.5, 0.5)));
+    world_add_shape(&w, mirror);
+
+    return w;
+}
+
+static bool same_color(tuple_t a, tuple_t b)
+{
+    return fabs(a.x - b.x) < EPSILON && fabs(a.y - b.y) < EPSILON &&
+           fabs(a.z - b.z) < EPSILON;
+}
+
+void test_wavefront(void)
+{
+    { // A sort key puts the direction octant below the origin's cell
+        bounding_box_t origins =
+            bounding_box(point(0, 0, 0), point(1, 1, 1));
+        ray_t r = ray(point(0, 0, 0), vector(-1, 1, -1));
+        assert(wavefront_sort_key(&r, origins) == 5);
+
+        ray_t far = ray(point(1, 1, 1), vector(1, 1, 1));
+        assert(wavefront_sort_key(&far, origins) >> 3 != 0);
+        assert((wavefront_sort_key(&far, origins) & 7) == 0);
+    }
+
+    { // Hits sort by pattern type first, and hits on one shape share a key
+        sphere_t plain   = sphere();
+        sphere_t other   = sphere();
+        sphere_t striped = sphere();
+        striped.material.pattern =
+            patterns_stripe(color(1, 1, 1), color(0, 0, 0));
+        striped.material.has_pattern = true;
+
+        intersection_t a = intersection(1, &plain);
+        intersection_t b = intersection(2, &plain);
+        intersection_t c = intersection(1, &other);
+        intersection_t d = intersection(1, &striped);
+        assert(wavefront_material_key(&a) == wavefront_material_key(&b));
+        assert(wavefront_material_key(&a) >> 28 == 0);
+        assert(wavefront_material_key(&c) >> 28 == 0);
+        assert(wavefront_material_key(&d) >> 28 == 1 + PATTERN_STRIPE);
+    }
+
+    { // Sorting orders rays by key and keeps equal keys in order
+        wavefront_ray_t rays[300], temp[300];
+        unsigned seed = 3;
+        for (unsigned i = 0; i < 300; i++)
+        {
+            seed          = seed * 1103515245u + 12345u;
+            rays[i].key   = (seed >> 4) % 40 << 20 | (seed >> 8) % 4;
+            rays[i].pixel = i;
+        }
+
+        wavefront_sort(rays, temp, 300);
+        for (unsigned i = 1; i < 300; i++)
+        {
+            assert(rays[i - 1].key <= rays[i].key);
+            assert(rays[i - 1].key < rays[i].key ||
+                   rays[i - 1].pixel < rays[i].pixel);
+        }
+    }
+
+    { // A wavefront render matches the recursive one
+        world_t w  = glass_and_mirrors();
+        camera_t c = camera(45, 37, M_PI / 3);
+        camera_set_transform(&c, transform_view(point(0, 1.5, -5),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+        canvas_t *expected = camera_render(&c, &w);
+
+        camera_set_wavefront(&c, true);
+        canvas_t *image = camera_render(&c, &w);
+
+        for (unsigned y = 0; y < c.vsize; y++)
+        {
+            for (unsigned x = 0; x < c.hsize; x++)
+            {
+                assert(same_color(canvas_pixel_at(image, x, y),
+                                  canvas_pixel_at(expected, x, y)));
+            }
+        }
+
+        canvas_free(expected);
+        canvas_free(image);
+        world_free(&w);
+    }
+
+    { // Wavefront hits are shaded with their own pixel's jitter pattern
+        world_t w   = glass_and_mirrors();
+        w.lights[0] = lights_area_light(point(-10, 10, -10), vector(2, 0, 0), 2,
+                                        vector(0, 2, 0), 2, color(1, 1, 1));
+        assert(lights_set_stratified_jitter(&w.lights[0], 8, 3));
+
+        camera_t c = camera(45, 37, M_PI / 3);
+        camera_set_transform(&c, transform_view(point(0, 1.5, -5),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+        canvas_t *expected = camera_render(&c, &w);
+
+        camera_set_wavefront(&c, true);
+        canvas_t *image = camera_render(&c, &w);
+
+        for (unsigned y = 0; y < c.vsize; y++)
+        {
+            for (unsigned x = 0; x < c.hsize; x++)
+            {
+                assert(same_color(canvas_pixel_at(image, x, y),
+                                  canvas_pixel_at(expected, x, y)));
+            }
+        }
+
+        canvas_free(expected);
+        canvas_free(image);
+        world_free(&w);
+    }
+
+    { // A wavefront region lands at the same pixels as a full render
+        world_t w  = glass_and_mirrors();
+        camera_t c = camera(45, 37, M_PI / 3);
+        camera_set_transform(&c, transform_view(point(0, 1.5, -5),
+                                                point(0, 0, 0),
+                                                vector(0, 1, 0)));
+        camera_set_wavefront(&c, true);
+        canvas_t *full = camera_render(&c, &w);
+
+        render_region_t region = {30, 20, 40, 40};
+        canvas_t *crop         = camera_render_region(&c, &w, region);
+        assert(full != NULL && crop != NULL);
+        assert(crop->width == 15);
+        assert(crop->height == 17);
+        assert(tuple_equal(canvas_pixel_at(crop, 3, 4),
+                           canvas_pixel_at(full, 33, 24)));
+
+        canvas_free(full);
+        canvas_free(crop);
+        world_free(&w);
+    }
+}
+
+int main(void)
+{
+    test_wavefront();
+    return 0;
+}
@@ -29,7 +29,7 @@ void test_world(void)
     {
         world_t w = world_default();
         ray_t r   = ray(point(0, 0, -5), vector(0, 0, 1));
-        intersections_t xs;
+        intersections_t xs = empty_intersections();
         world_intersect(&w, &r, &xs);
 
         assert(xs.count == 4);
@@ -37,6 +37,7 @@ void test_world(void)
         assert(equal(xs.intersections[1].t, 4.5));
         assert(equal(xs.intersections[2].t, 5.5));
         assert(equal(xs.intersections[3].t, 6.0));
+        intersections_free(&xs);
         world_free(&w);
     }
 
@@ -216,6 +217,7 @@ void test_world(void)
         tuple_t c = world_refracted_color(&w, &comps, 5);
 
         assert(tuple_equal(c, color(0, 0, 0)));
+        intersections_free(&xs);
         world_free(&w);
     }
 
@@ -233,6 +235,7 @@ void test_world(void)
         tuple_t c = world_refracted_color(&w, &comps, 0);
 
         assert(tuple_equal(c, color(0, 0, 0)));
+        intersections_free(&xs);
         world_free(&w);
     }
 
@@ -259,6 +262,7 @@ void test_world(void)
             intersections_prepare_computations(&xs.intersections[2], &r, &xs);
         tuple_t c = world_refracted_color(&w, &comps, MAX_RECURSION);
         assert(tuple_equal(c, color(0, 0.99888, 0.04725)));
+        intersections_free(&xs);
         world_free(&w);
     }
 
@@ -286,6 +290,7 @@ void test_world(void)
         tuple_t c            = world_shade_hit(&w, &comps, 5);
 
         assert(tuple_equal(c, color(0.93391, 0.69643, 0.69243)));
+        intersections_free(&xs);
         world_free(&w);
     }
 }